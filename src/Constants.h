@@ -17,6 +17,9 @@ const uint32_t test = 42;
 #ifndef ENGINE_TEXTURES_DIR
 #define ENGINE_TEXTURES_DIR "./textures"
 #endif
+#ifndef ENGINE_CACHE_DIR
+#define ENGINE_CACHE_DIR "./cache"
+#endif
 
 // ImGui master switch (0 = fully off, 1 = on).
 // When 0: no ImGui context, SDL/Vulkan backends, descriptor pool, pipelines, or draws.
@@ -26,5 +29,47 @@ const uint32_t test = 42;
 #define ENGINE_ENABLE_IMGUI 1
 #endif
 
+// GPU-driven submission (0 = per-entity pushDataEXT + drawMeshTasksEXT loop on the CPU).
+// When 1: cull.slang builds indirect mesh-task commands and the scene is drawn with
+// drawMeshTasksIndirectCountEXT in two phases (last frame's visible set, then Hi-Z occlusion-tested rest).
+#ifndef ENGINE_GPU_DRIVEN_DRAWS
+#define ENGINE_GPU_DRIVEN_DRAWS 1
+#endif
+
+// Import-time mesh optimisation before meshlet building (AssetsLoader::optimizeMesh):
+// 0 = off, 1 = vertex-cache triangle order + vertex-fetch vertex order, 2 = 1 + overdraw-aware triangle order.
+// Part of the mesh cache key, so changing it recooks cached meshes.
+#ifndef ENGINE_MESH_OPTIMIZE
+#define ENGINE_MESH_OPTIMIZE 2
+#endif
+
+// Vertex table format (types.hpp GpuVertex, mesh.slang). 1 = 16 B PackedVertex (snorm16 positions relative to the
+// mesh bounds, half2 UVs, no color); 0 = 32 B float Vertex. CMake passes the same value to slangc.
+#ifndef ENGINE_PACKED_VERTICES
+#define ENGINE_PACKED_VERTICES 1
+#endif
+
+// Texture cooking (TextureCache). 1 = PNG/JPG sources are cooked once into UASTC KTX2 with a precomputed mip
+// chain and transcoded to BC7 at load (RGBA8 when the device lacks BC); 0 = RGBA8 upload with runtime mip blits.
+#ifndef ENGINE_TEXTURE_COMPRESSION
+#define ENGINE_TEXTURE_COMPRESSION 1
+#endif
+
+// Virtual texturing (VirtualTextureCache). 1 = cooked textures of 2048+ texels are paged into one shared atlas on
+// demand from fragMain feedback instead of being fully resident; 0 = every texture gets its own full image.
+#ifndef ENGINE_VIRTUAL_TEXTURING
+#define ENGINE_VIRTUAL_TEXTURING 1
+#endif
+
+// Texture mip streaming (TextureManager). 1 = KTX textures load only their mips of 256 texels and below, and
+// finer levels are uploaded (and trimmed again) from fragMain LOD feedback; 0 = every level is uploaded at load.
+#ifndef ENGINE_MIP_STREAMING
+#define ENGINE_MIP_STREAMING 1
+#endif
+
 inline const std::filesystem::path MODEL_PATH = std::filesystem::path(ENGINE_MODELS_DIR) / "room.obj";
 inline const std::filesystem::path TEXTURE_PATH = std::filesystem::path(ENGINE_MODELS_DIR) / "viking_room.png";
+// Cooked mesh blobs (MeshCache); safe to delete, rebuilt on the next load.
+inline const std::filesystem::path MESH_CACHE_DIR = std::filesystem::path(ENGINE_CACHE_DIR) / "meshes";
+// Cooked KTX2 textures (TextureCache); safe to delete, rebuilt on the next load.
+inline const std::filesystem::path TEXTURE_CACHE_DIR = std::filesystem::path(ENGINE_CACHE_DIR) / "textures";
@@ -0,0 +1,179 @@
+#include "asset_streamer.hpp"
+#include "../static_headers/logger.hpp"
+#include "../util/jobs.hpp"
+#include "../util/vk_tracy.hpp"
+
+#include <chrono>
+#include <format>
+
+AssetStreamer::AssetStreamer(ResourceManager& resourceManagerIn, AssetsLoader& assetsLoaderIn) :
+    resourceManager(resourceManagerIn), assetsLoader(assetsLoaderIn)
+{
+    log_info(std::format("AssetStreamer initialized (upload queue family {})",
+                         resourceManager.uploads.transfer().familyIndex),
+             "AssetStreamer");
+}
+
+AssetStreamer::~AssetStreamer()
+{
+    ZoneScopedN("AssetStreamer::~AssetStreamer");
+    for (auto& job : parseJobs) {
+        job.result.wait();
+    }
+    if (inFlight) {
+        // Engine::cleanup idles the device first; this only releases the grown buffers.
+        resourceManager.uploads.transfer().wait(inFlight->upload.timelineValue);
+        resourceManager.finishGeometryUpload(inFlight->upload);
+    }
+}
+
+void AssetStreamer::load(const std::string& modelPath, glm::vec3 position)
+{
+    ZoneScopedN("AssetStreamer::load");
+    const Transform transform{.position = position};
+    if (!assetsLoader.findMesh(modelPath)) {
+        std::optional<ImportedMesh> mesh = AssetsLoader::importModel(modelPath, position);
+        if (!mesh) {
+            return;
+        }
+        if (inFlight) {
+            // Its grown tables would be replaced from under this upload: swap them in first (idempotent, so
+            // completeUpload still works later).
+            resourceManager.uploads.transfer().wait(inFlight->upload.timelineValue);
+            resourceManager.finishGeometryUpload(inFlight->upload);
+        }
+        const GeometryRanges ranges = assetsLoader.allocateGeometry(*mesh);
+        ResourceManager::GeometryUpload upload;
+        UploadBatch batch = resourceManager.uploads.transferBatch();
+        recordUpload(batch, *mesh, ranges, upload);
+        upload.timelineValue = batch.submit();
+        // Replaced tables are retired for the frames in flight, which wait for this value first.
+        resourceManager.finishGeometryUpload(upload);
+        assetsLoader.registerMesh(*mesh, ranges);
+    }
+    // Unlike streamed instance grids, the startup model keeps the default (Dynamic) flags.
+    assetsLoader.spawnInstances(modelPath, std::span(&transform, 1));
+    resourceManager.ensureInstanceCapacity(resourceManager.objectStorage.size());
+}
+
+void AssetStreamer::request(std::string modelPath, glm::vec3 position)
+{
+    request(std::move(modelPath), std::vector{Transform{.position = position}});
+}
+
+void AssetStreamer::request(std::string modelPath, std::vector<Transform> instances)
+{
+    ZoneScopedN("AssetStreamer::request");
+    if (instances.empty()) {
+        return;
+    }
+    if (assetsLoader.findMesh(modelPath)) {
+        spawn(modelPath, instances);
+        return;
+    }
+    auto [pending, firstRequest] = pendingInstances.try_emplace(modelPath);
+    pending->second.insert(pending->second.end(), instances.begin(), instances.end());
+    if (!firstRequest) {
+        log_info(std::format("Streaming request: {} (joins the pending load, {} instance(s))", modelPath,
+                             pending->second.size()),
+                 "AssetStreamer");
+        return;
+    }
+    log_info(std::format("Streaming request: {}", modelPath), "AssetStreamer");
+    auto result = jobExecutor().async([path = modelPath, position = instances.front().position]()
+                                      { return AssetsLoader::importModel(path, position); });
+    parseJobs.push_back(ParseJob{.path = std::move(modelPath), .result = std::move(result)});
+}
+
+void AssetStreamer::poll()
+{
+    ZoneScopedN("AssetStreamer::poll");
+    assetsLoader.releaseDestroyedMeshes();
+    for (auto it = parseJobs.begin(); it != parseJobs.end();) {
+        if (it->result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+        std::optional<ImportedMesh> mesh = it->result.get();
+        const std::string path = std::move(it->path);
+        it = parseJobs.erase(it);
+        if (mesh) {
+            // The texture decodes on a worker while the geometry waits for / goes through its upload.
+            mesh->texturePath = assetsLoader.textureManager.requestTexture(mesh->texturePath);
+            parsedMeshes.push_back(std::move(*mesh));
+        } else {
+            pendingInstances.erase(path); // a failed import drops every instance that waited for it
+        }
+    }
+
+    assetsLoader.textureManager.poll();
+    if (inFlight && resourceManager.uploads.transfer().completedValue() >= inFlight->upload.timelineValue &&
+        assetsLoader.textureManager.isTextureReady(inFlight->mesh.texturePath)) {
+        completeUpload();
+    }
+    if (!inFlight && !parsedMeshes.empty()) {
+        ImportedMesh mesh = std::move(parsedMeshes.front());
+        parsedMeshes.pop_front();
+        submitUpload(std::move(mesh));
+    }
+    // Keeps the staging ring's Tracy plots current while nothing allocates from it.
+    resourceManager.uploads.staging.reclaim();
+
+    TracyPlot("Assets/PendingLoads", static_cast<double>(pendingCount()));
+}
+
+uint32_t AssetStreamer::pendingCount() const noexcept
+{
+    return static_cast<uint32_t>(parseJobs.size() + parsedMeshes.size()) + (inFlight ? 1u : 0u);
+}
+
+void AssetStreamer::submitUpload(ImportedMesh mesh)
+{
+    ZoneScopedN("AssetStreamer::submitUpload");
+    InFlightUpload& pending = inFlight.emplace(InFlightUpload{.mesh = std::move(mesh)});
+    pending.ranges = assetsLoader.allocateGeometry(pending.mesh);
+
+    UploadBatch batch = resourceManager.uploads.transferBatch();
+    recordUpload(batch, pending.mesh, pending.ranges, pending.upload);
+    pending.upload.timelineValue = batch.submit();
+
+    log_info(std::format("Upload {} submitted: {} | vertices [{}, +{}) meshlets [{}, +{})",
+                         pending.upload.timelineValue, pending.mesh.path, pending.ranges.firstVertex,
+                         pending.ranges.vertexCount, pending.ranges.firstMeshlet, pending.ranges.meshletCount),
+             "AssetStreamer");
+}
+
+void AssetStreamer::recordUpload(UploadBatch& batch, const ImportedMesh& mesh, const GeometryRanges& ranges,
+                                 ResourceManager::GeometryUpload& upload)
+{
+    resourceManager.recordGeometryUpload(
+        batch, ranges,
+        [&mesh, &ranges](uint32_t table, std::byte* destination)
+        { AssetsLoader::writeGeometry(mesh, ranges, table, destination); },
+        upload);
+}
+
+void AssetStreamer::completeUpload()
+{
+    ZoneScopedN("AssetStreamer::completeUpload");
+    resourceManager.finishGeometryUpload(inFlight->upload);
+    assetsLoader.registerMesh(inFlight->mesh, inFlight->ranges);
+    log_info(std::format("Upload {} complete: {}", inFlight->upload.timelineValue, inFlight->mesh.path),
+             "AssetStreamer");
+
+    const auto pending = pendingInstances.find(inFlight->mesh.path);
+    if (pending != pendingInstances.end()) {
+        spawn(pending->first, pending->second);
+        pendingInstances.erase(pending);
+    }
+    inFlight.reset();
+}
+
+void AssetStreamer::spawn(const std::string& modelPath, std::span<const Transform> instances)
+{
+    ZoneScopedN("AssetStreamer::spawn");
+    // Streamed instance grids stand still: only the Dynamic entities pay for matrix and ObjectUB updates.
+    assetsLoader.spawnInstances(modelPath, instances, EntityFlag::Active);
+    // Old instance arrays are retired, not destroyed: frames in flight may still read them.
+    resourceManager.ensureInstanceCapacity(resourceManager.objectStorage.size());
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assets_loader.hpp"
+#include "vk_resource_manager.hpp"
+
+// Loads models in the background without stalling the render loop:
+//   1. request(): parse + meshlet build run as a jobExecutor() task.
+//   2. poll() (main thread, once per frame): places a finished mesh in the GeometryPool and copies only its
+//      ranges through the staging ring in one transfer batch (UploadContext::transfer()).
+//   3. A later poll(): once the timeline reaches that value and the mesh's texture (decoded on a worker, uploaded
+//      by TextureManager::poll) is resident, the entity is created and drawn from the next frame.
+// One upload is in flight at a time; meshes that finish parsing meanwhile queue behind it.
+// A model is parsed and uploaded once: requests for a resident mesh spawn instances right away, and requests for
+// one still streaming join its pending instances.
+// Geometry buffers use VK_SHARING_MODE_CONCURRENT, so no queue-family ownership transfer is recorded.
+class AssetStreamer
+{
+public:
+    AssetStreamer(ResourceManager& resourceManager, AssetsLoader& assetsLoader);
+    ~AssetStreamer();
+
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    // Synchronous import + upload + entity (startup). The upload is not waited on: the first frame's submit waits
+    // for its timeline value. A model that is already resident only gets a new entity.
+    void load(const std::string& modelPath, glm::vec3 position);
+    void request(std::string modelPath, glm::vec3 position);
+    // One entity per transform, all sharing the model's geometry.
+    void request(std::string modelPath, std::vector<Transform> instances);
+    void poll();
+
+    // Models not yet visible in the scene (parsing, queued or uploading).
+    [[nodiscard]] uint32_t pendingCount() const noexcept;
+
+private:
+    struct InFlightUpload
+    {
+        ImportedMesh mesh;
+        GeometryRanges ranges;
+        ResourceManager::GeometryUpload upload;
+    };
+
+    void submitUpload(ImportedMesh mesh);
+    // Stages mesh at ranges in batch (AssetsLoader::writeGeometry into the staging ring, no CPU copy of the pool).
+    void recordUpload(UploadBatch& batch, const ImportedMesh& mesh, const GeometryRanges& ranges,
+                      ResourceManager::GeometryUpload& upload);
+    void completeUpload();
+    void spawn(const std::string& modelPath, std::span<const Transform> instances);
+
+    ResourceManager& resourceManager;
+    AssetsLoader& assetsLoader;
+
+    struct ParseJob
+    {
+        std::string path;
+        std::future<std::optional<ImportedMesh>> result;
+    };
+
+    std::deque<ParseJob> parseJobs;
+    std::deque<ImportedMesh> parsedMeshes;
+    std::optional<InFlightUpload> inFlight;
+    // Instances waiting for their model, keyed by path; an entry exists while the model streams.
+    std::unordered_map<std::string, std::vector<Transform>> pendingInstances;
+};
@@ -1,8 +1,10 @@
 #include "assets_loader.hpp"
 #include "../Constants.h"
 #include "../static_headers/logger.hpp"
+#include "../util/jobs.hpp"
 #include "../util/vk_tracy.hpp"
 
+#include <glm/packing.hpp>
 #include <meshoptimizer.h>
 
 // ── glTF external-reference detection ───────────────────────
@@ -13,7 +15,179 @@ namespace
     // meshopt defaults suited to EXT_mesh_shader (clamp later against device props).
     constexpr size_t kMeshletMaxVertices = 64;
     constexpr size_t kMeshletMaxTriangles = 126;
-    constexpr float kMeshletConeWeight = 0.0f;
+    // Non-zero weight trades a little meshlet compactness for tighter normal cones (backface culling).
+    constexpr float kMeshletConeWeight = 0.25f;
+    // Triangles per meshlet build task. Larger primitives are spatially sorted, then split, so every chunk
+    // stays a compact region and the seams only cost a few partially filled meshlets.
+    constexpr size_t kMeshletChunkTriangles = 64 * 1024;
+
+    // Cluster LOD: meshlets merged per group, the triangle share a simplification must reach to count,
+    // and a cap on the DAG depth.
+    constexpr size_t kLodGroupSize = 4;
+    constexpr float kLodMaxSimplifiedRatio = 0.85f;
+    constexpr uint32_t kLodMaxLevels = 16;
+    // Discrete LODs: a level has to drop at least this share of the previous level's triangles to be kept.
+    constexpr float kMeshLodMinReduction = 0.05f;
+
+    // Post-transform cache size the ACMR report models (meshopt's recommendation for current GPUs).
+    constexpr unsigned int kVertexCacheSize = 16;
+    // optimizeOverdraw may worsen ACMR by at most this factor to get a better front-to-back order.
+    constexpr float kOverdrawThreshold = 1.05f;
+
+    // Meshlets of one index range; offsets are local to the chunk's own arrays until concatenated.
+    struct MeshletChunk
+    {
+        size_t firstIndex = 0;
+        size_t indexCount = 0;
+        std::vector<MeshletDesc> meshlets;
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint8_t> meshletTriangles;
+    };
+
+    // Splits mesh.indices into per-primitive chunks of at most kMeshletChunkTriangles. Larger primitives are
+    // spatially sorted first. mesh.primitiveFirstIndex is rewritten to the chunk starts, so a second call
+    // (optimizeMesh, then buildMeshlets) returns the same chunks without reordering anything.
+    std::vector<MeshletChunk> splitIntoChunks(ImportedMesh& mesh)
+    {
+        ZoneScopedN("AssetsLoader::splitIntoChunks");
+        const size_t indexCount = mesh.indices.size();
+        std::vector<uint32_t> primitiveStarts = mesh.primitiveFirstIndex;
+        if (primitiveStarts.empty() || primitiveStarts.front() != 0) {
+            primitiveStarts.insert(primitiveStarts.begin(), 0);
+        }
+        constexpr size_t maxChunkIndices = kMeshletChunkTriangles * 3;
+        std::vector<MeshletChunk> chunks;
+        for (size_t p = 0; p < primitiveStarts.size(); ++p) {
+            const size_t first = primitiveStarts[p];
+            const size_t end = p + 1 < primitiveStarts.size() ? primitiveStarts[p + 1] : indexCount;
+            const size_t count = (end - first) / 3 * 3;
+            if (count == 0) {
+                continue;
+            }
+            if (count > maxChunkIndices) {
+                ZoneScopedN("AssetsLoader::spatialSortTriangles");
+                const std::vector<uint32_t> source(mesh.indices.begin() + first,
+                                                   mesh.indices.begin() + first + count);
+                meshopt_spatialSortTriangles(mesh.indices.data() + first, source.data(), count,
+                                             &mesh.vertices[0].pos.x, mesh.vertices.size(), sizeof(Vertex));
+            }
+            for (size_t offset = 0; offset < count; offset += maxChunkIndices) {
+                chunks.push_back(MeshletChunk{.firstIndex = first + offset,
+                                              .indexCount = std::min(maxChunkIndices, count - offset)});
+            }
+        }
+        mesh.primitiveFirstIndex.clear();
+        for (const MeshletChunk& chunk : chunks) {
+            mesh.primitiveFirstIndex.push_back(static_cast<uint32_t>(chunk.firstIndex));
+        }
+        return chunks;
+    }
+
+    // Runs work(item) for every item on jobExecutor(); inline when there is only one.
+    template <typename Item, typename Work>
+    void parallelForEach(std::vector<Item>& items, const char* name, Work&& work)
+    {
+        if (items.size() == 1) {
+            work(items.front());
+            return;
+        }
+        tf::Taskflow taskflow(name);
+        for (Item& item : items) {
+            taskflow.emplace([&work, &item] { work(item); });
+        }
+        runAndWait(taskflow);
+    }
+
+
+    // Packs meshopt's quantized cone (axis xyz + cutoff, snorm8) into one uint; decoded by mesh.slang.
+    uint32_t packMeshletCone(const meshopt_Bounds& bounds)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(bounds.cone_axis_s8[0])) |
+            static_cast<uint32_t>(static_cast<uint8_t>(bounds.cone_axis_s8[1])) << 8 |
+            static_cast<uint32_t>(static_cast<uint8_t>(bounds.cone_axis_s8[2])) << 16 |
+            static_cast<uint32_t>(static_cast<uint8_t>(bounds.cone_cutoff_s8)) << 24;
+    }
+
+    // meshopt meshlets for one index list (indices into vertices) into chunk's own arrays.
+    void buildClusters(const std::vector<Vertex>& vertices, const uint32_t* indices, size_t indexCount,
+                       MeshletChunk& chunk)
+    {
+        const size_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, kMeshletMaxVertices, kMeshletMaxTriangles);
+        std::vector<meshopt_Meshlet> built(maxMeshlets);
+        chunk.meshletVertices.resize(indexCount);
+        chunk.meshletTriangles.resize(indexCount);
+
+        const size_t meshletCount = meshopt_buildMeshlets(
+            built.data(), chunk.meshletVertices.data(), chunk.meshletTriangles.data(), indices, indexCount,
+            &vertices[0].pos.x, vertices.size(), sizeof(Vertex), kMeshletMaxVertices, kMeshletMaxTriangles,
+            kMeshletConeWeight);
+        if (meshletCount == 0) {
+            chunk.meshletVertices.clear();
+            chunk.meshletTriangles.clear();
+            return;
+        }
+
+        const meshopt_Meshlet& last = built[meshletCount - 1];
+        chunk.meshletVertices.resize(last.vertex_offset + last.vertex_count);
+        chunk.meshletTriangles.resize(last.triangle_offset + last.triangle_count * 3);
+        chunk.meshlets.reserve(meshletCount);
+
+        for (size_t i = 0; i < meshletCount; ++i) {
+            const meshopt_Meshlet& m = built[i];
+            uint32_t* meshletVertexData = chunk.meshletVertices.data() + m.vertex_offset;
+            uint8_t* meshletTriangleData = chunk.meshletTriangles.data() + m.triangle_offset;
+
+            meshopt_optimizeMeshlet(meshletVertexData, meshletTriangleData, m.triangle_count, m.vertex_count);
+
+            const meshopt_Bounds bounds =
+                meshopt_computeMeshletBounds(meshletVertexData, meshletTriangleData, m.triangle_count,
+                                             &vertices[0].pos.x, vertices.size(), sizeof(Vertex));
+
+            const glm::vec4 sphere{bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius};
+            chunk.meshlets.push_back(MeshletDesc{
+                .vertexOffset = m.vertex_offset,
+                .triangleOffset = m.triangle_offset,
+                .vertexCount = static_cast<uint16_t>(m.vertex_count),
+                .triangleCount = static_cast<uint16_t>(m.triangle_count),
+                .cone = packMeshletCone(bounds),
+                .boundingSphere = sphere,
+                .lodSphere = sphere,
+            });
+        }
+    }
+
+    // Appends a chunk's meshlets to the mesh, rebasing their offsets.
+    void appendChunk(ImportedMesh& mesh, const MeshletChunk& chunk)
+    {
+        const auto vertexBase = static_cast<uint32_t>(mesh.meshletVertices.size());
+        const auto triangleBase = static_cast<uint32_t>(mesh.meshletTriangles.size());
+        for (MeshletDesc meshlet : chunk.meshlets) {
+            meshlet.vertexOffset += vertexBase;
+            meshlet.triangleOffset += triangleBase;
+            mesh.meshlets.push_back(meshlet);
+        }
+        mesh.meshletVertices.insert(mesh.meshletVertices.end(), chunk.meshletVertices.begin(),
+                                    chunk.meshletVertices.end());
+        mesh.meshletTriangles.insert(mesh.meshletTriangles.end(), chunk.meshletTriangles.begin(),
+                                     chunk.meshletTriangles.end());
+    }
+
+
+#if ENGINE_PACKED_VERTICES
+    // Quantizes a vertex against the mesh's bounding sphere (decoded by mesh.slang decodeVertex).
+    PackedVertex packVertex(const Vertex& vertex, const glm::vec4& meshBounds)
+    {
+        const float invRadius = meshBounds.w > 0.0f ? 1.0f / meshBounds.w : 1.0f;
+        const glm::vec3 local = glm::clamp((vertex.pos - glm::vec3(meshBounds)) * invRadius, -1.0f, 1.0f);
+        const glm::vec3 quantized = glm::round(local * 32767.0f);
+        return PackedVertex{
+            .position = {static_cast<int16_t>(quantized.x), static_cast<int16_t>(quantized.y),
+                         static_cast<int16_t>(quantized.z), 0},
+            .texCoord = glm::packHalf2x16(vertex.texCoord),
+            .normal = 0,
+        };
+    }
+#endif
 
 
     struct GltfExternalRef
@@ -160,104 +334,491 @@ static std::vector<char> readFile(const std::string& filename)
 
 
 AssetsLoader::AssetsLoader(ObjectStorage& objectStorageIn, TextureManager& textureManagerIn) :
-    vertices(), indices(), objectStorage(objectStorageIn), textureManager(textureManagerIn)
+    objectStorage(objectStorageIn), textureManager(textureManagerIn)
 {
     log_info("AssetsLoader initialized", "AssetLoader");
 }
 
 
-void AssetsLoader::loadModel(std::string modelPath, glm::vec3 xyz)
+MeshView ImportedMesh::view() const
 {
-    ZoneScopedN("AssetsLoader::loadModel");
+    if (cached) {
+        return cached->view;
+    }
+    return MeshView{
+        .vertices = vertices,
+        .meshlets = meshlets,
+        .meshletVertices = meshletVertices,
+        .meshletTriangles = meshletTriangles,
+        .lodFirstMeshlets = lodFirstMeshlets,
+    };
+}
+
+std::optional<ImportedMesh> AssetsLoader::importModel(const std::string& modelPath, glm::vec3 xyz)
+{
+    ZoneScopedN("AssetsLoader::importModel");
     // Normalise to native separators once so every loader receives a
     // clean, OS-consistent path regardless of how it was supplied.
     const std::string path = std::filesystem::path(modelPath).make_preferred().string();
 
-    const bool isGltf = path.ends_with(".gltf") || path.ends_with(".glb");
-    const bool isObj = path.ends_with(".obj");
+    ImportedMesh mesh{.path = modelPath, .position = xyz};
+    const uint64_t cacheKey = MeshCache::sourceKey(path);
+    if (cacheKey != 0) {
+        if (std::optional<CachedMesh> cached = MeshCache::load(cacheKey)) {
+            mesh.texturePath = cached->texturePath;
+            mesh.boundingSphere = cached->boundingSphere;
+            log_info(std::format("Mesh cache hit: {} | vertices: {} | meshlets: {}", path,
+                                 cached->view.vertices.size(), cached->view.meshlets.size()),
+                     "AssetLoader");
+            mesh.cached = std::move(cached);
+            return mesh;
+        }
+    }
 
-    if (isGltf) {
-        loadGltfModel(path, xyz);
-        return;
+    bool loaded = false;
+    if (path.ends_with(".gltf") || path.ends_with(".glb")) {
+        loaded = loadGltfModel(path, mesh);
+    } else if (path.ends_with(".obj")) {
+        loaded = loadObjModel(path, mesh);
+    } else {
+        log_error(std::format("Unsupported model format: {}", path), "AssetLoader");
+    }
+    if (!loaded) {
+        return std::nullopt;
     }
 
-    if (isObj) {
-        loadObjModel(path, xyz);
-        return;
+#if ENGINE_MESH_OPTIMIZE
+    optimizeMesh(mesh);
+#endif
+    buildMeshlets(mesh);
+    buildMeshletLods(mesh);
+    buildDiscreteLods(mesh);
+    if (cacheKey != 0) {
+        MeshCache::store(cacheKey, mesh.view(), mesh.texturePath, mesh.boundingSphere);
     }
+    return mesh;
+}
 
-    assert(false && "Unsupported model format");
+GeometryRanges AssetsLoader::allocateGeometry(const ImportedMesh& mesh)
+{
+    ZoneScopedN("AssetsLoader::allocateGeometry");
+    const MeshView view = mesh.view();
+    return geometry.allocate(
+        static_cast<uint32_t>(view.vertices.size()), static_cast<uint32_t>(view.meshlets.size()),
+        static_cast<uint32_t>(view.meshletVertices.size()), static_cast<uint32_t>(view.meshletTriangles.size()));
 }
 
-MeshletDraw AssetsLoader::buildMeshletsForRange(uint32_t firstIndex, uint32_t indexCount)
+void AssetsLoader::writeGeometry(const ImportedMesh& mesh, const GeometryRanges& ranges, uint32_t table,
+                                 std::byte* destination)
 {
-    ZoneScopedN("AssetsLoader::buildMeshletsForRange");
-    if (indexCount == 0 || vertices.empty() || firstIndex + indexCount > indices.size()) {
-        return {};
+    ZoneScopedN("AssetsLoader::writeGeometry");
+    const MeshView view = mesh.view();
+    switch (table) {
+    case 0:
+#if ENGINE_PACKED_VERTICES
+        std::ranges::transform(view.vertices, reinterpret_cast<GpuVertex*>(destination),
+                               [&](const Vertex& vertex) { return packVertex(vertex, mesh.boundingSphere); });
+#else
+        std::ranges::copy(view.vertices, reinterpret_cast<GpuVertex*>(destination));
+#endif
+        break;
+    case 1:
+        std::ranges::transform(view.meshlets, reinterpret_cast<MeshletDesc*>(destination),
+                               [&](MeshletDesc meshlet)
+                               {
+                                   meshlet.vertexOffset += ranges.firstMeshletVertex;
+                                   meshlet.triangleOffset += ranges.firstMeshletTriangle;
+                                   return meshlet;
+                               });
+        break;
+    case 2:
+        std::ranges::transform(view.meshletVertices, reinterpret_cast<uint32_t*>(destination),
+                               [&](uint32_t vertex) { return ranges.firstVertex + vertex; });
+        break;
+    default:
+        std::ranges::copy(view.meshletTriangles, reinterpret_cast<uint8_t*>(destination));
+        break;
     }
+}
 
-    const size_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, kMeshletMaxVertices, kMeshletMaxTriangles);
-    std::vector<meshopt_Meshlet> built(maxMeshlets);
-    std::vector<unsigned int> localVertices(indexCount);
-    std::vector<unsigned char> localTriangles(indexCount);
+void AssetsLoader::releaseGeometry(const GeometryRanges& ranges)
+{
+    geometry.release(ranges);
+}
 
-    const size_t meshletCount =
-        meshopt_buildMeshlets(built.data(), localVertices.data(), localTriangles.data(), indices.data() + firstIndex,
-                              indexCount, &vertices[0].pos.x, vertices.size(), sizeof(Vertex), kMeshletMaxVertices,
-                              kMeshletMaxTriangles, kMeshletConeWeight);
+const MeshAsset& AssetsLoader::registerMesh(const ImportedMesh& mesh, const GeometryRanges& ranges)
+{
+    ZoneScopedN("AssetsLoader::registerMesh");
+    if (const auto it = loadedMeshes.find(mesh.path); it != loadedMeshes.end()) {
+        // Nothing has drawn the duplicate yet, so its ranges can be reused right away.
+        releaseGeometry(ranges);
+        log_info(std::format("Mesh {} already resident, dropped the duplicate copy", mesh.path), "AssetLoader");
+        return it->second;
+    }
 
-    if (meshletCount == 0) {
-        return {};
+    // LOD ranges are mesh-local meshlet offsets; a mesh without any (cluster LOD DAG) is one LOD. LOD 0 keeps the
+    // whole-mesh sphere (PackedVertex positions are relative to it); coarser LODs enclose their own meshlets.
+    const MeshView view = mesh.view();
+    const std::span<const uint32_t> lodStarts = view.lodFirstMeshlets;
+    MeshLodChain lodChain{.lodCount = std::clamp(static_cast<uint32_t>(lodStarts.size()), 1u, kMaxMeshLods)};
+    for (uint32_t lod = 0; lod < lodChain.lodCount; ++lod) {
+        const uint32_t first = lodStarts.empty() ? 0 : lodStarts[lod];
+        const uint32_t end = lod + 1 < lodChain.lodCount ? lodStarts[lod + 1] : ranges.meshletCount;
+        glm::vec4 sphere = mesh.boundingSphere;
+        if (lod > 0) {
+            const MeshletDesc& firstDesc = view.meshlets[first];
+            const meshopt_Bounds bounds =
+                meshopt_computeSphereBounds(&firstDesc.boundingSphere.x, end - first, sizeof(MeshletDesc),
+                                            &firstDesc.boundingSphere.w, sizeof(MeshletDesc));
+            sphere = glm::vec4{bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius};
+        }
+        lodChain.lods[lod] = MeshletDraw{
+            .firstMeshlet = ranges.firstMeshlet + first,
+            .meshletCount = end - first,
+            .boundingSphere = sphere,
+        };
     }
+    const std::string textureKey = textureManager.requestTexture(mesh.texturePath);
+    const MaterialRef material{.textureIndex = textureManager.loadTexture(textureKey),
+                               .materialId = textureManager.materialId(textureKey)};
+    const MeshAsset& asset =
+        loadedMeshes
+            .emplace(mesh.path,
+                     MeshAsset{.ranges = ranges, .lods = lodChain, .material = material, .textureKey = textureKey})
+            .first->second;
+    log_info(std::format("Model loaded: {} | vertices [{}, {}) | meshlets: {} (first {}) | pool vertices: {}/{} | "
+                         "pool meshlets: {}/{}",
+                         mesh.path, ranges.firstVertex, ranges.firstVertex + ranges.vertexCount, ranges.meshletCount,
+                         ranges.firstMeshlet, geometry.vertexRanges.usedCount(), geometry.vertexRanges.capacity(),
+                         geometry.meshletRanges.usedCount(), geometry.meshletRanges.capacity()),
+             "AssetLoader");
+    return asset;
+}
 
-    const meshopt_Meshlet& last = built[meshletCount - 1];
-    localVertices.resize(last.vertex_offset + last.vertex_count);
-    localTriangles.resize(last.triangle_offset + last.triangle_count * 3);
-    built.resize(meshletCount);
+EntityId AssetsLoader::spawnInstances(const std::string& modelPath, std::span<const Transform> transforms,
+                                      uint32_t entityFlags)
+{
+    ZoneScopedN("AssetsLoader::spawnInstances");
+    const auto it = loadedMeshes.find(modelPath);
+    if (it == loadedMeshes.end() || transforms.empty()) {
+        return kInvalidEntityId;
+    }
+    MeshAsset* asset = &it->second;
+    asset->instanceCount += static_cast<uint32_t>(transforms.size());
+    MaterialRef material = asset->material;
+    material.textureIndex = textureManager.textureIndex(asset->textureKey);
+    const EntityId first = objectStorage.spawnInstances(transforms, asset->lods, material, modelPath, entityFlags);
+    log_info(std::format("Spawned {} instance(s) of {} | entities [{}, {}) | meshlets: {} (first {})",
+                         transforms.size(), modelPath, first, first + transforms.size(),
+                         asset->lods.lods[0].meshletCount, asset->lods.lods[0].firstMeshlet),
+             "AssetLoader");
+    return first;
+}
 
-    const uint32_t baseVertexOffset = static_cast<uint32_t>(meshletVertices.size());
-    const uint32_t baseTriangleOffset = static_cast<uint32_t>(meshletTriangles.size());
-    const uint32_t baseMeshlet = static_cast<uint32_t>(meshlets.size());
+const MeshAsset* AssetsLoader::findMesh(const std::string& modelPath) const
+{
+    const auto it = loadedMeshes.find(modelPath);
+    return it != loadedMeshes.end() ? &it->second : nullptr;
+}
 
-    meshletVertices.insert(meshletVertices.end(), localVertices.begin(), localVertices.end());
-    meshletTriangles.insert(meshletTriangles.end(), localTriangles.begin(), localTriangles.end());
-    meshlets.reserve(meshlets.size() + meshletCount);
+void AssetsLoader::releaseDestroyedMeshes()
+{
+    ZoneScopedN("AssetsLoader::releaseDestroyedMeshes");
+    objectStorage.takeDestroyedNames(destroyedNames);
+    // Entities are named after their model path: one lookup per distinct name.
+    std::ranges::sort(destroyedNames);
+    for (auto run = destroyedNames.begin(); run != destroyedNames.end();) {
+        const auto runEnd = std::upper_bound(run, destroyedNames.end(), *run);
+        const auto destroyed = static_cast<uint32_t>(runEnd - run);
+        const auto it = loadedMeshes.find(std::string(objectStorage.names.view(*run)));
+        run = runEnd;
+        if (it == loadedMeshes.end()) {
+            continue; // not spawned from a mesh asset
+        }
+        MeshAsset& asset = it->second;
+        asset.instanceCount -= std::min(asset.instanceCount, destroyed);
+        if (asset.instanceCount > 0) {
+            continue;
+        }
+        geometry.retire(asset.ranges);
+        log_info(std::format("Mesh {} unloaded | vertices [{}, +{}) meshlets [{}, +{}) retired", it->first,
+                             asset.ranges.firstVertex, asset.ranges.vertexCount, asset.ranges.firstMeshlet,
+                             asset.ranges.meshletCount),
+                 "AssetLoader");
+        loadedMeshes.erase(it);
+    }
+}
 
-    for (size_t i = 0; i < meshletCount; ++i) {
-        const meshopt_Meshlet& m = built[i];
-        const uint32_t vertexOffset = baseVertexOffset + m.vertex_offset;
-        const uint32_t triangleOffset = baseTriangleOffset + m.triangle_offset;
+void AssetsLoader::optimizeMesh(ImportedMesh& mesh)
+{
+    ZoneScopedN("AssetsLoader::optimizeMesh");
+    if (mesh.indices.empty() || mesh.vertices.empty()) {
+        return;
+    }
+    auto analyze = [&mesh]
+    {
+        const meshopt_VertexCacheStatistics cache = meshopt_analyzeVertexCache(
+            mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), kVertexCacheSize, 0, 0);
+        const meshopt_VertexFetchStatistics fetch =
+            meshopt_analyzeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), sizeof(Vertex));
+        return std::pair{cache.acmr, fetch.overfetch};
+    };
+    const auto [acmrBefore, overfetchBefore] = analyze();
+
+    // ── Triangle order, per chunk ──
+    // Chunks are the meshlet build units: triangles never leave their chunk, and chunks run in parallel
+    // because their index ranges are disjoint.
+    std::vector<MeshletChunk> chunks = splitIntoChunks(mesh);
+    parallelForEach(chunks, "OptimizeMesh",
+                 [&mesh](const MeshletChunk& chunk)
+                 {
+                     ZoneScopedN("AssetsLoader::optimizeChunk");
+                     uint32_t* indices = mesh.indices.data() + chunk.firstIndex;
+                     meshopt_optimizeVertexCache(indices, indices, chunk.indexCount, mesh.vertices.size());
+#if ENGINE_MESH_OPTIMIZE >= 2
+                     meshopt_optimizeOverdraw(indices, indices, chunk.indexCount, &mesh.vertices[0].pos.x,
+                                              mesh.vertices.size(), sizeof(Vertex), kOverdrawThreshold);
+#endif
+                 });
+
+    // ── Vertex order, whole mesh ──
+    // Vertices are renumbered in first-use order, so each meshlet's vertices sit close together in the
+    // vertex SSBO. Vertices no triangle references are dropped.
+    const size_t vertexCount = meshopt_optimizeVertexFetch(mesh.vertices.data(), mesh.indices.data(),
+                                                           mesh.indices.size(), mesh.vertices.data(),
+                                                           mesh.vertices.size(), sizeof(Vertex));
+    const size_t vertexCountBefore = mesh.vertices.size();
+    mesh.vertices.resize(vertexCount);
+
+    const auto [acmrAfter, overfetchAfter] = analyze();
+    log_info(std::format("Optimized {} | ACMR {:.3f} -> {:.3f} | overfetch {:.3f} -> {:.3f} | vertices {} -> {}",
+                         mesh.path, acmrBefore, acmrAfter, overfetchBefore, overfetchAfter, vertexCountBefore,
+                         vertexCount),
+             "AssetLoader");
+}
 
-        meshopt_optimizeMeshlet(meshletVertices.data() + vertexOffset, meshletTriangles.data() + triangleOffset,
-                                m.triangle_count, m.vertex_count);
+void AssetsLoader::buildMeshlets(ImportedMesh& mesh)
+{
+    ZoneScopedN("AssetsLoader::buildMeshlets");
+    const auto indexCount = mesh.indices.size();
+    if (indexCount == 0 || mesh.vertices.empty()) {
+        return;
+    }
 
-        const meshopt_Bounds bounds = meshopt_computeMeshletBounds(
-            meshletVertices.data() + vertexOffset, meshletTriangles.data() + triangleOffset, m.triangle_count,
-            &vertices[0].pos.x, vertices.size(), sizeof(Vertex));
+    std::vector<MeshletChunk> chunks = splitIntoChunks(mesh);
+    if (chunks.empty()) {
+        return;
+    }
 
-        meshlets.push_back(MeshletDesc{
-            .vertexOffset = vertexOffset,
-            .triangleOffset = triangleOffset,
-            .vertexCount = m.vertex_count,
-            .triangleCount = m.triangle_count,
-            .boundingSphere = glm::vec4{bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius},
-        });
+    // ── Build chunks in parallel ──
+    // Each task writes only its own chunk; mesh.vertices / mesh.indices are read-only from here on.
+    parallelForEach(chunks, "BuildMeshlets",
+                    [&mesh](MeshletChunk& chunk)
+                    {
+                        ZoneScopedN("AssetsLoader::buildMeshletChunk");
+                        buildClusters(mesh.vertices, mesh.indices.data() + chunk.firstIndex, chunk.indexCount,
+                                      chunk);
+                    });
+
+    // ── Concatenate in chunk order ──
+    // Output depends only on the chunk list, never on which worker finished first.
+    size_t meshletCount = 0;
+    size_t meshletVertexCount = 0;
+    size_t meshletTriangleCount = 0;
+    for (const MeshletChunk& chunk : chunks) {
+        meshletCount += chunk.meshlets.size();
+        meshletVertexCount += chunk.meshletVertices.size();
+        meshletTriangleCount += chunk.meshletTriangles.size();
+    }
+    if (meshletCount == 0) {
+        return;
+    }
+    mesh.meshlets.reserve(meshletCount);
+    mesh.meshletVertices.reserve(meshletVertexCount);
+    mesh.meshletTriangles.reserve(meshletTriangleCount);
+    for (const MeshletChunk& chunk : chunks) {
+        appendChunk(mesh, chunk);
     }
 
-    const MeshletDraw draw{
-        .firstMeshlet = baseMeshlet,
-        .meshletCount = static_cast<uint32_t>(meshletCount),
+    // Whole-mesh sphere enclosing every meshlet sphere (GPU instance culling).
+    const MeshletDesc& firstDesc = mesh.meshlets.front();
+    const meshopt_Bounds meshBounds =
+        meshopt_computeSphereBounds(&firstDesc.boundingSphere.x, meshletCount, sizeof(MeshletDesc),
+                                    &firstDesc.boundingSphere.w, sizeof(MeshletDesc));
+    mesh.boundingSphere = glm::vec4{meshBounds.center[0], meshBounds.center[1], meshBounds.center[2],
+                                    meshBounds.radius};
+
+    log_info(std::format("Built {} meshlets for {} in {} chunks ({} indices, {} meshlet verts, {} local tri "
+                         "corners)",
+                         meshletCount, mesh.path, chunks.size(), indexCount, mesh.meshletVertices.size(),
+                         mesh.meshletTriangles.size()),
+             "AssetLoader");
+}
+
+void AssetsLoader::buildMeshletLods(ImportedMesh& mesh)
+{
+    ZoneScopedN("AssetsLoader::buildMeshletLods");
+    if (mesh.meshlets.size() < 2) {
+        return;
+    }
+    // meshopt reports errors relative to the mesh extent.
+    const float errorScale = meshopt_simplifyScale(&mesh.vertices[0].pos.x, mesh.vertices.size(), sizeof(Vertex));
+
+    struct LodGroup
+    {
+        size_t firstMeshlet = 0; // consecutive meshlets of the previous level
+        size_t meshletCount = 0;
+        glm::vec4 sphere{0.0f};
+        float error = 0.0f;
+        MeshletChunk simplified; // empty when the group did not simplify enough
+    };
+
+    // Runs on workers: reads only the previous level, writes only its own group.
+    auto simplifyGroup = [&mesh, errorScale](LodGroup& group)
+    {
+        ZoneScopedN("AssetsLoader::simplifyMeshletGroup");
+        std::vector<uint32_t> indices;
+        float childError = 0.0f;
+        for (size_t m = group.firstMeshlet; m < group.firstMeshlet + group.meshletCount; ++m) {
+            const MeshletDesc& meshlet = mesh.meshlets[m];
+            for (uint32_t corner = 0; corner < meshlet.triangleCount * 3u; ++corner) {
+                const uint8_t local = mesh.meshletTriangles[meshlet.triangleOffset + corner];
+                indices.push_back(mesh.meshletVertices[meshlet.vertexOffset + local]);
+            }
+            childError = std::max(childError, meshlet.lodError);
+        }
+
+        // Locked group borders keep the result crack-free against neighbouring groups at any level.
+        std::vector<uint32_t> simplified(indices.size());
+        float relativeError = 0.0f;
+        simplified.resize(meshopt_simplify(simplified.data(), indices.data(), indices.size(),
+                                           &mesh.vertices[0].pos.x, mesh.vertices.size(), sizeof(Vertex),
+                                           indices.size() / 6 * 3, 1.0f, meshopt_SimplifyLockBorder,
+                                           &relativeError));
+        if (simplified.empty() ||
+            static_cast<float>(simplified.size()) > static_cast<float>(indices.size()) * kLodMaxSimplifiedRatio) {
+            return;
+        }
+
+        // Group bounds enclose every child's LOD sphere and the error never shrinks with the level, so the
+        // projected error is monotonic up the DAG.
+        const MeshletDesc& first = mesh.meshlets[group.firstMeshlet];
+        const meshopt_Bounds bounds = meshopt_computeSphereBounds(
+            &first.lodSphere.x, group.meshletCount, sizeof(MeshletDesc), &first.lodSphere.w, sizeof(MeshletDesc));
+        group.sphere = glm::vec4{bounds.center[0], bounds.center[1], bounds.center[2], bounds.radius};
+        group.error = childError + relativeError * errorScale;
+        buildClusters(mesh.vertices, simplified.data(), simplified.size(), group.simplified);
     };
 
-    log_info(std::format("Built {} meshlets for index range [{}, {}) ({} meshlet verts, {} local tri corners)",
-                         draw.meshletCount, firstIndex, firstIndex + indexCount, localVertices.size(),
-                         localTriangles.size()),
+    std::vector<size_t> levelMeshletCounts{mesh.meshlets.size()};
+    size_t levelBegin = 0;
+    size_t levelEnd = mesh.meshlets.size();
+    for (uint32_t level = 1; level < kLodMaxLevels && levelEnd - levelBegin > 1; ++level) {
+        // Meshlets are grouped in build order, which the spatial sort and greedy builder keep local.
+        std::vector<LodGroup> groups;
+        for (size_t first = levelBegin; first < levelEnd; first += kLodGroupSize) {
+            groups.push_back(
+                LodGroup{.firstMeshlet = first, .meshletCount = std::min(kLodGroupSize, levelEnd - first)});
+        }
+
+        parallelForEach(groups, "BuildMeshletLods", simplifyGroup);
+
+        // Serial, in group order: links children to their group and appends the next level.
+        const size_t nextBegin = mesh.meshlets.size();
+        for (const LodGroup& group : groups) {
+            if (group.simplified.meshlets.empty()) {
+                continue; // these children stay roots
+            }
+            for (size_t m = group.firstMeshlet; m < group.firstMeshlet + group.meshletCount; ++m) {
+                mesh.meshlets[m].parentLodSphere = group.sphere;
+                mesh.meshlets[m].parentLodError = group.error;
+            }
+            const size_t appended = mesh.meshlets.size();
+            appendChunk(mesh, group.simplified);
+            for (size_t m = appended; m < mesh.meshlets.size(); ++m) {
+                mesh.meshlets[m].lodSphere = group.sphere;
+                mesh.meshlets[m].lodError = group.error;
+                mesh.meshlets[m].lodLevel = level;
+            }
+        }
+        if (mesh.meshlets.size() == nextBegin) {
+            break;
+        }
+        levelBegin = nextBegin;
+        levelEnd = mesh.meshlets.size();
+        levelMeshletCounts.push_back(levelEnd - levelBegin);
+    }
+
+    std::string perLevel;
+    for (const size_t count : levelMeshletCounts) {
+        perLevel += std::format("{}{}", perLevel.empty() ? "" : " / ", count);
+    }
+    log_info(std::format("Built {} LOD levels for {} | meshlets per level: {}", levelMeshletCounts.size(),
+                         mesh.path, perLevel),
              "AssetLoader");
+}
+
+void AssetsLoader::buildDiscreteLods(ImportedMesh& mesh)
+{
+    ZoneScopedN("AssetsLoader::buildDiscreteLods");
+    mesh.lodFirstMeshlets = {0};
+    if (mesh.indices.empty() || mesh.meshlets.empty()) {
+        return;
+    }
+    // The DAG already picks a cut per meshlet from its error bounds (meshletLodSelected); a flat chain on top
+    // would swap that cut for a fixed mesh below a screen size.
+    if (std::ranges::any_of(mesh.meshlets, [](const MeshletDesc& meshlet) { return meshlet.lodLevel != 0; })) {
+        return;
+    }
 
-    return draw;
+    struct DiscreteLod
+    {
+        float ratio = 1.0f;
+        size_t triangleCount = 0;
+        MeshletChunk clusters;
+    };
+    std::vector<DiscreteLod> lods;
+    for (uint32_t lod = 1; lod < kMaxMeshLods; ++lod) {
+        lods.push_back(DiscreteLod{.ratio = kMeshLodRatios[lod]});
+    }
+
+    // Every LOD simplifies the source independently, so they run in parallel; borders of open meshes stay put.
+    parallelForEach(lods, "BuildDiscreteLods",
+                    [&mesh](DiscreteLod& lod)
+                    {
+                        ZoneScopedN("AssetsLoader::simplifyDiscreteLod");
+                        const size_t target = static_cast<size_t>(static_cast<float>(mesh.indices.size() / 3) *
+                                                                  lod.ratio) * 3;
+                        std::vector<uint32_t> simplified(mesh.indices.size());
+                        simplified.resize(meshopt_simplify(simplified.data(), mesh.indices.data(),
+                                                           mesh.indices.size(), &mesh.vertices[0].pos.x,
+                                                           mesh.vertices.size(), sizeof(Vertex), target, 1.0f,
+                                                           meshopt_SimplifyLockBorder, nullptr));
+                        lod.triangleCount = simplified.size() / 3;
+                        buildClusters(mesh.vertices, simplified.data(), simplified.size(), lod.clusters);
+                    });
+
+    // Serial, finest first: coarse meshlets keep the default LOD fields, so the cluster LOD test always
+    // passes for them.
+    size_t previousTriangles = mesh.indices.size() / 3;
+    std::string perLod = std::format("{}", previousTriangles);
+    for (const DiscreteLod& lod : lods) {
+        const auto required =
+            static_cast<size_t>(static_cast<float>(previousTriangles) * (1.0f - kMeshLodMinReduction));
+        if (lod.clusters.meshlets.empty() || lod.triangleCount > required) {
+            break;
+        }
+        mesh.lodFirstMeshlets.push_back(static_cast<uint32_t>(mesh.meshlets.size()));
+        appendChunk(mesh, lod.clusters);
+        previousTriangles = lod.triangleCount;
+        perLod += std::format(" / {}", lod.triangleCount);
+    }
+    log_info(std::format("Built {} discrete LODs for {} | triangles per LOD: {}", mesh.lodFirstMeshlets.size(),
+                         mesh.path, perLod),
+             "AssetLoader");
 }
 
-bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
+bool AssetsLoader::loadGltfModel(const std::string& modelPath, ImportedMesh& mesh)
 {
     ZoneScopedN("AssetsLoader::loadGltfModel");
     // glTF uses forward-slash URIs internally; normalise the base path
@@ -299,14 +860,11 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
 
     log_info(std::format("Loading glTF: {} meshes, {} nodes", model.meshes_count, model.nodes_count), "AssetLoader");
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    uint32_t indexCount = 0;
-
     for (uint32_t mi = 0; mi < model.meshes_count; ++mi) {
-        const tg3_mesh& mesh = model.meshes[mi];
+        const tg3_mesh& gltfMesh = model.meshes[mi];
 
-        for (uint32_t pi = 0; pi < mesh.primitives_count; ++pi) {
-            const tg3_primitive& prim = mesh.primitives[pi];
+        for (uint32_t pi = 0; pi < gltfMesh.primitives_count; ++pi) {
+            const tg3_primitive& prim = gltfMesh.primitives[pi];
 
             int32_t posAcc = -1;
             int32_t tcAcc = -1;
@@ -327,6 +885,7 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
             if (positions.empty())
                 continue;
 
+            mesh.primitiveFirstIndex.push_back(static_cast<uint32_t>(mesh.indices.size()));
             const std::vector<float> texcoords = readAccessorFloats(model, tcAcc);
             const std::vector<uint32_t> idxData = readAccessorIndices(model, idxAcc);
 
@@ -335,10 +894,8 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
                 tcAcc >= 0 ? static_cast<uint32_t>(tg3_num_components(model.accessors[tcAcc].type)) : 0;
             const uint32_t vertexCount = model.accessors[posAcc].count;
 
-            auto emitVertex = [&](uint32_t vi) -> void
-            {
-                if (vi >= vertexCount)
-                    return;
+            const auto baseVertex = static_cast<uint32_t>(mesh.vertices.size());
+            for (uint32_t vi = 0; vi < vertexCount; ++vi) {
                 Vertex vertex{};
                 vertex.pos = {positions[vi * posComps + 0], positions[vi * posComps + 1],
                               posComps >= 3 ? positions[vi * posComps + 2] : 0.0f};
@@ -346,22 +903,30 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
                     vertex.texCoord = {texcoords[vi * tcComps + 0], 1.0f - texcoords[vi * tcComps + 1]};
                 }
                 vertex.color = {1.0f, 1.0f, 1.0f};
-
-                if (!uniqueVertices.contains(vertex)) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-                indices.push_back(uniqueVertices[vertex]);
-                ++indexCount;
-            };
+                mesh.vertices.push_back(vertex);
+            }
 
             if (!idxData.empty()) {
-                for (const uint32_t vid : idxData) {
-                    emitVertex(vid);
+                // Already indexed by the exporter: taken as is, no second dedup pass. Triangles that
+                // reference missing vertices are dropped.
+                for (size_t corner = 0; corner + 2 < idxData.size(); corner += 3) {
+                    const uint32_t a = idxData[corner], b = idxData[corner + 1], c = idxData[corner + 2];
+                    if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+                        continue;
+                    }
+                    mesh.indices.insert(mesh.indices.end(), {baseVertex + a, baseVertex + b, baseVertex + c});
                 }
             } else {
-                for (uint32_t vid = 0; vid < vertexCount; ++vid) {
-                    emitVertex(vid);
+                // Unindexed: every three vertices are a triangle. Weld bitwise-identical corners in place.
+                const size_t cornerCount = vertexCount / 3 * 3;
+                Vertex* corners = mesh.vertices.data() + baseVertex;
+                std::vector<uint32_t> remap(cornerCount);
+                const size_t uniqueCount = meshopt_generateVertexRemap(remap.data(), nullptr, cornerCount, corners,
+                                                                       cornerCount, sizeof(Vertex));
+                meshopt_remapVertexBuffer(corners, corners, cornerCount, sizeof(Vertex), remap.data());
+                mesh.vertices.resize(baseVertex + uniqueCount);
+                for (const uint32_t vertex : remap) {
+                    mesh.indices.push_back(baseVertex + vertex);
                 }
             }
         }
@@ -370,25 +935,16 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
     // Resolve the glTF image URI relative to the model file's directory.
     // Embedded images (bufferView / data URI) are not handled here — the
     // texture manager would receive an empty path and fail gracefully.
-    std::string imagePath;
     if (model.images_count > 0 && model.images[0].uri.data && model.images[0].uri.len > 0) {
         const std::string_view uri(model.images[0].uri.data, model.images[0].uri.len);
         if (!uri.starts_with("data:")) {
             const auto modelDir = std::filesystem::path(modelPath).parent_path();
-            imagePath = (modelDir / uri).string();
+            mesh.texturePath = (modelDir / uri).string();
         }
     }
-    const Transform transform{.position = glm::vec3{xyz[0], xyz[1], xyz[2]}};
-    const MeshletDraw meshletDraw = buildMeshletsForRange(currentIndex, indexCount);
-    const MaterialRef material{.textureIndex = textureManager.loadTexture(imagePath), .materialId = 0};
-    const EntityId id = objectStorage.create(transform, meshletDraw, material, modelPath);
-    log_info(std::format("Loaded model entity {} | index range [{}, {}) | meshlets: {} (first {})", id, currentIndex,
-                         currentIndex + indexCount, meshletDraw.meshletCount, meshletDraw.firstMeshlet),
-             "AssetLoader");
-    currentIndex += indexCount;
 
-    log_info(std::format("Model loaded (glTF): {} | vertices: {} | indices: {} | total meshlets: {}", modelPath,
-                         vertices.size(), indices.size(), meshlets.size()),
+    log_info(std::format("Parsed glTF: {} | vertices: {} | indices: {}", modelPath, mesh.vertices.size(),
+                         mesh.indices.size()),
              "AssetLoader");
 
     tg3_model_free(&model);
@@ -396,7 +952,7 @@ bool AssetsLoader::loadGltfModel(const std::string& modelPath, glm::vec3 xyz)
     return true;
 }
 
-bool AssetsLoader::loadObjModel(const std::string& modelPath, glm::vec3 xyz)
+bool AssetsLoader::loadObjModel(const std::string& modelPath, ImportedMesh& mesh)
 {
     ZoneScopedN("AssetsLoader::loadObjModel");
     log_info(std::format("Loading OBJ: {}", modelPath), "AssetLoader");
@@ -411,11 +967,12 @@ bool AssetsLoader::loadObjModel(const std::string& modelPath, glm::vec3 xyz)
         return false;
     }
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-    uint32_t indexCount = 0;
-
-    for (const auto& [name, mesh] : shapes) {
-        for (const auto& index : mesh.indices) {
+    // OBJ indexes position and texcoord separately: expand to one vertex per corner, then weld
+    // bitwise-identical corners with meshopt's remap table.
+    std::vector<Vertex> corners;
+    for (const auto& [name, shapeMesh] : shapes) {
+        mesh.primitiveFirstIndex.push_back(static_cast<uint32_t>(corners.size()));
+        for (const auto& index : shapeMesh.indices) {
             Vertex vertex{};
 
             vertex.pos = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1],
@@ -425,25 +982,18 @@ bool AssetsLoader::loadObjModel(const std::string& modelPath, glm::vec3 xyz)
                                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
 
             vertex.color = {1.0f, 1.0f, 1.0f};
-
-            if (!uniqueVertices.contains(vertex)) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            indices.push_back(uniqueVertices[vertex]);
-            indexCount++;
+            corners.push_back(vertex);
         }
     }
-    const Transform transform{.position = glm::vec3{xyz[0], xyz[1], xyz[2]}};
-    const MeshletDraw meshletDraw = buildMeshletsForRange(currentIndex, indexCount);
-    const MaterialRef material{.textureIndex = textureManager.loadTexture(TEXTURE_PATH.string()), .materialId = 0};
-    const EntityId id = objectStorage.create(transform, meshletDraw, material, modelPath);
-    log_info(std::format("Loaded model entity {} | index range [{}, {}) | meshlets: {} (first {})", id, currentIndex,
-                         currentIndex + indexCount, meshletDraw.meshletCount, meshletDraw.firstMeshlet),
-             "AssetLoader");
-    currentIndex += indexCount;
-    log_info(std::format("Model loaded (OBJ): {} | vertices: {} | indices: {} | total meshlets: {}", modelPath,
-                         vertices.size(), indices.size(), meshlets.size()),
+    mesh.indices.resize(corners.size());
+    const size_t uniqueCount = meshopt_generateVertexRemap(mesh.indices.data(), nullptr, corners.size(),
+                                                           corners.data(), corners.size(), sizeof(Vertex));
+    mesh.vertices.resize(uniqueCount);
+    meshopt_remapVertexBuffer(mesh.vertices.data(), corners.data(), corners.size(), sizeof(Vertex),
+                              mesh.indices.data());
+    mesh.texturePath = TEXTURE_PATH.string();
+    log_info(std::format("Parsed OBJ: {} | vertices: {} | indices: {}", modelPath, mesh.vertices.size(),
+                         mesh.indices.size()),
              "AssetLoader");
     return true;
 }
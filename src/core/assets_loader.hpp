@@ -1,42 +1,107 @@
 #pragma once
+#include <cstddef>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
+#include "geometry_pool.hpp"
+#include "mesh_cache.hpp"
 #include "object_storage.hpp"
 #include "texture_manager.hpp"
 #include "types.hpp"
 
 
+// CPU result of parsing one model: geometry with mesh-local indices plus its meshlets.
+// Self-contained so it can be built on a worker thread; allocateGeometry places it in the GeometryPool and
+// writeGeometry stages it from here.
+// On a mesh-cache hit the arrays stay empty and view() points into the mapped blob instead.
+struct ImportedMesh
+{
+    std::string path;
+    std::string texturePath;
+    glm::vec3 position{0.0f};
+
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> primitiveFirstIndex; // where each glTF primitive / OBJ shape starts in indices
+    std::vector<MeshletDesc> meshlets; // offsets into the two arrays below
+    std::vector<uint32_t> meshletVertices; // indices into vertices
+    std::vector<uint8_t> meshletTriangles;
+    std::vector<uint32_t> lodFirstMeshlets; // first meshlet of each discrete LOD (buildDiscreteLods)
+    glm::vec4 boundingSphere{0.0f};
+    std::optional<CachedMesh> cached;
+
+    // The cooked arrays, from the cache mapping or the vectors above.
+    [[nodiscard]] MeshView view() const;
+};
+
+// A mesh resident in the geometry pool. Every entity spawned from the same model path draws these ranges.
+struct MeshAsset
+{
+    GeometryRanges ranges;
+    MeshLodChain lods;
+    MaterialRef material;
+    std::string textureKey; // TextureManager key; the heap index in material changes when its mips stream
+    uint32_t instanceCount = 0; // live entities spawned from it; the mesh unloads when the last one is destroyed
+};
+
 class AssetsLoader
 {
 public:
     explicit AssetsLoader(ObjectStorage& objectStorage, TextureManager& textureManager);
     ~AssetsLoader() = default;
 
-    // Load a model into CPU mesh vectors and create a SoA entity in objectStorage.
-    void loadModel(std::string modelPath, glm::vec3 xyz);
-
-    void processVertexData(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes);
-    void loadMaterials(const std::string& path, const std::vector<tinyobj::material_t>& materials);
+    // Parse + meshlet build, or a mapped MeshCache blob when the source is unchanged. Touches no shared
+    // state, safe to run on jobExecutor() workers.
+    [[nodiscard]] static std::optional<ImportedMesh> importModel(const std::string& modelPath, glm::vec3 xyz);
+    // Main thread: sub-allocates the mesh's ranges in the geometry pool.
+    GeometryRanges allocateGeometry(const ImportedMesh& mesh);
+    // Writes geometry table `table` of mesh (ResourceManager::GeometryWriter order) as the device stores it at
+    // ranges: meshlet offsets rebased, vertices converted to GpuVertex. Fills staging memory directly.
+    static void writeGeometry(const ImportedMesh& mesh, const GeometryRanges& ranges, uint32_t table,
+                              std::byte* destination);
+    // Main thread: returns ranges no draw ever referenced (a duplicate upload) to the pool right away.
+    void releaseGeometry(const GeometryRanges& ranges);
+    // Main thread: loads the texture and records the mesh placed at `ranges` in loadedMeshes. A mesh that was
+    // registered meanwhile (same path streamed twice) keeps the first copy and `ranges` go back to the pool.
+    const MeshAsset& registerMesh(const ImportedMesh& mesh, const GeometryRanges& ranges);
+    // Main thread: one entity per transform sharing a resident mesh; returns the first id, or kInvalidEntityId
+    // when modelPath is not loaded. Without EntityFlag::Dynamic the entities are static (never re-uploaded).
+    EntityId spawnInstances(const std::string& modelPath, std::span<const Transform> transforms,
+                            uint32_t entityFlags = EntityFlag::Active | EntityFlag::Dynamic);
+    [[nodiscard]] const MeshAsset* findMesh(const std::string& modelPath) const;
+    // Main thread, once per frame: drops the mesh references of destroyed entities. A mesh no entity draws
+    // anymore leaves loadedMeshes and its ranges are retired (GeometryPool::retire), so a later load of the
+    // same path streams it again.
+    void releaseDestroyedMeshes();
 
-    // Mesh data (direct access after load)
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-
-    // Meshlet data (CPU only for now; GPU upload later)
-    std::vector<MeshletDesc> meshlets;
-    std::vector<uint32_t> meshletVertices;
-    std::vector<uint8_t> meshletTriangles;
+    // Ranges of every loaded mesh in the vertex + meshlet tables; ResourceManager owns the device tables.
+    GeometryPool geometry;
+    // Resident meshes by model path (as requested), so repeated loads share one copy of the geometry.
+    std::unordered_map<std::string, MeshAsset> loadedMeshes;
 
     ObjectStorage& objectStorage;
     TextureManager& textureManager;
 
 private:
-    bool loadGltfModel(const std::string& modelPath, glm::vec3 xyz);
-    bool loadObjModel(const std::string& modelPath, glm::vec3 xyz);
+    std::vector<uint32_t> destroyedNames; // reused ObjectStorage::takeDestroyedNames buffer
 
-    // Builds meshlets for indices[firstIndex, firstIndex + indexCount) into the global meshlet arrays.
-    [[nodiscard]] MeshletDraw buildMeshletsForRange(uint32_t firstIndex, uint32_t indexCount);
+    static bool loadGltfModel(const std::string& modelPath, ImportedMesh& mesh);
+    static bool loadObjModel(const std::string& modelPath, ImportedMesh& mesh);
 
-    uint32_t currentIndex = 0;
+    // Reorders triangles for the post-transform cache (and overdraw) and vertices for fetch locality; logs
+    // ACMR / overfetch before and after. Level set by ENGINE_MESH_OPTIMIZE.
+    static void optimizeMesh(ImportedMesh& mesh);
+    // Builds meshlets (and the whole-mesh bounding sphere) for mesh.indices: one jobExecutor() task per
+    // primitive, or per spatial chunk of a large primitive, concatenated in chunk order.
+    static void buildMeshlets(ImportedMesh& mesh);
+    // Appends coarser LOD levels: groups of meshlets are merged, simplified with borders locked and
+    // re-clustered until nothing simplifies further. Fills the MeshletDesc LOD fields of every level.
+    static void buildMeshletLods(ImportedMesh& mesh);
+    // Fallback for meshes without a cluster LOD DAG (too few meshlets, nothing simplified): appends discrete
+    // LODs 1..kMaxMeshLods-1, the whole mesh simplified to kMeshLodRatios[i] and clustered again. Stops at the
+    // first ratio that no longer shrinks the mesh; fills mesh.lodFirstMeshlets.
+    static void buildDiscreteLods(ImportedMesh& mesh);
 };
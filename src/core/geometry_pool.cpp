@@ -0,0 +1,144 @@
+#include "geometry_pool.hpp"
+#include "../Constants.h"
+#include "util/vk_tracy.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    // Grows the arena by at least half its size so a stream of loads reallocates O(log n) times.
+    uint32_t allocateRange(RangeAllocator& ranges, uint32_t count)
+    {
+        if (count == 0) {
+            return 0;
+        }
+        uint32_t offset = ranges.allocate(count);
+        if (offset == RangeAllocator::kInvalidOffset) {
+            ranges.grow(ranges.capacity() + std::max(count, ranges.capacity() / 2));
+            offset = ranges.allocate(count);
+        }
+        assert(offset != RangeAllocator::kInvalidOffset);
+        return offset;
+    }
+} // anonymous namespace
+
+// ── RangeAllocator ──────────────────────────────────────────
+
+uint32_t RangeAllocator::allocate(uint32_t count)
+{
+    if (count == 0) {
+        return kInvalidOffset;
+    }
+    const auto bestFit = freeBySize.lower_bound(count);
+    if (bestFit == freeBySize.end()) {
+        return kInvalidOffset;
+    }
+
+    const uint32_t offset = bestFit->second;
+    const uint32_t freeCount = bestFit->first;
+    eraseFree(freeByOffset.find(offset));
+    if (freeCount > count) {
+        insertFree(offset + count, freeCount - count);
+    }
+    usedElements += count;
+    return offset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    assert(offset + count <= capacityCount);
+    assert(usedElements >= count);
+    usedElements -= count;
+
+    // Coalesce with the free neighbours on both sides.
+    auto next = freeByOffset.lower_bound(offset);
+    if (next != freeByOffset.end() && next->first == offset + count) {
+        count += next->second;
+        next = std::next(next);
+        eraseFree(std::prev(next));
+    }
+    if (next != freeByOffset.begin()) {
+        const auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            count += prev->second;
+            eraseFree(prev);
+        }
+    }
+    insertFree(offset, count);
+}
+
+void RangeAllocator::grow(uint32_t newCapacity)
+{
+    if (newCapacity <= capacityCount) {
+        return;
+    }
+    const uint32_t oldCapacity = capacityCount;
+    capacityCount = newCapacity;
+    // free() of the new tail would count it as released; add it as a free range directly instead.
+    usedElements += newCapacity - oldCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::insertFree(uint32_t offset, uint32_t count)
+{
+    freeByOffset.emplace(offset, count);
+    freeBySize.emplace(count, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<uint32_t, uint32_t>::iterator it)
+{
+    auto [first, last] = freeBySize.equal_range(it->second);
+    for (; first != last; ++first) {
+        if (first->second == it->first) {
+            freeBySize.erase(first);
+            break;
+        }
+    }
+    freeByOffset.erase(it);
+}
+
+// ── GeometryPool ────────────────────────────────────────────
+
+GeometryRanges GeometryPool::allocate(uint32_t vertexCount, uint32_t meshletCount, uint32_t meshletVertexCount,
+                                      uint32_t meshletTriangleCount)
+{
+    ZoneScopedN("GeometryPool::allocate");
+    return GeometryRanges{
+        .firstVertex = allocateRange(vertexRanges, vertexCount),
+        .vertexCount = vertexCount,
+        .firstMeshlet = allocateRange(meshletRanges, meshletCount),
+        .meshletCount = meshletCount,
+        .firstMeshletVertex = allocateRange(meshletVertexRanges, meshletVertexCount),
+        .meshletVertexCount = meshletVertexCount,
+        .firstMeshletTriangle = allocateRange(meshletTriangleRanges, meshletTriangleCount),
+        .meshletTriangleCount = meshletTriangleCount,
+    };
+}
+
+void GeometryPool::release(const GeometryRanges& ranges)
+{
+    ZoneScopedN("GeometryPool::release");
+    vertexRanges.free(ranges.firstVertex, ranges.vertexCount);
+    meshletRanges.free(ranges.firstMeshlet, ranges.meshletCount);
+    meshletVertexRanges.free(ranges.firstMeshletVertex, ranges.meshletVertexCount);
+    meshletTriangleRanges.free(ranges.firstMeshletTriangle, ranges.meshletTriangleCount);
+}
+
+void GeometryPool::retire(const GeometryRanges& ranges)
+{
+    retiredRanges.push_back({.ranges = ranges, .releaseFrame = frameCounter + MAX_FRAMES_IN_FLIGHT});
+}
+
+void GeometryPool::releaseRetired()
+{
+    ++frameCounter;
+    while (!retiredRanges.empty() && retiredRanges.front().releaseFrame <= frameCounter) {
+        release(retiredRanges.front().ranges);
+        retiredRanges.pop_front();
+    }
+}
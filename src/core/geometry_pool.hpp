@@ -0,0 +1,70 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+
+// ---------------------------------------------------------------------------
+// Best-fit range allocator over [0, capacity) elements. Free ranges are indexed by
+// offset (neighbour coalescing on free) and by size (best-fit lookup), both O(log n).
+// ---------------------------------------------------------------------------
+class RangeAllocator
+{
+public:
+    static constexpr uint32_t kInvalidOffset = ~0u;
+
+    // Returns kInvalidOffset when no free range holds count elements.
+    [[nodiscard]] uint32_t allocate(uint32_t count);
+    void free(uint32_t offset, uint32_t count);
+    // Extends the managed range; the new tail is free and merges with a free range ending at the old capacity.
+    void grow(uint32_t newCapacity);
+
+    [[nodiscard]] uint32_t capacity() const noexcept { return capacityCount; }
+    [[nodiscard]] uint32_t usedCount() const noexcept { return usedElements; }
+    [[nodiscard]] uint32_t freeRangeCount() const noexcept { return static_cast<uint32_t>(freeByOffset.size()); }
+
+private:
+    void insertFree(uint32_t offset, uint32_t count);
+    void eraseFree(std::map<uint32_t, uint32_t>::iterator it);
+
+    std::map<uint32_t, uint32_t> freeByOffset; // offset -> count
+    std::multimap<uint32_t, uint32_t> freeBySize; // count -> offset
+    uint32_t capacityCount = 0;
+    uint32_t usedElements = 0;
+};
+
+// ---------------------------------------------------------------------------
+// GeometryPool — range bookkeeping of the mesh-shader geometry arenas. Each mesh gets
+// stable sub-ranges of the vertex and meshlet tables for its lifetime. There is no CPU
+// copy of the contents: ResourceManager sizes its device-local tables to the allocator
+// capacities and a load stages its ranges straight from the ImportedMesh.
+// ---------------------------------------------------------------------------
+class GeometryPool
+{
+public:
+    [[nodiscard]] GeometryRanges allocate(uint32_t vertexCount, uint32_t meshletCount, uint32_t meshletVertexCount,
+                                          uint32_t meshletTriangleCount);
+    // Returns ranges no draw ever referenced (a duplicate upload) to the allocators right away.
+    void release(const GeometryRanges& ranges);
+    // Returns a mesh's ranges once MAX_FRAMES_IN_FLIGHT more frames were submitted: until then a frame in flight
+    // may still draw from them, and a new upload must not overwrite them.
+    void retire(const GeometryRanges& ranges);
+    // Counts a graphics submission and releases the ranges retired MAX_FRAMES_IN_FLIGHT submissions ago.
+    void releaseRetired();
+
+    RangeAllocator vertexRanges;
+    RangeAllocator meshletRanges;
+    RangeAllocator meshletVertexRanges;
+    RangeAllocator meshletTriangleRanges;
+
+private:
+    struct RetiredRanges
+    {
+        GeometryRanges ranges;
+        uint64_t releaseFrame = 0;
+    };
+    std::deque<RetiredRanges> retiredRanges;
+    uint64_t frameCounter = 0;
+};
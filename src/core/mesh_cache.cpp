@@ -0,0 +1,203 @@
+#include "mesh_cache.hpp"
+#include "../Constants.h"
+#include "../static_headers/logger.hpp"
+#include "../util/content_hash.hpp"
+#include "../util/vk_tracy.hpp"
+
+#include <array>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+namespace
+{
+    constexpr uint32_t kMagic = 0x4348534Du; // "MSHC"
+    constexpr uint64_t kSectionAlignment = 16;
+
+    // Blob = header, then 16 B-aligned sections: vertices, meshlets, meshlet vertices, meshlet triangles,
+    // discrete LOD starts, texture path (UTF-8, not terminated). Native endianness and struct layout, guarded by the strides.
+    struct BlobHeader
+    {
+        uint32_t magic = kMagic;
+        uint32_t version = MeshCache::kVersion;
+        uint64_t key = 0;
+        uint32_t vertexStride = sizeof(Vertex);
+        uint32_t meshletStride = sizeof(MeshletDesc);
+        uint32_t vertexCount = 0;
+        uint32_t meshletCount = 0;
+        uint32_t meshletVertexCount = 0;
+        uint32_t meshletTriangleCount = 0;
+        uint32_t texturePathBytes = 0;
+        uint32_t lodCount = 0;
+        glm::vec4 boundingSphere{0.0f};
+        uint64_t verticesOffset = 0;
+        uint64_t meshletsOffset = 0;
+        uint64_t meshletVerticesOffset = 0;
+        uint64_t meshletTrianglesOffset = 0;
+        uint64_t lodsOffset = 0;
+        uint64_t texturePathOffset = 0;
+        uint64_t fileBytes = 0;
+    };
+    static_assert(std::is_trivially_copyable_v<BlobHeader>);
+
+    constexpr uint64_t alignSection(uint64_t offset)
+    {
+        return (offset + kSectionAlignment - 1) & ~(kSectionAlignment - 1);
+    }
+
+    // Fills the section offsets from the counts; load() recomputes them to reject inconsistent headers.
+    void layoutSections(BlobHeader& header)
+    {
+        uint64_t offset = alignSection(sizeof(BlobHeader));
+        header.verticesOffset = offset;
+        offset = alignSection(offset + uint64_t{header.vertexCount} * sizeof(Vertex));
+        header.meshletsOffset = offset;
+        offset = alignSection(offset + uint64_t{header.meshletCount} * sizeof(MeshletDesc));
+        header.meshletVerticesOffset = offset;
+        offset = alignSection(offset + uint64_t{header.meshletVertexCount} * sizeof(uint32_t));
+        header.meshletTrianglesOffset = offset;
+        offset = alignSection(offset + uint64_t{header.meshletTriangleCount} * sizeof(uint8_t));
+        header.lodsOffset = offset;
+        offset = alignSection(offset + uint64_t{header.lodCount} * sizeof(uint32_t));
+        header.texturePathOffset = offset;
+        header.fileBytes = offset + header.texturePathBytes;
+    }
+
+    template <typename T>
+    std::span<const T> section(const std::byte* base, uint64_t offset, uint32_t count)
+    {
+        return {reinterpret_cast<const T*>(base + offset), count};
+    }
+
+    template <typename T>
+    bool writeSection(std::ofstream& out, uint64_t offset, std::span<const T> data)
+    {
+        const auto position = static_cast<uint64_t>(out.tellp());
+        static constexpr std::array<char, kSectionAlignment> kPadding{};
+        out.write(kPadding.data(), static_cast<std::streamsize>(offset - position));
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size_bytes()));
+        return out.good();
+    }
+} // anonymous namespace
+
+uint64_t MeshCache::sourceKey(const std::filesystem::path& source)
+{
+    ZoneScopedN("MeshCache::sourceKey");
+    const std::optional<MappedFile> file = MappedFile::open(source);
+    if (!file) {
+        return 0;
+    }
+    // The absolute path is part of the key: cooked texture paths are resolved against the model's directory.
+    std::error_code error;
+    const std::string location = std::filesystem::absolute(source, error).generic_string();
+    // Cooker settings go into the seed too, so changing them recooks instead of loading stale blobs.
+    constexpr uint64_t settingsSeed = MeshCache::kVersion | uint64_t{ENGINE_MESH_OPTIMIZE} << 32;
+    const uint64_t pathHash = hashBytes(std::as_bytes(std::span(location.data(), location.size())), settingsSeed);
+    const uint64_t key = hashBytes(file->bytes(), pathHash);
+    return key != 0 ? key : 1;
+}
+
+std::filesystem::path MeshCache::blobPath(uint64_t key)
+{
+    return MESH_CACHE_DIR / std::format("{:016x}.meshc", key);
+}
+
+std::optional<CachedMesh> MeshCache::load(uint64_t key)
+{
+    ZoneScopedN("MeshCache::load");
+    const std::filesystem::path path = blobPath(key);
+    std::optional<MappedFile> file = MappedFile::open(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    const std::span<const std::byte> bytes = file->bytes();
+    BlobHeader header;
+    if (bytes.size() < sizeof(BlobHeader)) {
+        log_error(std::format("Mesh cache blob {} is truncated, recooking", path.string()), "MeshCache");
+        return std::nullopt;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(BlobHeader));
+    if (header.magic != kMagic || header.version != kVersion || header.key != key ||
+        header.vertexStride != sizeof(Vertex) || header.meshletStride != sizeof(MeshletDesc)) {
+        log_info(std::format("Mesh cache blob {} is stale (version {}), recooking", path.string(), header.version),
+                 "MeshCache");
+        return std::nullopt;
+    }
+    BlobHeader expected = header;
+    layoutSections(expected);
+    if (std::memcmp(&expected, &header, sizeof(BlobHeader)) != 0 || header.fileBytes != bytes.size()) {
+        log_error(std::format("Mesh cache blob {} has an inconsistent layout, recooking", path.string()),
+                  "MeshCache");
+        return std::nullopt;
+    }
+
+    // The spans point into the mapping, which stays put when the MappedFile is moved.
+    const std::byte* base = bytes.data();
+    return CachedMesh{
+        .file = std::move(*file),
+        .view =
+            MeshView{
+                .vertices = section<Vertex>(base, header.verticesOffset, header.vertexCount),
+                .meshlets = section<MeshletDesc>(base, header.meshletsOffset, header.meshletCount),
+                .meshletVertices = section<uint32_t>(base, header.meshletVerticesOffset, header.meshletVertexCount),
+                .meshletTriangles =
+                    section<uint8_t>(base, header.meshletTrianglesOffset, header.meshletTriangleCount),
+                .lodFirstMeshlets = section<uint32_t>(base, header.lodsOffset, header.lodCount),
+            },
+        .texturePath = std::string(reinterpret_cast<const char*>(base + header.texturePathOffset),
+                                   header.texturePathBytes),
+        .boundingSphere = header.boundingSphere,
+    };
+}
+
+bool MeshCache::store(uint64_t key, const MeshView& mesh, const std::string& texturePath,
+                      const glm::vec4& boundingSphere)
+{
+    ZoneScopedN("MeshCache::store");
+    BlobHeader header{
+        .key = key,
+        .vertexCount = static_cast<uint32_t>(mesh.vertices.size()),
+        .meshletCount = static_cast<uint32_t>(mesh.meshlets.size()),
+        .meshletVertexCount = static_cast<uint32_t>(mesh.meshletVertices.size()),
+        .meshletTriangleCount = static_cast<uint32_t>(mesh.meshletTriangles.size()),
+        .texturePathBytes = static_cast<uint32_t>(texturePath.size()),
+        .lodCount = static_cast<uint32_t>(mesh.lodFirstMeshlets.size()),
+        .boundingSphere = boundingSphere,
+    };
+    layoutSections(header);
+
+    const std::filesystem::path path = blobPath(key);
+    // Unique per thread: two workers cooking the same model must not interleave writes.
+    const std::filesystem::path temporary = std::filesystem::path(path).concat(
+        std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    std::error_code error;
+    std::filesystem::create_directories(MESH_CACHE_DIR, error);
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        const bool written = out.is_open() &&
+            out.write(reinterpret_cast<const char*>(&header), sizeof(BlobHeader)).good() &&
+            writeSection(out, header.verticesOffset, mesh.vertices) &&
+            writeSection(out, header.meshletsOffset, mesh.meshlets) &&
+            writeSection(out, header.meshletVerticesOffset, mesh.meshletVertices) &&
+            writeSection(out, header.meshletTrianglesOffset, mesh.meshletTriangles) &&
+            writeSection(out, header.lodsOffset, mesh.lodFirstMeshlets) &&
+            writeSection(out, header.texturePathOffset, std::span(texturePath.data(), texturePath.size()));
+        if (!written) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            log_error(std::format("Failed to write mesh cache blob {}", temporary.string()), "MeshCache");
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        log_error(std::format("Failed to publish mesh cache blob {}", path.string()), "MeshCache");
+        return false;
+    }
+    log_info(std::format("Cooked {} ({} bytes)", path.string(), header.fileBytes), "MeshCache");
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include "types.hpp"
+#include "../util/mapped_file.hpp"
+
+// Cooked arrays of one mesh with mesh-local offsets, viewed from wherever they live.
+struct MeshView
+{
+    std::span<const Vertex> vertices;
+    std::span<const MeshletDesc> meshlets;
+    std::span<const uint32_t> meshletVertices;
+    std::span<const uint8_t> meshletTriangles;
+    std::span<const uint32_t> lodFirstMeshlets; // first meshlet of each discrete LOD, LOD 0 first
+};
+
+// A cache hit: the blob stays mapped while `view` is in use.
+struct CachedMesh
+{
+    MappedFile file;
+    MeshView view;
+    std::string texturePath;
+    glm::vec4 boundingSphere{0.0f};
+};
+
+// Versioned binary blobs of cooked meshes (vertices, meshlet tables, LOD ranges, material refs) under MESH_CACHE_DIR,
+// named by a hash of the source file's path and contents. A hit is memory-mapped and read in place, so
+// loading skips parsing, vertex deduplication and meshlet building. Thread-safe: stores go through a
+// temporary file and an atomic rename.
+class MeshCache
+{
+public:
+    // Bump whenever the blob layout or anything the cooker produces changes; older blobs become misses.
+    static constexpr uint32_t kVersion = 5;
+
+    // 0 when the source cannot be read (the cache is then bypassed).
+    [[nodiscard]] static uint64_t sourceKey(const std::filesystem::path& source);
+    [[nodiscard]] static std::filesystem::path blobPath(uint64_t key);
+
+    // nullopt on a miss or a stale / truncated / foreign blob.
+    [[nodiscard]] static std::optional<CachedMesh> load(uint64_t key);
+    static bool store(uint64_t key, const MeshView& mesh, const std::string& texturePath,
+                      const glm::vec4& boundingSphere);
+};
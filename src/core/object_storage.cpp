@@ -1,42 +1,326 @@
 #include "object_storage.hpp"
+#include "util/jobs.hpp"
 #include "util/vk_tracy.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <format>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Task ranges are whole arena chunks (kEntityChunkSize entities): below that, task overhead outweighs the
+// parallel matrix work, and no two tasks share a cache line of the byte columns.
+// The device ObjectUB array is shared by every frame slot: a moved entity is uploaded in the frame it moved and
+// once more, so prevModelMatrix == modelMatrix once it stops.
+constexpr uint8_t kTransformUbWrites = 2;
+constexpr uint8_t kObjectUbWrites = 1;
+
+// T * Rx * Ry * Rz * S written out: columns of R scaled per axis, translation in column 3.
+glm::mat4 composeTrs(const Transform& transform)
+{
+    const float sx = std::sin(transform.rotation.x);
+    const float cx = std::cos(transform.rotation.x);
+    const float sy = std::sin(transform.rotation.y);
+    const float cy = std::cos(transform.rotation.y);
+    const float sz = std::sin(transform.rotation.z);
+    const float cz = std::cos(transform.rotation.z);
+    return glm::mat4{
+        glm::vec4{cy * cz, cx * sz + sx * sy * cz, sx * sz - cx * sy * cz, 0.0f} * transform.scale.x,
+        glm::vec4{-cy * sz, cx * cz - sx * sy * sz, sx * cz + cx * sy * sz, 0.0f} * transform.scale.y,
+        glm::vec4{sy, -sx * cy, cx * cy, 0.0f} * transform.scale.z,
+        glm::vec4{transform.position, 1.0f},
+    };
+}
+
+#if defined(__AVX2__)
+// Eight entities in SoA lanes: sin/cos stay scalar (no AVX2 instruction for them), the composition and the
+// meshPreRotation product run eight wide; results are transposed back into the mat4 column.
+void computeModelMatrices8(const EntityColumn<Transform>& transforms, const EntityId* ids,
+                           EntityColumn<glm::mat4>& models, const glm::mat4& post)
+{
+    alignas(32) float lanes[12][8];
+    for (uint32_t lane = 0; lane < 8; ++lane) {
+        const Transform& transform = transforms[ids[lane]];
+        lanes[0][lane] = std::sin(transform.rotation.x);
+        lanes[1][lane] = std::cos(transform.rotation.x);
+        lanes[2][lane] = std::sin(transform.rotation.y);
+        lanes[3][lane] = std::cos(transform.rotation.y);
+        lanes[4][lane] = std::sin(transform.rotation.z);
+        lanes[5][lane] = std::cos(transform.rotation.z);
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            lanes[6 + axis][lane] = transform.scale[axis];
+            lanes[9 + axis][lane] = transform.position[axis];
+        }
+    }
+    const __m256 sx = _mm256_load_ps(lanes[0]);
+    const __m256 cx = _mm256_load_ps(lanes[1]);
+    const __m256 sy = _mm256_load_ps(lanes[2]);
+    const __m256 cy = _mm256_load_ps(lanes[3]);
+    const __m256 sz = _mm256_load_ps(lanes[4]);
+    const __m256 cz = _mm256_load_ps(lanes[5]);
+    const __m256 scaleX = _mm256_load_ps(lanes[6]);
+    const __m256 scaleY = _mm256_load_ps(lanes[7]);
+    const __m256 scaleZ = _mm256_load_ps(lanes[8]);
+    const __m256 sxsy = _mm256_mul_ps(sx, sy);
+    const __m256 cxsy = _mm256_mul_ps(cx, sy);
+
+    // trs[column][row] for rows 0..2; row 3 is (0, 0, 0, 1).
+    __m256 trs[4][3];
+    trs[0][0] = _mm256_mul_ps(_mm256_mul_ps(cy, cz), scaleX);
+    trs[0][1] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, sz), _mm256_mul_ps(sxsy, cz)), scaleX);
+    trs[0][2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sx, sz), _mm256_mul_ps(cxsy, cz)), scaleX);
+    trs[1][0] = _mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(cy, sz)), scaleY);
+    trs[1][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cx, cz), _mm256_mul_ps(sxsy, sz)), scaleY);
+    trs[1][2] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sx, cz), _mm256_mul_ps(cxsy, sz)), scaleY);
+    trs[2][0] = _mm256_mul_ps(sy, scaleZ);
+    trs[2][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(sx, cy)), scaleZ);
+    trs[2][2] = _mm256_mul_ps(_mm256_mul_ps(cx, cy), scaleZ);
+    trs[3][0] = _mm256_load_ps(lanes[9]);
+    trs[3][1] = _mm256_load_ps(lanes[10]);
+    trs[3][2] = _mm256_load_ps(lanes[11]);
+
+    // (trs * post)[column][row] = sum_k trs[k][row] * post[column][k]; row 3 is post[column][3].
+    alignas(32) float result[4][3][8];
+    for (uint32_t column = 0; column < 4; ++column) {
+        for (uint32_t row = 0; row < 3; ++row) {
+            __m256 sum = _mm256_mul_ps(trs[3][row], _mm256_set1_ps(post[column][3]));
+            for (uint32_t k = 0; k < 3; ++k) {
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(trs[k][row], _mm256_set1_ps(post[column][k])));
+            }
+            _mm256_store_ps(result[column][row], sum);
+        }
+    }
+    for (uint32_t lane = 0; lane < 8; ++lane) {
+        glm::mat4& model = models[ids[lane]];
+        for (uint32_t column = 0; column < 4; ++column) {
+            model[column] = glm::vec4{result[column][0][lane], result[column][1][lane], result[column][2][lane],
+                                      post[column][3]};
+        }
+    }
+}
+#endif
+
+struct ObjectUbUploadStats
+{
+    uint32_t recomputed = 0;
+    uint32_t uploads = 0;
+};
+
+// Pass 1 over an entity chunk: recompute the dirty matrices, count the active entities owing an upload.
+ObjectUbUploadStats recomputeRange(ObjectStorage& storage, const glm::mat4& meshPreRotation, EntityId first,
+                                   EntityId end)
+{
+    std::vector<EntityId> dirty;
+    for (EntityId id = first; id < end; ++id) {
+        if ((storage.flags[id] & EntityFlag::Active) != 0 && storage.transformDirty[id] != 0) {
+            dirty.push_back(id);
+        }
+    }
+    computeModelMatrices(storage.transforms, dirty, storage.modelMatrices, meshPreRotation);
+    for (const EntityId id : dirty) {
+        storage.transformDirty[id] = 0;
+        storage.boundsDirty[id] = 1;
+        storage.pendingUbWrites[id] = kTransformUbWrites;
+    }
 
-EntityId ObjectStorage::create(const Transform& transform, const MeshletDraw& meshletDraw,
+    ObjectUbUploadStats stats{.recomputed = static_cast<uint32_t>(dirty.size())};
+    for (EntityId id = first; id < end; ++id) {
+        if ((storage.flags[id] & EntityFlag::Active) != 0 && storage.pendingUbWrites[id] != 0) {
+            ++stats.uploads;
+        }
+    }
+    return stats;
+}
+
+// Pass 2: the chunk's uploads, packed from entry `offset` on (the prefix sum of the earlier chunks' counts).
+void writeUploadRange(ObjectStorage& storage, std::span<ObjectUB> uploads, std::span<uint32_t> uploadIndices,
+                      uint32_t offset, EntityId first, EntityId end)
+{
+    for (EntityId id = first; id < end; ++id) {
+        if ((storage.flags[id] & EntityFlag::Active) == 0 || storage.pendingUbWrites[id] == 0) {
+            continue;
+        }
+        const glm::mat4& model = storage.modelMatrices[id];
+        uploads[offset] = ObjectUB{
+            .modelMatrix = model,
+            .prevModelMatrix = storage.prevModelMatrices[id],
+            .boundingSphere = transformBoundingSphere(model, storage.meshletDraws[id].boundingSphere),
+            .meshBounds = storage.meshLods[id].lods[0].boundingSphere,
+            .materialID = storage.materials[id].materialId,
+            .instanceFlags = storage.flags[id],
+        };
+        uploadIndices[offset] = id;
+        ++offset;
+        storage.prevModelMatrices[id] = model;
+        --storage.pendingUbWrites[id];
+    }
+}
+
+} // anonymous namespace
+
+EntityId ObjectStorage::create(const Transform& transform, const MeshLodChain& meshLodChain,
                                const MaterialRef& material, std::string_view name)
 {
-    const auto id = static_cast<EntityId>(transforms.size());
-    transforms.push_back(transform);
-    modelMatrices.emplace_back(1.0f);
-    prevModelMatrices.emplace_back(1.0f);
-    meshletDraws.push_back(meshletDraw);
-    materials.push_back(material);
-    flags.push_back(EntityFlag::Active | EntityFlag::Dynamic);
-    names.emplace_back(name);
+    return spawnInstances(std::span(&transform, 1), meshLodChain, material, name);
+}
+
+EntityId ObjectStorage::spawnInstances(std::span<const Transform> instanceTransforms,
+                                       const MeshLodChain& meshLodChain, const MaterialRef& material,
+                                       std::string_view name, uint32_t entityFlags)
+{
+    ZoneScopedN("ObjectStorage::spawnInstances");
+    const MeshletDraw& meshletDraw = meshLodChain.lods[0];
+    const EntityId firstId = arena->count;
+    const auto newSize = static_cast<uint32_t>(firstId + instanceTransforms.size());
+    reserveChunks(newSize);
+    arena->count = newSize;
+
+    // Filled chunk block by chunk block, each column a contiguous run.
+    for (EntityId id = firstId; id < newSize;) {
+        const uint32_t chunk = id >> kEntityChunkShift;
+        const uint32_t first = id & (kEntityChunkSize - 1);
+        const uint32_t n = std::min(kEntityChunkSize - first, newSize - id);
+        std::copy_n(instanceTransforms.begin() + (id - firstId), n, transforms.chunk(chunk) + first);
+        std::fill_n(modelMatrices.chunk(chunk) + first, n, glm::mat4{1.0f});
+        std::fill_n(prevModelMatrices.chunk(chunk) + first, n, glm::mat4{1.0f});
+        std::fill_n(meshletDraws.chunk(chunk) + first, n, meshletDraw);
+        std::fill_n(meshLods.chunk(chunk) + first, n, meshLodChain);
+        std::fill_n(materials.chunk(chunk) + first, n, material);
+        std::fill_n(flags.chunk(chunk) + first, n, entityFlags);
+        std::fill_n(transformDirty.chunk(chunk) + first, n, uint8_t{1});
+        std::fill_n(pendingUbWrites.chunk(chunk) + first, n, uint8_t{0});
+        std::fill_n(boundsDirty.chunk(chunk) + first, n, uint8_t{1});
+        id += n;
+    }
+    nameIds.resize(newSize, names.intern(name));
+
+    denseSlots.reserve(newSize);
+    for (EntityId id = firstId; id < newSize; ++id) {
+        uint32_t slot = 0;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotToDense[slot] = id;
+        } else {
+            slot = static_cast<uint32_t>(slotGenerations.size());
+            slotGenerations.push_back(0);
+            slotToDense.push_back(id);
+        }
+        denseSlots.push_back(slot);
+    }
 
 #ifdef TRACY_ENABLE
     const std::string msg = std::format(
-        "Entity {} '{}' meshlets=[{}, {}) tex={}", id, name, meshletDraw.firstMeshlet,
-        meshletDraw.firstMeshlet + meshletDraw.meshletCount, material.textureIndex);
+        "Entities [{}, {}) '{}' meshlets=[{}, {}) lods={} tex={}", firstId, newSize, name, meshletDraw.firstMeshlet,
+        meshletDraw.firstMeshlet + meshletDraw.meshletCount, meshLodChain.lodCount, material.textureIndex);
     TracyMessage(msg.c_str(), msg.size());
 #endif
 
+    return firstId;
+}
+
+uint32_t StringTable::intern(std::string_view text)
+{
+    if (const auto it = ids.find(text); it != ids.end()) {
+        return it->second;
+    }
+    const auto id = static_cast<uint32_t>(strings.size());
+    const std::string& stored = strings.emplace_back(text);
+    ids.emplace(stored, id);
     return id;
 }
 
-void ObjectStorage::clear() noexcept
+bool ObjectStorage::destroy(EntityHandle entity)
+{
+    const EntityId id = find(entity);
+    if (id == kInvalidEntityId) {
+        return false;
+    }
+    destroyedNameIds.push_back(nameIds[id]);
+    const EntityId last = size() - 1;
+    if (id != last) {
+        moveEntity(last, id);
+    }
+    --arena->count;
+    nameIds.pop_back();
+    denseSlots.pop_back();
+
+    destroyedHandles.push_back(entity);
+    ++slotGenerations[entity.slot];
+    slotToDense[entity.slot] = kInvalidEntityId;
+    freeSlots.push_back(entity.slot);
+    return true;
+}
+
+uint32_t ObjectStorage::destroy(std::span<const EntityHandle> handles)
+{
+    ZoneScopedN("ObjectStorage::destroy");
+    uint32_t destroyed = 0;
+    for (const EntityHandle entity : handles) {
+        destroyed += destroy(entity) ? 1 : 0;
+    }
+    TracyPlot("Entities/Destroyed", static_cast<double>(destroyed));
+    return destroyed;
+}
+
+void ObjectStorage::moveEntity(EntityId from, EntityId to)
+{
+    transforms[to] = transforms[from];
+    modelMatrices[to] = modelMatrices[from];
+    prevModelMatrices[to] = prevModelMatrices[from];
+    meshletDraws[to] = meshletDraws[from];
+    meshLods[to] = meshLods[from];
+    materials[to] = materials[from];
+    flags[to] = flags[from];
+    nameIds[to] = nameIds[from];
+    transformDirty[to] = transformDirty[from];
+    // The device array holds the removed entity's ObjectUB at `to`: this one is uploaded there.
+    pendingUbWrites[to] = std::max(pendingUbWrites[from], kObjectUbWrites);
+    boundsDirty[to] = boundsDirty[from];
+    denseSlots[to] = denseSlots[from];
+    slotToDense[denseSlots[to]] = to;
+}
+
+void ObjectStorage::clear()
+{
+    for (const uint32_t slot : denseSlots) {
+        destroyedHandles.push_back(EntityHandle{.slot = slot, .generation = slotGenerations[slot]});
+        ++slotGenerations[slot];
+        slotToDense[slot] = kInvalidEntityId;
+        freeSlots.push_back(slot);
+    }
+    destroyedNameIds.insert(destroyedNameIds.end(), nameIds.begin(), nameIds.end());
+    denseSlots.clear();
+    nameIds.clear();
+    // Chunks are kept for the next spawn.
+    arena->count = 0;
+}
+
+void ObjectStorage::reserveChunks(uint32_t count)
+{
+    while (chunkCount() * kEntityChunkSize < count) {
+        auto* chunk = static_cast<std::byte*>(
+            ::operator new(EntityChunkLayout::bytes, std::align_val_t{kEntityColumnAlignment}));
+        arena->chunks.emplace_back(chunk);
+    }
+}
+
+void ObjectStorage::markObjectUbDirty(EntityId id) noexcept
 {
-    transforms.clear();
-    modelMatrices.clear();
-    prevModelMatrices.clear();
-    meshletDraws.clear();
-    materials.clear();
-    flags.clear();
-    names.clear();
+    pendingUbWrites[id] = std::max(pendingUbWrites[id], kObjectUbWrites);
+}
+
+void ObjectStorage::invalidateObjectUbs() noexcept
+{
+    for (EntityId id = 0; id < size(); ++id) {
+        pendingUbWrites[id] = std::max(pendingUbWrites[id], kObjectUbWrites);
+    }
 }
 
 glm::mat4 computeModelMatrix(const Transform& transform)
@@ -50,29 +334,143 @@ glm::mat4 computeModelMatrix(const Transform& transform)
     return model;
 }
 
-void applyYawSpin(std::span<Transform> transforms, float deltaYawRadians)
+void computeModelMatrices(const EntityColumn<Transform>& transforms, std::span<const EntityId> ids,
+                          EntityColumn<glm::mat4>& models, const glm::mat4& meshPreRotation)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= ids.size(); i += 8) {
+        computeModelMatrices8(transforms, ids.data() + i, models, meshPreRotation);
+    }
+#endif
+    for (; i < ids.size(); ++i) {
+        models[ids[i]] = composeTrs(transforms[ids[i]]) * meshPreRotation;
+    }
+}
+
+void applyYawSpin(ObjectStorage& storage, float deltaYawRadians)
 {
-    for (Transform& t : transforms) {
-        t.rotation.y += deltaYawRadians;
+    constexpr uint32_t spinning = EntityFlag::Active | EntityFlag::Dynamic;
+    const uint32_t count = storage.size();
+    for (EntityId id = 0; id < count; ++id) {
+        if ((storage.flags[id] & spinning) == spinning) {
+            storage.editTransform(id).rotation.y += deltaYawRadians;
+        }
     }
 }
 
-void writeObjectUbs(ObjectStorage& storage, std::span<ObjectUB> mappedUbs, const glm::mat4& meshPreRotation)
+uint32_t writeObjectUbUploads(ObjectStorage& storage, std::span<ObjectUB> uploads, std::span<uint32_t> uploadIndices,
+                              const glm::mat4& meshPreRotation)
 {
+    ZoneScopedN("writeObjectUbUploads");
     const uint32_t count = storage.size();
-    assert(mappedUbs.size() >= count);
+    assert(uploads.size() >= count && uploadIndices.size() >= count);
 
+    // Chunks are contiguous runs of arena chunks, so every column element is touched by exactly one task; the
+    // upload list stays in entity order.
+    const auto workers = static_cast<uint32_t>(jobExecutor().num_workers());
+    const uint32_t arenaChunks = (count + kEntityChunkSize - 1) / kEntityChunkSize;
+    const uint32_t chunkCount = std::clamp(arenaChunks, 1u, std::max(workers, 1u));
+    const uint32_t chunkSize = std::max((arenaChunks + chunkCount - 1) / chunkCount, 1u) * kEntityChunkSize;
+    std::vector<ObjectUbUploadStats> stats(chunkCount);
+    std::vector<uint32_t> offsets(chunkCount, 0);
+    if (chunkCount == 1) {
+        stats[0] = recomputeRange(storage, meshPreRotation, 0, count);
+        writeUploadRange(storage, uploads, uploadIndices, 0, 0, count);
+    } else {
+        tf::Taskflow taskflow("WriteObjectUbUploads");
+        tf::Task prefixSum = taskflow.emplace([&] {
+            for (uint32_t chunk = 1; chunk < chunkCount; ++chunk) {
+                offsets[chunk] = offsets[chunk - 1] + stats[chunk - 1].uploads;
+            }
+        });
+        for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+            const EntityId first = std::min(chunk * chunkSize, count);
+            const EntityId end = std::min(first + chunkSize, count);
+            tf::Task recompute = taskflow.emplace([&, chunk, first, end] {
+                ZoneScopedN("RecomputeTransformsChunk");
+                stats[chunk] = recomputeRange(storage, meshPreRotation, first, end);
+            });
+            tf::Task write = taskflow.emplace([&, chunk, first, end] {
+                ZoneScopedN("WriteObjectUbUploadsChunk");
+                writeUploadRange(storage, uploads, uploadIndices, offsets[chunk], first, end);
+            });
+            recompute.precede(prefixSum);
+            prefixSum.precede(write);
+        }
+        runAndWait(taskflow);
+    }
+
+    ObjectUbUploadStats total;
+    for (const ObjectUbUploadStats& chunk : stats) {
+        total.recomputed += chunk.recomputed;
+        total.uploads += chunk.uploads;
+    }
+    TracyPlot("Entities/MatricesRecomputed", static_cast<double>(total.recomputed));
+    TracyPlot("Entities/ObjectUbUploads", static_cast<double>(total.uploads));
+    return total.uploads;
+}
+
+void selectMeshLods(ObjectStorage& storage, const CameraData& camera)
+{
+    ZoneScopedN("selectMeshLods");
+    // |proj[1][1]| = 1 / tan(fovY / 2): radius * p11 / distance is the diameter's share of the viewport height.
+    const float projectionScale = std::abs(camera.proj[1][1]);
+    const uint32_t count = storage.size();
     for (uint32_t i = 0; i < count; ++i) {
-        if ((storage.flags[i] & EntityFlag::Active) == 0) {
+        const MeshLodChain& chain = storage.meshLods[i];
+        if ((storage.flags[i] & EntityFlag::Active) == 0 || chain.lodCount <= 1) {
             continue;
         }
+        const glm::vec4 sphere = transformBoundingSphere(storage.modelMatrices[i], chain.lods[0].boundingSphere);
+        const float distance = std::max(glm::length(glm::vec3(sphere) - camera.cameraPos) - sphere.w, camera.nearZ);
+        const float screenSize = sphere.w * projectionScale / distance;
 
-        const glm::mat4 model = computeModelMatrix(storage.transforms[i]) * meshPreRotation;
-        mappedUbs[i] = ObjectUB{
-            .modelMatrix = model,
-            .prevModelMatrix = storage.prevModelMatrices[i],
+        uint32_t lod = 0;
+        while (lod + 1 < chain.lodCount && screenSize < kMeshLodScreenSizes[lod + 1]) {
+            ++lod;
+        }
+        // The ObjectUB carries the LOD's bounds as its culling sphere.
+        if (storage.meshletDraws[i].firstMeshlet != chain.lods[lod].firstMeshlet) {
+            storage.meshletDraws[i] = chain.lods[lod];
+            storage.markObjectUbDirty(i);
+        }
+    }
+}
+
+void remapTextureIndex(ObjectStorage& storage, uint32_t from, uint32_t to)
+{
+    for (EntityId id = 0; id < storage.size(); ++id) {
+        if (storage.materials[id].textureIndex == from) {
+            storage.materials[id].textureIndex = to;
+        }
+    }
+}
+
+void writeInstanceDraws(const ObjectStorage& storage, std::span<InstanceDraw> mappedDraws)
+{
+    const uint32_t count = storage.size();
+    assert(mappedDraws.size() >= count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const MeshletDraw& draw = storage.meshletDraws[i];
+        mappedDraws[i] = InstanceDraw{
+            .firstMeshlet = draw.firstMeshlet,
+            .meshletCount = draw.meshletCount,
+            .textureIndex = storage.materials[i].textureIndex,
+            .flags = storage.flags[i],
         };
-        storage.prevModelMatrices[i] = model;
-        storage.modelMatrices[i] = model;
     }
 }
+
+glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere)
+{
+    if (sphere.w <= 0.0f) {
+        return glm::vec4{0.0f};
+    }
+    const glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+    const float maxScale = glm::sqrt(glm::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])),
+                                              glm::max(glm::dot(glm::vec3(model[1]), glm::vec3(model[1])),
+                                                       glm::dot(glm::vec3(model[2]), glm::vec3(model[2])))));
+    return glm::vec4{center, sphere.w * maxScale};
+}
@@ -2,18 +2,36 @@
 
 #include "types.hpp"
 
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
 #include <span>
 #include <string>
 #include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 // ---------------------------------------------------------------------------
-// Dense entity index into ObjectStorage SoA columns. Not a generational handle.
+// Dense entity index into ObjectStorage SoA columns (and the GPU instance arrays). Valid until the next destroy:
+// removal moves the last entity into the freed index. Hold an EntityHandle across frames.
 // ---------------------------------------------------------------------------
 using EntityId = uint32_t;
 inline constexpr EntityId kInvalidEntityId = ~EntityId{0};
 
+// Generational handle: slot in ObjectStorage's sparse table + the slot's generation when the entity was created.
+// A destroyed entity's handles stop resolving, even after the slot is reused.
+struct EntityHandle
+{
+    uint32_t slot = ~0u;
+    uint32_t generation = 0;
+
+    friend bool operator==(const EntityHandle&, const EntityHandle&) = default;
+};
+inline constexpr EntityHandle kInvalidEntityHandle{};
+
 struct Transform
 {
     glm::vec3 position{0.0f, 0.0f, 0.0f};
@@ -26,31 +44,206 @@ namespace EntityFlag
 {
     inline constexpr uint32_t None = 0;
     inline constexpr uint32_t Active = 1u << 0;
-    inline constexpr uint32_t Dynamic = 1u << 1;
+    inline constexpr uint32_t Dynamic = 1u << 1; // moved by applyYawSpin every frame; static entities never are
 } // namespace EntityFlag
 
+// ── Entity arena ──
+// Hot columns live in fixed-size chunks of kEntityChunkSize entities: one allocation per chunk holds every column's
+// block, each starting on a cache line. Growing adds a chunk and never moves existing entities.
+inline constexpr uint32_t kEntityChunkShift = 10;
+inline constexpr uint32_t kEntityChunkSize = 1u << kEntityChunkShift;
+inline constexpr size_t kEntityColumnAlignment = 64;
+
+struct EntityChunkDeleter
+{
+    void operator()(std::byte* chunk) const noexcept
+    {
+        ::operator delete(chunk, std::align_val_t{kEntityColumnAlignment});
+    }
+};
+
+struct EntityArena
+{
+    std::vector<std::unique_ptr<std::byte, EntityChunkDeleter>> chunks;
+    uint32_t count = 0;
+};
+
+// One column of the arena: entity id → chunk id >> kEntityChunkShift, element id & (kEntityChunkSize - 1).
+template <typename T>
+class EntityColumn
+{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                  "arena columns are copied as bytes and never destroyed");
+
+public:
+    EntityColumn(EntityArena* arenaIn, size_t offsetIn) noexcept : arena(arenaIn), offset(offsetIn) {}
+
+    [[nodiscard]] T& operator[](EntityId id) noexcept { return chunk(id >> kEntityChunkShift)[id & kChunkMask]; }
+    [[nodiscard]] const T& operator[](EntityId id) const noexcept
+    {
+        return chunk(id >> kEntityChunkShift)[id & kChunkMask];
+    }
+    // The column's block in chunk c (kEntityChunkSize elements, entities past size() are stale).
+    [[nodiscard]] T* chunk(uint32_t c) const noexcept
+    {
+        return std::launder(reinterpret_cast<T*>(arena->chunks[c].get() + offset));
+    }
+    [[nodiscard]] uint32_t size() const noexcept { return arena->count; }
+
+private:
+    static constexpr uint32_t kChunkMask = kEntityChunkSize - 1;
+
+    EntityArena* arena;
+    size_t offset;
+};
+
+// First cache line after a chunk's block of T starting at offset.
+template <typename T>
+constexpr size_t entityColumnEnd(size_t offset)
+{
+    const size_t end = offset + sizeof(T) * kEntityChunkSize;
+    return (end + kEntityColumnAlignment - 1) / kEntityColumnAlignment * kEntityColumnAlignment;
+}
+
+// Byte offset of each hot column inside a chunk, in declaration order.
+struct EntityChunkLayout
+{
+    static constexpr size_t transforms = 0;
+    static constexpr size_t modelMatrices = entityColumnEnd<Transform>(transforms);
+    static constexpr size_t prevModelMatrices = entityColumnEnd<glm::mat4>(modelMatrices);
+    static constexpr size_t meshletDraws = entityColumnEnd<glm::mat4>(prevModelMatrices);
+    static constexpr size_t meshLods = entityColumnEnd<MeshletDraw>(meshletDraws);
+    static constexpr size_t materials = entityColumnEnd<MeshLodChain>(meshLods);
+    static constexpr size_t flags = entityColumnEnd<MaterialRef>(materials);
+    static constexpr size_t transformDirty = entityColumnEnd<uint32_t>(flags);
+    static constexpr size_t pendingUbWrites = entityColumnEnd<uint8_t>(transformDirty);
+    static constexpr size_t boundsDirty = entityColumnEnd<uint8_t>(pendingUbWrites);
+    static constexpr size_t bytes = entityColumnEnd<uint8_t>(boundsDirty);
+};
+
+// Interned strings: each distinct string is stored once and named by a uint32 id. Strings are never removed.
+class StringTable
+{
+public:
+    uint32_t intern(std::string_view text);
+    [[nodiscard]] std::string_view view(uint32_t id) const noexcept { return strings[id]; }
+    [[nodiscard]] uint32_t size() const noexcept { return static_cast<uint32_t>(strings.size()); }
+
+private:
+    std::deque<std::string> strings; // deque: growing never moves the strings the map keys point into
+    std::unordered_map<std::string_view, uint32_t> ids;
+};
+
 // ---------------------------------------------------------------------------
 // ObjectStorage — SoA world instances. No Vulkan handles here.
-// Columns are public for direct span-friendly access (DOD).
+// Hot columns are public EntityColumns over the chunked EntityArena (DOD); per-chunk blocks are contiguous, so
+// loops over entity ranges stream through memory. Cold data (names, handle slots) lives in plain vectors.
+// Transforms are dirty-tracked: code that moves an entity goes through editTransform / markTransformDirty, and
+// writeObjectUbUploads recomputes only those matrices and uploads only the ObjectUBs the device array lacks.
+// The tracking columns are bytes (not vector<bool>) so parallel chunks can update neighbouring entities.
+// Columns stay dense: destroy() swaps the last entity into the hole and pops every column, the sparse slot table
+// follows the move, and the moved entity's ObjectUB is uploaded to its new index (InstanceDraw is rewritten every
+// frame anyway). Freed slots are reused from a free list with their generation bumped.
 // ---------------------------------------------------------------------------
 class ObjectStorage
 {
+    // First member: the columns below point into it. Heap-allocated so a moved storage keeps them valid.
+    std::unique_ptr<EntityArena> arena = std::make_unique<EntityArena>();
+
 public:
-    std::vector<Transform> transforms;
-    std::vector<glm::mat4> modelMatrices;
-    std::vector<glm::mat4> prevModelMatrices;
-    std::vector<MeshletDraw> meshletDraws;
-    std::vector<MaterialRef> materials;
-    std::vector<uint32_t> flags;
-    std::vector<std::string> names;
-
-    [[nodiscard]] EntityId create(const Transform& transform, const MeshletDraw& meshletDraw,
+    EntityColumn<Transform> transforms{arena.get(), EntityChunkLayout::transforms};
+    EntityColumn<glm::mat4> modelMatrices{arena.get(), EntityChunkLayout::modelMatrices};
+    EntityColumn<glm::mat4> prevModelMatrices{arena.get(), EntityChunkLayout::prevModelMatrices};
+    // The LOD drawn this frame (selectMeshLods).
+    EntityColumn<MeshletDraw> meshletDraws{arena.get(), EntityChunkLayout::meshletDraws};
+    EntityColumn<MeshLodChain> meshLods{arena.get(), EntityChunkLayout::meshLods};
+    EntityColumn<MaterialRef> materials{arena.get(), EntityChunkLayout::materials};
+    EntityColumn<uint32_t> flags{arena.get(), EntityChunkLayout::flags};
+    // TRS changed since the last writeObjectUbUploads.
+    EntityColumn<uint8_t> transformDirty{arena.get(), EntityChunkLayout::transformDirty};
+    // Uploads the device ObjectUB array is still owed.
+    EntityColumn<uint8_t> pendingUbWrites{arena.get(), EntityChunkLayout::pendingUbWrites};
+    // modelMatrix changed since the spatial index (SceneBvh::update) last read it.
+    EntityColumn<uint8_t> boundsDirty{arena.get(), EntityChunkLayout::boundsDirty};
+    // Cold: StringTable ids into names.
+    std::vector<uint32_t> nameIds;
+    StringTable names;
+
+    [[nodiscard]] EntityId create(const Transform& transform, const MeshLodChain& meshLods,
                                   const MaterialRef& material, std::string_view name = {});
+    // Appends one entity per transform, all drawing the same mesh and material; returns the first id (the rest
+    // follow contiguously, which lets the renderer draw them as one instanced dispatch). handle(first + i) names
+    // them beyond the next destroy().
+    [[nodiscard]] EntityId spawnInstances(std::span<const Transform> instanceTransforms,
+                                          const MeshLodChain& meshLods, const MaterialRef& material,
+                                          std::string_view name = {},
+                                          uint32_t entityFlags = EntityFlag::Active | EntityFlag::Dynamic);
+
+    // Write access to a transform; its matrix is recomputed at the next writeObjectUbUploads.
+    [[nodiscard]] Transform& editTransform(EntityId id) noexcept
+    {
+        transformDirty[id] = 1;
+        return transforms[id];
+    }
+    void markTransformDirty(EntityId id) noexcept { transformDirty[id] = 1; }
+    // Another ObjectUB field changed (LOD bounds): uploaded again, no matrix recompute.
+    void markObjectUbDirty(EntityId id) noexcept;
+    // Every ObjectUB is uploaded again (the device array was reallocated).
+    void invalidateObjectUbs() noexcept;
 
-    [[nodiscard]] uint32_t size() const noexcept { return static_cast<uint32_t>(transforms.size()); }
-    [[nodiscard]] bool empty() const noexcept { return transforms.empty(); }
+    // Swap-and-pop removal; false when the handle is stale. Invalidates the EntityId of the last entity.
+    bool destroy(EntityHandle handle);
+    // Removes every live handle in handles (stale ones are skipped); returns how many were removed.
+    uint32_t destroy(std::span<const EntityHandle> handles);
 
-    void clear() noexcept;
+    [[nodiscard]] EntityHandle handle(EntityId id) const noexcept
+    {
+        const uint32_t slot = denseSlots[id];
+        return EntityHandle{.slot = slot, .generation = slotGenerations[slot]};
+    }
+    // Current dense index of handle, or kInvalidEntityId once it was destroyed.
+    [[nodiscard]] EntityId find(EntityHandle handle) const noexcept
+    {
+        if (handle.slot >= slotGenerations.size() || slotGenerations[handle.slot] != handle.generation) {
+            return kInvalidEntityId;
+        }
+        return slotToDense[handle.slot];
+    }
+    [[nodiscard]] bool alive(EntityHandle handle) const noexcept { return find(handle) != kInvalidEntityId; }
+
+    [[nodiscard]] std::string_view name(EntityId id) const noexcept { return names.view(nameIds[id]); }
+
+    [[nodiscard]] uint32_t size() const noexcept { return arena->count; }
+    [[nodiscard]] bool empty() const noexcept { return arena->count == 0; }
+    [[nodiscard]] uint32_t chunkCount() const noexcept { return static_cast<uint32_t>(arena->chunks.size()); }
+    // Handles destroyed since the last call, in destroy order (the spatial index drains them every frame).
+    void takeDestroyed(std::vector<EntityHandle>& out)
+    {
+        out.swap(destroyedHandles);
+        destroyedHandles.clear();
+    }
+    // Name ids of the entities destroyed since the last call (AssetsLoader drops their mesh references).
+    void takeDestroyedNames(std::vector<uint32_t>& out)
+    {
+        out.swap(destroyedNameIds);
+        destroyedNameIds.clear();
+    }
+
+    // Destroys every entity; their handles stop resolving.
+    void clear();
+
+private:
+    // Adds chunks until capacity covers count entities.
+    void reserveChunks(uint32_t count);
+    // Moves entity from into to in every column (to's old contents are dropped).
+    void moveEntity(EntityId from, EntityId to);
+
+    std::vector<uint32_t> denseSlots;      // per entity: its slot in the sparse table
+    std::vector<EntityId> slotToDense;     // per slot: the entity's dense index while its generation is live
+    std::vector<uint32_t> slotGenerations; // per slot: bumped on destroy, so older handles no longer match
+    std::vector<uint32_t> freeSlots;
+    std::vector<EntityHandle> destroyedHandles;
+    std::vector<uint32_t> destroyedNameIds;
 };
 
 // ---------------------------------------------------------------------------
@@ -59,9 +252,31 @@ public:
 
 [[nodiscard]] glm::mat4 computeModelMatrix(const Transform& transform);
 
-// Demo / gameplay spin on Y (radians per call).
-void applyYawSpin(std::span<Transform> transforms, float deltaYawRadians);
+// models[id] = computeModelMatrix(transforms[id]) * meshPreRotation for every id in ids, in closed form (no
+// glm::rotate chain); eight entities per step with AVX2 when the build targets it.
+void computeModelMatrices(const EntityColumn<Transform>& transforms, std::span<const EntityId> ids,
+                          EntityColumn<glm::mat4>& models, const glm::mat4& meshPreRotation);
 
-// Writes ObjectUB[i] for each active entity; updates prevModelMatrices for next frame.
+// Demo / gameplay spin on Y (radians per call) of the active Dynamic entities; marks them dirty.
+void applyYawSpin(ObjectStorage& storage, float deltaYawRadians);
+
+// Packs the ObjectUB of every active entity the device array is stale for into uploads / uploadIndices (entity
+// order) after recomputing the dirty matrices; returns the entry count. Updates prevModelMatrices for next frame.
+// Entity chunks run in parallel on jobExecutor(). scatter.slang applies the list on the GPU.
 // meshPreRotation is applied as: model = trs * meshPreRotation (same order as before).
-void writeObjectUbs(ObjectStorage& storage, std::span<ObjectUB> mappedUbs, const glm::mat4& meshPreRotation);
+// boundingSphere is the world-space bounds of the entity's meshlet range (GPU instance culling).
+uint32_t writeObjectUbUploads(ObjectStorage& storage, std::span<ObjectUB> uploads, std::span<uint32_t> uploadIndices,
+                              const glm::mat4& meshPreRotation);
+
+// Points meshletDraws[i] at the discrete LOD matching the entity's screen size (bounding sphere diameter over
+// viewport height, from last frame's model matrix). Runs before recording: both draw paths read meshletDraws.
+void selectMeshLods(ObjectStorage& storage, const CameraData& camera);
+
+// Points every entity drawn with texture heap index from at to (TextureManager swapped the texture's image).
+void remapTextureIndex(ObjectStorage& storage, uint32_t from, uint32_t to);
+
+// Writes InstanceDraw[i] (meshlet range, texture, flags) for the GPU cull pass.
+void writeInstanceDraws(const ObjectStorage& storage, std::span<InstanceDraw> mappedDraws);
+
+// Transforms an object-space bounding sphere; the radius is scaled by the largest axis scale.
+[[nodiscard]] glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere);
@@ -0,0 +1,178 @@
+#include "texture_cache.hpp"
+#include "../Constants.h"
+#include "../static_headers/logger.hpp"
+#include "../util/content_hash.hpp"
+#include "../util/mapped_file.hpp"
+#include "../util/vk_tracy.hpp"
+
+#include "ktxvulkan.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // zstd level of the cooked files: decode speed barely depends on it, size does.
+    constexpr uint32_t kZstdLevel = 18;
+
+    // sRGB → linear for the 256 byte values; mips are averaged in linear space so they do not darken.
+    const std::array<float, 256>& srgbToLinearTable()
+    {
+        static const std::array<float, 256> table = []
+        {
+            std::array<float, 256> values{};
+            for (size_t i = 0; i < values.size(); ++i) {
+                const float c = static_cast<float>(i) / 255.0f;
+                values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return values;
+        }();
+        return table;
+    }
+
+    uint8_t linearToSrgb(float linear)
+    {
+        const float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    }
+
+    // Next level of an RGBA8 sRGB image: 2x2 box filter (edge texels repeat on odd sizes), alpha kept linear.
+    std::vector<uint8_t> downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height)
+    {
+        const auto& toLinear = srgbToLinearTable();
+        const uint32_t mipWidth = std::max(width / 2, 1u);
+        const uint32_t mipHeight = std::max(height / 2, 1u);
+        std::vector<uint8_t> mip(static_cast<size_t>(mipWidth) * mipHeight * 4);
+        for (uint32_t y = 0; y < mipHeight; ++y) {
+            const uint32_t y0 = std::min(y * 2, height - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < mipWidth; ++x) {
+                const uint32_t x0 = std::min(x * 2, width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                const std::array<size_t, 4> texels{(static_cast<size_t>(y0) * width + x0) * 4,
+                                                   (static_cast<size_t>(y0) * width + x1) * 4,
+                                                   (static_cast<size_t>(y1) * width + x0) * 4,
+                                                   (static_cast<size_t>(y1) * width + x1) * 4};
+                uint8_t* out = mip.data() + (static_cast<size_t>(y) * mipWidth + x) * 4;
+                for (size_t channel = 0; channel < 3; ++channel) {
+                    float sum = 0.0f;
+                    for (const size_t texel : texels) {
+                        sum += toLinear[source[texel + channel]];
+                    }
+                    out[channel] = linearToSrgb(sum * 0.25f);
+                }
+                uint32_t alpha = 0;
+                for (const size_t texel : texels) {
+                    alpha += source[texel + 3];
+                }
+                out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+            }
+        }
+        return mip;
+    }
+} // namespace
+
+uint64_t TextureCache::sourceKey(const std::filesystem::path& source)
+{
+    ZoneScopedN("TextureCache::sourceKey");
+    const std::optional<MappedFile> file = MappedFile::open(source);
+    if (!file) {
+        return 0;
+    }
+    // Contents only: the same image referenced from several models is cooked once.
+    const uint64_t key = hashBytes(file->bytes(), kVersion);
+    return key != 0 ? key : 1;
+}
+
+std::filesystem::path TextureCache::cookedPath(uint64_t key)
+{
+    return TEXTURE_CACHE_DIR / std::format("{:016x}.ktx2", key);
+}
+
+bool TextureCache::store(uint64_t key, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    ZoneScopedN("TextureCache::store");
+    const auto levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+    const ktxTextureCreateInfo createInfo{
+        .glInternalformat = 0,
+        .vkFormat = VK_FORMAT_R8G8B8A8_SRGB,
+        .pDfd = nullptr,
+        .baseWidth = width,
+        .baseHeight = height,
+        .baseDepth = 1,
+        .numDimensions = 2,
+        .numLevels = levelCount,
+        .numLayers = 1,
+        .numFaces = 1,
+        .isArray = KTX_FALSE,
+        .generateMipmaps = KTX_FALSE,
+    };
+    ktxTexture2* texture = nullptr;
+    if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture) != KTX_SUCCESS) {
+        log_error(std::format("ktxTexture2_Create failed for {}x{}", width, height), "TextureCache");
+        return false;
+    }
+    auto destroy = [&texture] { ktxTexture_Destroy(ktxTexture(texture)); };
+
+    {
+        ZoneScopedN("TextureCache::buildMips");
+        std::vector<uint8_t> level(rgba, rgba + static_cast<size_t>(width) * height * 4);
+        uint32_t levelWidth = width;
+        uint32_t levelHeight = height;
+        for (uint32_t mip = 0; mip < levelCount; ++mip) {
+            if (mip > 0) {
+                level = downsample(level, levelWidth, levelHeight);
+                levelWidth = std::max(levelWidth / 2, 1u);
+                levelHeight = std::max(levelHeight / 2, 1u);
+            }
+            ktxTexture_SetImageFromMemory(ktxTexture(texture), mip, 0, 0, level.data(), level.size());
+        }
+    }
+
+    {
+        ZoneScopedN("TextureCache::encodeUastc");
+        // Cooks already run one per jobExecutor() worker; basisu's own threads would oversubscribe.
+        ktxBasisParams params{};
+        params.structSize = sizeof(params);
+        params.uastc = KTX_TRUE;
+        params.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
+        params.threadCount = 1;
+        if (ktxTexture2_CompressBasisEx(texture, &params) != KTX_SUCCESS ||
+            ktxTexture2_DeflateZstd(texture, kZstdLevel) != KTX_SUCCESS) {
+            destroy();
+            log_error(std::format("UASTC encode failed for {}x{}", width, height), "TextureCache");
+            return false;
+        }
+    }
+
+    const std::filesystem::path path = cookedPath(key);
+    // Unique per thread: two workers cooking the same image must not interleave writes.
+    const std::filesystem::path temporary = std::filesystem::path(path).concat(
+        std::format(".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    std::error_code error;
+    std::filesystem::create_directories(TEXTURE_CACHE_DIR, error);
+    const KTX_error_code written = ktxTexture_WriteToNamedFile(ktxTexture(texture), temporary.string().c_str());
+    destroy();
+    if (written != KTX_SUCCESS) {
+        std::filesystem::remove(temporary, error);
+        log_error(std::format("Failed to write cooked texture {}", temporary.string()), "TextureCache");
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        log_error(std::format("Failed to publish cooked texture {}", path.string()), "TextureCache");
+        return false;
+    }
+    log_info(std::format("Cooked {} ({}x{}, {} mips, {} bytes)", path.string(), width, height, levelCount,
+                         std::filesystem::file_size(path, error)),
+             "TextureCache");
+    return true;
+}
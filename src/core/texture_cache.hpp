@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+// Cooked textures under TEXTURE_CACHE_DIR: KTX2 files holding a full sRGB-correct box-filtered mip chain,
+// encoded to UASTC and zstd-supercompressed, named by a hash of the source file's contents. UASTC transcodes
+// quickly and with little loss to BC7 (or RGBA8) at load, so the GPU gets a native format and needs no blits.
+// Thread-safe: cooks go through a temporary file and an atomic rename.
+class TextureCache
+{
+public:
+    // Bump whenever the cooker's output changes; older files become misses.
+    static constexpr uint32_t kVersion = 1;
+
+    // 0 when the source cannot be read (the cache is then bypassed).
+    [[nodiscard]] static uint64_t sourceKey(const std::filesystem::path& source);
+    [[nodiscard]] static std::filesystem::path cookedPath(uint64_t key);
+
+    // Builds the mip chain for tightly packed RGBA8 texels and writes cookedPath(key). False on failure.
+    static bool store(uint64_t key, const uint8_t* rgba, uint32_t width, uint32_t height);
+};
@@ -1,19 +1,27 @@
 #include "texture_manager.hpp"
+#include "texture_cache.hpp"
+#include "../util/jobs.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 
 
-// Construct a TextureManager which holds Vulkan device/queue handles and
-// creates a command pool for short-lived transfer/graphics commands.
-TextureManager::TextureManager(Device& deviceWrapper, const VkAllocator& allocator, DescriptorManager &descriptorManager) :
+
+// Construct a TextureManager which holds Vulkan device/queue handles and picks
+// the GPU format cooked textures are transcoded to.
+TextureManager::TextureManager(Device& deviceWrapper, const VkAllocator& allocator, DescriptorManager &descriptorManager,
+                               UploadContext &uploads) :
     deviceWrapper(deviceWrapper), physicalDevice(deviceWrapper.physicalDevice), device(deviceWrapper.vkdevice),
     graphicsQueue(deviceWrapper.graphicsQueue), transferQueue(deviceWrapper.transferQueue),
     graphicsQueueFamilyIndex(deviceWrapper.graphicsIndex),
-    transferQueueFamilyIndex(deviceWrapper.transferIndex), allocator(allocator), descriptorManager(descriptorManager)
+    transferQueueFamilyIndex(deviceWrapper.transferIndex), allocator(allocator), descriptorManager(descriptorManager),
+    uploads(uploads)
 {
     log_info("Constructor started", "TextureManager");
-    vk::CommandPoolCreateInfo poolInfo{.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-                                       .queueFamilyIndex = graphicsQueueFamilyIndex};
-    commandPool = vk::raii::CommandPool(device, poolInfo);
+    transcodeTarget = deviceWrapper.textureCompressionBC ? KTX_TTF_BC7_RGBA : KTX_TTF_RGBA32;
+    log_info(std::format("Cooked textures transcode to {}", deviceWrapper.textureCompressionBC ? "BC7" : "RGBA8"),
+             "TextureManager");
 }
 
 // Resolve a relative path relative to the executable directory.
@@ -57,20 +65,28 @@ TextureManager::~TextureManager()
     ZoneScopedN("TextureManager::~TextureManager");
     log_info("Destructor called", "TextureManager");
 
+    // Decodes still running reference nothing but their own result.
+    for (auto& [path, job] : decodeJobs) {
+        job.wait();
+    }
+    decodeJobs.clear();
+
     for (auto& [path, asset] : loadedTextures) {
-        if (asset.textureImageMemory != nullptr) {
-            VkImage raw = asset.textureImage.release();
-            tracyResourceFree(raw, "GPU/Textures");
-            vmaDestroyImage(allocator.allocator, raw, asset.textureImageMemory);
-            asset.textureImageMemory = nullptr;
-        }
+        destroyTexture(asset);
     }
     loadedTextures.clear();
-
-    if (stagingBufferMemory != nullptr) {
-        VkBuffer raw = stagingBuffer.release();
-        vmaDestroyBuffer(allocator.allocator, raw, stagingBufferMemory);
-        stagingBufferMemory = nullptr;
+    for (RetiredTexture& retired : retiredTextures) {
+        destroyTexture(retired.asset);
+    }
+    retiredTextures.clear();
+    destroyTexture(fallbackTexture);
+    for (FeedbackBuffer& feedback : mipFeedback) {
+        if (feedback.memory != nullptr) {
+            vmaUnmapMemory(allocator.allocator, feedback.memory);
+            VkBuffer raw = feedback.buffer.release();
+            tracyResourceFree(raw, "GPU/Textures");
+            vmaDestroyBuffer(allocator.allocator, raw, feedback.memory);
+        }
     }
     log_info("Resources destroyed", "TextureManager");
 }
@@ -82,7 +98,25 @@ void TextureManager::init()
 {
     ZoneScopedN("TextureManager::init");
     log_info("init() started", "TextureManager");
-    log_info("Initialized", "TextureManager");
+
+    // 1x1 white: what missing / failed / empty texture paths resolve to.
+    const uint32_t white = 0xFFFFFFFFu;
+    UploadBatch batch = uploads.graphicsBatch();
+    RecordedTexture fallback = recordUpload(batch, "<fallback>", &white, 1, 1);
+    batch.submit();
+    descriptorManager.writeImageDescriptor(fallback.asset, fallback.viewInfo);
+    fallbackTexture = std::move(fallback.asset);
+#if ENGINE_VIRTUAL_TEXTURING
+    // Pages are copied as transcoded, so the atlas takes the format cooked textures transcode to.
+    virtualTextures = std::make_unique<VirtualTextureCache>(
+        deviceWrapper, allocator, descriptorManager, uploads,
+        transcodeTarget == KTX_TTF_BC7_RGBA ? vk::Format::eBc7SrgbBlock : vk::Format::eR8G8B8A8Srgb);
+#endif
+#if ENGINE_MIP_STREAMING
+    createFeedbackBuffers();
+#endif
+    log_info(std::format("Initialized (fallback texture at heap index {})", fallbackTexture.descriptorHeapIndex),
+             "TextureManager");
 }
 
 // ── format-detecting texture loader ─────────────────────────
@@ -103,183 +137,499 @@ TextureFormat detectFormat(std::string_view path)
     return TextureFormat::Unknown;
 }
 
+// ── mip streaming knobs ──
+// Levels up to this size are uploaded at load and never trimmed: every texture is sampleable right away.
+constexpr uint32_t kStreamingTailSize = 256;
+// Heap indices with a feedback word (matches mesh.slang kMaxFeedbackTextures).
+constexpr uint32_t kMaxFeedbackTextures = 16384;
+// fragMain writes floor(lod) + bias so coarser-than-level-0 requests stay unsigned; 0xFFFFFFFF = not sampled.
+constexpr int32_t kFeedbackLodBias = 16;
+constexpr uint32_t kFeedbackNone = ~0u;
+// A texture nobody asked for at its resident level over this many frames is trimmed to what was asked.
+constexpr uint32_t kTrimWindowFrames = 240;
+// Level bytes re-uploaded per frame; the first swap of a frame always goes through so large levels still load.
+constexpr ktx_size_t kMaxStreamingBytesPerFrame = 32ull * 1024 * 1024;
+
+// First level kept resident at load: the finest one within kStreamingTailSize (0 = not streamed).
+uint32_t streamingTailLevel(const ktxTexture* texture)
+{
+#if ENGINE_MIP_STREAMING
+    uint32_t level = 0;
+    while (level + 1 < texture->numLevels &&
+           std::max(texture->baseWidth >> level, texture->baseHeight >> level) > kStreamingTailSize) {
+        ++level;
+    }
+    return level;
+#else
+    (void)texture;
+    return 0;
+#endif
+}
+
 } // anonymous namespace
 
-// High-level texture loader that chooses between KTX (fast GPU upload)
-// and a PNG/STB fallback. Caches loaded textures and returns a descriptor.
+// Synchronous wrapper over the async path (startup loads, meshes whose texture
+// was not requested ahead).
 uint32_t TextureManager::loadTexture(std::string texturePath)
 {
     ZoneScopedN("TextureManager::loadTexture");
-    const std::string path = resolvePath(texturePath);
-    const std::filesystem::path fsPath = resolvePath(texturePath);
-    log_info(std::format("loadTexture() started for {}", fsPath.string()), "TextureManager");
-    if (loadedTextures.find(path) != loadedTextures.end()) {
-        log_info(std::format("Texture already loaded: {}", path), "TextureManager");
-        return loadedTextures[path].descriptorHeapIndex;
+    const std::string key = requestTexture(texturePath);
+    if (const auto job = decodeJobs.find(key); job != decodeJobs.end()) {
+        ZoneScopedN("TextureManager::loadTexture::waitDecode");
+        job->second.wait();
+        poll();
     }
+    return textureIndex(key);
+}
 
-    const TextureFormat fmt = detectFormat(path);
-    log_info(std::format("loadTexture: {} → {}", path,
-                         fmt == TextureFormat::Ktx ? "KTX/KTX2" :
-                         fmt == TextureFormat::Png ? "PNG/STB" : "Unknown"), "TextureManager");
+std::string TextureManager::requestTexture(std::string_view texturePath)
+{
+    ZoneScopedN("TextureManager::requestTexture");
+    if (texturePath.empty()) {
+        return {};
+    }
+    std::string path = resolvePath(texturePath);
+    if (loadedTextures.contains(path) || virtualTextureIds.contains(path) || failedTextures.contains(path) ||
+        decodeJobs.contains(path)) {
+        return path;
+    }
+    log_info(std::format("Texture decode queued: {}", path), "TextureManager");
+    decodeJobs.emplace(path, jobExecutor().async([path, target = transcodeTarget]
+                                                 { return decodeTexture(path, target); }));
+    return path;
+}
 
-    // ── KTX / KTX2 path ──────────────────────────────────
-    if (fmt == TextureFormat::Ktx) {
-        // 1. Initialise KTX device-info block with raw Vulkan handles
-        ktxVulkanDeviceInfo vdi{};
-        const KTX_error_code ctorRes = ktxVulkanDeviceInfo_Construct(
-            &vdi,
-            *physicalDevice,
-            *device,
-            *graphicsQueue,
-            *commandPool,
-            nullptr);   // VkAllocationCallbacks
-
-        if (ctorRes != KTX_SUCCESS) {
-            throw std::runtime_error("ktxVulkanDeviceInfo_Construct failed");
-        }
+bool TextureManager::isTextureReady(const std::string& key) const
+{
+    return key.empty() || loadedTextures.contains(key) || virtualTextureIds.contains(key) ||
+        failedTextures.contains(key);
+}
+
+uint32_t TextureManager::textureIndex(const std::string& key) const
+{
+    const auto it = loadedTextures.find(key);
+    return it != loadedTextures.end() ? it->second.descriptorHeapIndex : fallbackTexture.descriptorHeapIndex;
+}
+
+uint32_t TextureManager::materialId(const std::string& key) const
+{
+    const auto it = virtualTextureIds.find(key);
+    return it != virtualTextureIds.end() ? kVirtualTextureMaterialBit | it->second : 0;
+}
+
+TextureManager::DecodedTexture TextureManager::decodeTexture(std::string path, ktx_transcode_fmt_e transcodeTarget)
+{
+    ZoneScopedN("TextureManager::decodeTexture");
+    DecodedTexture decoded{.path = std::move(path)};
+    const TextureFormat fmt = detectFormat(decoded.path);
 
-        // 2. Load the KTX file (auto-detects KTX1 vs KTX2)
+    // KTX / KTX2 contents; Basis-compressed files are transcoded here so the upload only copies.
+    auto openKtx = [&decoded, transcodeTarget](const std::string& file)
+    {
         ktxTexture* kTexture = nullptr;
-        KTX_error_code result = ktxTexture_CreateFromNamedFile(
-            path.c_str(),
-            KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
-            &kTexture);
-
-        if (result != KTX_SUCCESS || !kTexture) {
-            ktxVulkanDeviceInfo_Destruct(&vdi);
-            throw std::runtime_error("Failed to load KTX texture: " + path);
+        if (ktxTexture_CreateFromNamedFile(file.c_str(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &kTexture) !=
+                KTX_SUCCESS ||
+            !kTexture) {
+            return false;
         }
+        std::unique_ptr<ktxTexture, KtxDeleter> texture(kTexture);
+        if (texture->classId == ktxTexture2_c &&
+            ktxTexture2_NeedsTranscoding(reinterpret_cast<ktxTexture2*>(texture.get()))) {
+            ZoneScopedN("TextureManager::transcodeBasis");
+            if (ktxTexture2_TranscodeBasis(reinterpret_cast<ktxTexture2*>(texture.get()), transcodeTarget, 0) !=
+                KTX_SUCCESS) {
+                return false;
+            }
+        }
+        // One 2D image with mips: what recordKtxUpload can place.
+        if (texture->numDimensions != 2 || texture->numLayers != 1 || texture->numFaces != 1) {
+            return false;
+        }
+        decoded.width = texture->baseWidth;
+        decoded.height = texture->baseHeight;
+        decoded.ktx = std::move(texture);
+        return true;
+    };
 
-        // 3. Upload to the GPU — ktx creates the VkImage + VkDeviceMemory
-        ktxVulkanTexture vkTex{};
-        result = ktxTexture_VkUpload(kTexture, &vdi, &vkTex);
+    if (fmt == TextureFormat::Ktx) {
+        openKtx(decoded.path);
+        return decoded;
+    }
 
-        // CPU-side KTX data no longer needed after upload
-        ktxTexture_Destroy(kTexture);
-        ktxVulkanDeviceInfo_Destruct(&vdi);
+#if ENGINE_TEXTURE_COMPRESSION
+    // PNG / JPG: cooked once into KTX2 (TextureCache), then always loaded from the cooked file.
+    const uint64_t cacheKey = TextureCache::sourceKey(decoded.path);
+    const std::string cooked = cacheKey != 0 ? TextureCache::cookedPath(cacheKey).string() : std::string{};
+    if (cacheKey != 0 && openKtx(cooked)) {
+        log_info(std::format("Texture cache hit: {} -> {}", decoded.path, cooked), "TextureManager");
+        return decoded;
+    }
+#endif
 
-        if (result != KTX_SUCCESS) {
-            throw std::runtime_error("Failed to upload KTX texture to GPU: " + path);
-        }
+    // ── PNG / STB: RGBA8 texels ──
+    int texWidth = 0;
+    int texHeight = 0;
+    int texChannels = 0;
+    decoded.pixels.reset(stbi_load(decoded.path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha));
+    if (!decoded.pixels) {
+        return decoded;
+    }
+    decoded.width = static_cast<uint32_t>(texWidth);
+    decoded.height = static_cast<uint32_t>(texHeight);
+
+#if ENGINE_TEXTURE_COMPRESSION
+    // A failed cook keeps the RGBA8 texels, uploaded with runtime blit mips.
+    if (cacheKey != 0 && TextureCache::store(cacheKey, decoded.pixels.get(), decoded.width, decoded.height) &&
+        openKtx(cooked)) {
+        decoded.pixels.reset();
+    }
+#endif
+    return decoded;
+}
 
-        const VkFormat vkFormat  = vkTex.imageFormat;
-        const uint32_t width     = vkTex.width;
-        const uint32_t height    = vkTex.height;
-        const uint32_t levels    = vkTex.levelCount;
-
-        log_info(std::format("KTX texture uploaded: {}×{}, {} mips, format={}",
-                             width, height, levels, static_cast<uint32_t>(vkFormat)), "TextureManager");
-
-        // 4. Build a Vulkan-Hpp ImageView from the raw VkImage.
-        //    The ImageView does NOT own the image — ownership stays with
-        //    ktxVulkanTexture (cleanup via ktxVulkanTexture_Destruct).
-        TextureAsset asset{};
-        vk::ImageViewCreateInfo const viewInfo{
-            .image       = vk::Image(vkTex.image),   // non-owning wrapper
-            .viewType    = static_cast<vk::ImageViewType>(vkTex.viewType),
-            .format      = static_cast<vk::Format>(vkFormat),
-            .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1}};
-        asset.textureImageView = vk::raii::ImageView(device, viewInfo);
-
-        descriptorManager.writeImageDescriptor(asset, viewInfo);
-
-        // 5. Cache: store the ktxVulkanTexture so we can destroy it later.
-        //    A production integration would likely keep a dedicated map of
-        //    raw Vulkan resources keyed by path.
-        //
-        //    TODO(integration): extend TextureAsset (or add a side-map) so
-        //    that the destructor calls ktxVulkanTexture_Destruct on the
-        //    stored ktxVulkanTexture handles.
-        loadedTextures[path] = std::move(asset);
-        return loadedTextures[path].descriptorHeapIndex;
-    }
-
-    // ── PNG / STB fallback ───────────────────────────────
-    {
-        int texWidth  = 0;
-        int texHeight = 0;
-        int texChannels = 0;
-
-        stbi_uc const* pixels = stbi_load(path.c_str(), &texWidth, &texHeight,
-                                          &texChannels, STBI_rgb_alpha);
-        if (!pixels) {
-            throw std::runtime_error("Failed to load texture via stb: " + path);
+void TextureManager::poll()
+{
+    ZoneScopedN("TextureManager::poll");
+    std::vector<DecodedTexture> decoded;
+    for (auto it = decodeJobs.begin(); it != decodeJobs.end();) {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
         }
+        decoded.push_back(it->second.get());
+        it = decodeJobs.erase(it);
+    }
+    if (decoded.empty()) {
+        return;
+    }
 
-        if (stagingBufferMemory != nullptr) {
-            VkBuffer rawStaging = stagingBuffer.release();
-            vmaDestroyBuffer(allocator.allocator, rawStaging, stagingBufferMemory);
-            stagingBufferMemory = nullptr;
+    // One batch for every finished RGBA8 texture: all copies and blit chains share a submit.
+    std::vector<RecordedTexture> recorded;
+    {
+        UploadBatch batch = uploads.graphicsBatch();
+        for (DecodedTexture& texture : decoded) {
+            if (texture.ktx && virtualTextures && virtualTextures->accepts(texture.ktx.get())) {
+                // The CPU copy stays with the cache: pages are cut from it on demand.
+                virtualTextureIds[texture.path] = virtualTextures->add(batch, texture.path, texture.ktx.release());
+            } else if (texture.ktx) {
+                const uint32_t tailLevel = streamingTailLevel(texture.ktx.get());
+                if (std::optional<RecordedTexture> ktx =
+                        recordKtxUpload(batch, texture.path, texture.ktx.get(), tailLevel)) {
+                    recorded.push_back(std::move(*ktx));
+                    if (tailLevel > 0) {
+                        // The finer levels stay on the CPU until fragMain asks for them.
+                        streamedTextures[texture.path] = StreamedTexture{.data = std::move(texture.ktx),
+                                                                         .residentLevel = tailLevel,
+                                                                         .tailLevel = tailLevel,
+                                                                         .windowLevel = tailLevel};
+                    }
+                } else {
+                    log_error(std::format("Unsupported KTX format in {}, using the fallback", texture.path),
+                              "TextureManager");
+                    failedTextures.insert(texture.path);
+                }
+                texture.ktx.reset(); // copied into the staging ring
+            } else if (texture.pixels) {
+                recorded.push_back(
+                    recordUpload(batch, texture.path, texture.pixels.get(), texture.width, texture.height));
+                texture.pixels.reset(); // copied into the staging ring
+            } else {
+                log_error(std::format("Failed to load texture {}, using the fallback", texture.path),
+                          "TextureManager");
+                failedTextures.insert(texture.path);
+            }
         }
+        // Frames are submitted to the same queue later, so the final barrier orders their sampling after
+        // the blits; the staging ranges are reclaimed once the batch's timeline value is reached.
+        batch.submit();
+    }
+    for (RecordedTexture& texture : recorded) {
+        writeDescriptor(texture);
+    }
+    log_info(std::format("Texture batch: {} uploaded, {} still decoding", decoded.size(), decodeJobs.size()),
+             "TextureManager");
+}
 
-        vk::DeviceSize imageSize =
-            static_cast<vk::DeviceSize>(texWidth) * static_cast<vk::DeviceSize>(texHeight) * 4;
-        mipLevels = static_cast<uint32_t>(
-            std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-
-        createBuffer(imageSize,
-                     vk::BufferUsageFlagBits::eTransferSrc,
-                     vk::MemoryPropertyFlagBits::eHostVisible |
-                         vk::MemoryPropertyFlagBits::eHostCoherent,
-                     stagingBuffer, stagingBufferMemory,
-                     "TextureStagingBufferMemory");
-        setDebugName(device, stagingBuffer, "TextureStagingBuffer");
-
-        void* data = nullptr;
-        vmaMapMemory(allocator.allocator, stagingBufferMemory, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vmaUnmapMemory(allocator.allocator, stagingBufferMemory);
-        stbi_image_free(const_cast<stbi_uc*>(pixels));
-
-        TextureAsset asset{};
-        createImage(static_cast<uint32_t>(texWidth),
-                    static_cast<uint32_t>(texHeight), mipLevels,
-                    vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
-                    vk::ImageUsageFlagBits::eTransferSrc |
-                        vk::ImageUsageFlagBits::eTransferDst |
-                        vk::ImageUsageFlagBits::eSampled,
-                    vk::MemoryPropertyFlagBits::eDeviceLocal,
-                    asset.textureImage, asset.textureImageMemory,
-                    "TextureImageMemory");
-        setDebugName(device, asset.textureImage, "TextureImage");
-        // Approximate full mip chain (~4/3 of base) in RGBA8.
-        const size_t texBytes =
-            static_cast<size_t>(imageSize) + static_cast<size_t>(imageSize) / 3u;
-        tracyResourceAlloc(static_cast<VkImage>(*asset.textureImage), texBytes, "GPU/Textures");
+TextureManager::RecordedTexture TextureManager::recordUpload(UploadBatch& batch, std::string path,
+                                                             const void* pixels, uint32_t width, uint32_t height)
+{
+    ZoneScopedN("TextureManager::recordUpload");
+    const vk::DeviceSize imageSize = static_cast<vk::DeviceSize>(width) * static_cast<vk::DeviceSize>(height) * 4;
+    mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+    RecordedTexture recorded{.path = std::move(path)};
+    TextureAsset& asset = recorded.asset;
+    createImage(width, height, mipLevels,
+                vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eTransferSrc |
+                    vk::ImageUsageFlagBits::eTransferDst |
+                    vk::ImageUsageFlagBits::eSampled,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                asset.textureImage, asset.textureImageMemory,
+                "TextureImageMemory");
+    setDebugName(device, asset.textureImage, "TextureImage");
+    // Approximate full mip chain (~4/3 of base) in RGBA8.
+    const size_t texBytes =
+        static_cast<size_t>(imageSize) + static_cast<size_t>(imageSize) / 3u;
+    tracyResourceAlloc(static_cast<VkImage>(*asset.textureImage), texBytes, "GPU/Textures");
 #ifdef TRACY_ENABLE
-        {
-            const std::string texMsg =
-                std::format("Texture '{}' {}x{} mips={}", path, texWidth, texHeight, mipLevels);
-            TracyMessage(texMsg.c_str(), texMsg.size());
-        }
+    {
+        const std::string texMsg =
+            std::format("Texture '{}' {}x{} mips={}", recorded.path, width, height, mipLevels);
+        TracyMessage(texMsg.c_str(), texMsg.size());
+    }
 #endif
 
-        auto cmdBuffer = beginSingleTimeCommands(graphicsQueue);
-        transitionImageLayout(&cmdBuffer, *asset.textureImage, mipLevels,
-                              vk::ImageLayout::eUndefined,
-                              vk::ImageLayout::eTransferDstOptimal);
-        copyBufferToImage(cmdBuffer, stagingBuffer, asset.textureImage,
-                          static_cast<uint32_t>(texWidth),
-                          static_cast<uint32_t>(texHeight));
-        endSingleTimeCommands(cmdBuffer, graphicsQueue);
+    transitionImageLayout(&batch.commandBuffer(), *asset.textureImage, mipLevels,
+                          vk::ImageLayout::eUndefined,
+                          vk::ImageLayout::eTransferDstOptimal);
+    batch.copyToImage(*asset.textureImage, 0, {width, height, 1}, pixels, imageSize, 4);
+    generateMipmaps(batch.commandBuffer(), asset.textureImage, vk::Format::eR8G8B8A8Srgb,
+                    static_cast<int32_t>(width), static_cast<int32_t>(height), mipLevels);
+
+    recorded.viewInfo = vk::ImageViewCreateInfo{
+        .image = asset.textureImage,
+        .viewType = vk::ImageViewType::e2D,
+        .format = vk::Format::eR8G8B8A8Srgb,
+        .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1}};
+    asset.textureImageView = vk::raii::ImageView(device, recorded.viewInfo);
+    log_info(std::format("STB texture recorded: {}×{}, {} mips", width, height, mipLevels), "TextureManager");
+    return recorded;
+}
+
+void TextureManager::writeDescriptor(RecordedTexture& recorded)
+{
+    descriptorManager.writeImageDescriptor(recorded.asset, recorded.viewInfo);
+    if (streamedTextures.contains(recorded.path)) {
+        streamedByHeapIndex[recorded.asset.descriptorHeapIndex] = recorded.path;
+    }
+    loadedTextures[recorded.path] = std::move(recorded.asset);
+}
+
+void TextureManager::destroyTexture(TextureAsset& asset)
+{
+    if (asset.textureImageMemory != nullptr) {
+        asset.textureImageView = nullptr;
+        VkImage raw = asset.textureImage.release();
+        tracyResourceFree(raw, "GPU/Textures");
+        vmaDestroyImage(allocator.allocator, raw, asset.textureImageMemory);
+        asset.textureImageMemory = nullptr;
+    }
+}
+
+std::optional<TextureManager::RecordedTexture> TextureManager::recordKtxUpload(UploadBatch& batch,
+                                                                              const std::string& path,
+                                                                              ktxTexture* texture,
+                                                                              uint32_t firstLevel)
+{
+    ZoneScopedN("TextureManager::recordKtxUpload");
+    const auto format = static_cast<vk::Format>(ktxTexture_GetVkFormat(texture));
+    if (format == vk::Format::eUndefined) {
+        return std::nullopt;
+    }
+    // The image's level 0 is the file's firstLevel.
+    const uint32_t levels = texture->numLevels - firstLevel;
+    const uint32_t width = std::max(texture->baseWidth >> firstLevel, 1u);
+    const uint32_t height = std::max(texture->baseHeight >> firstLevel, 1u);
+    ktx_size_t imageBytes = 0;
+    for (uint32_t level = firstLevel; level < texture->numLevels; ++level) {
+        imageBytes += ktxTexture_GetImageSize(texture, level);
+    }
 
-        generateMipmaps(asset.textureImage, vk::Format::eR8G8B8A8Srgb,
-                        texWidth, texHeight, mipLevels);
+    RecordedTexture recorded{.path = path};
+    TextureAsset& asset = recorded.asset;
+    createImage(width, height, levels, format, vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, asset.textureImage, asset.textureImageMemory,
+                "TextureImageMemory");
+    setDebugName(device, asset.textureImage, "TextureImage");
+    tracyResourceAlloc(static_cast<VkImage>(*asset.textureImage), imageBytes, "GPU/Textures");
+
+    // Every level comes from the file: copies only, no blits.
+    transitionImageLayout(&batch.commandBuffer(), *asset.textureImage, levels, vk::ImageLayout::eUndefined,
+                          vk::ImageLayout::eTransferDstOptimal);
+    const vk::DeviceSize blockBytes = vk::blockSize(format);
+    for (uint32_t level = 0; level < levels; ++level) {
+        ktx_size_t offset = 0;
+        ktxTexture_GetImageOffset(texture, firstLevel + level, 0, 0, &offset);
+        const vk::Extent3D extent{std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+        batch.copyToImage(*asset.textureImage, level, extent, ktxTexture_GetData(texture) + offset,
+                          ktxTexture_GetImageSize(texture, firstLevel + level), blockBytes);
+    }
+    transitionImageLayout(&batch.commandBuffer(), *asset.textureImage, levels, vk::ImageLayout::eTransferDstOptimal,
+                          vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    recorded.viewInfo = vk::ImageViewCreateInfo{
+        .image = asset.textureImage,
+        .viewType = vk::ImageViewType::e2D,
+        .format = format,
+        .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, levels, 0, 1}};
+    asset.textureImageView = vk::raii::ImageView(device, recorded.viewInfo);
+    log_info(std::format("KTX texture recorded: {}×{}, {} mips (from level {}), format={}", width, height, levels,
+                         firstLevel, vk::to_string(format)),
+             "TextureManager");
+    return recorded;
+}
 
-        vk::ImageViewCreateInfo viewInfo{
-            .image = asset.textureImage,
-            .viewType = vk::ImageViewType::e2D,
-            .format = vk::Format::eR8G8B8A8Srgb,
-            .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1}};
-        asset.textureImageView = vk::raii::ImageView(device, viewInfo);
+// ── mip streaming ─────────────────────────────────────────
 
-        descriptorManager.writeImageDescriptor(asset, viewInfo);
-        loadedTextures[path] = std::move(asset);
+void TextureManager::createFeedbackBuffers()
+{
+    ZoneScopedN("TextureManager::createFeedbackBuffers");
+    constexpr vk::DeviceSize size = sizeof(uint32_t) * kMaxFeedbackTextures;
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        FeedbackBuffer& feedback = mipFeedback[i];
+        // Written by the GPU, read back by the CPU: cached host memory.
+        const vk::BufferCreateInfo bufferInfo{
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            .sharingMode = vk::SharingMode::eExclusive};
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        allocInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        allocator.alocateBuffer(bufferInfo, allocInfo, feedback.buffer, feedback.memory,
+                                std::format("MipFeedbackMemory_{}", i));
+        void* mapped = nullptr;
+        vmaMapMemory(allocator.allocator, feedback.memory, &mapped);
+        feedback.mapped = static_cast<uint32_t*>(mapped);
+        std::memset(feedback.mapped, 0xFF, size);
+        vmaFlushAllocation(allocator.allocator, feedback.memory, 0, VK_WHOLE_SIZE);
+        feedback.address = device.getBufferAddress({.buffer = *feedback.buffer});
+        setDebugName(device, feedback.buffer, std::format("MipFeedback_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*feedback.buffer), size, "GPU/Textures");
+    }
+}
+
+void TextureManager::beginFrame(uint32_t frameSlot, ObjectStorage& storage)
+{
+    ZoneScopedN("TextureManager::beginFrame");
+    ++frameCounter;
+
+    // No frame still in flight samples these images or names these heap slots.
+    while (!retiredTextures.empty() && retiredTextures.front().releaseFrame <= frameCounter) {
+        TextureAsset& asset = retiredTextures.front().asset;
+        // Frames that wrote this slot's feedback are done: clear its word everywhere before the slot is reused,
+        // or the next texture placed there would read the old one's LOD on its first readback.
+        if (asset.descriptorHeapIndex < kMaxFeedbackTextures) {
+            const VkDeviceSize offset = sizeof(uint32_t) * asset.descriptorHeapIndex;
+            for (FeedbackBuffer& feedback : mipFeedback) {
+                if (feedback.mapped != nullptr) {
+                    feedback.mapped[asset.descriptorHeapIndex] = kFeedbackNone;
+                    vmaFlushAllocation(allocator.allocator, feedback.memory, offset, sizeof(uint32_t));
+                }
+            }
+        }
+        descriptorManager.releaseImageDescriptor(asset.descriptorHeapIndex);
+        destroyTexture(asset);
+        retiredTextures.pop_front();
+    }
+
+    if (virtualTextures) {
+        virtualTextures->beginFrame(frameSlot);
+    }
+
+    FeedbackBuffer& feedback = mipFeedback[frameSlot];
+    if (feedback.mapped == nullptr) {
+        return;
+    }
+
+    // This slot's fence has signalled, so its feedback is complete; only streamed heap indices are read and
+    // reset for the frame recorded next. Feedback naming a slot retired since then is ignored.
+    struct LevelChange {
+        std::string path;
+        uint32_t level;
+    };
+    std::vector<LevelChange> changes;
+    const bool windowEnds = frameCounter % kTrimWindowFrames == 0;
+    {
+        ZoneScopedN("TextureManager::readFeedback");
+        vmaInvalidateAllocation(allocator.allocator, feedback.memory, 0, VK_WHOLE_SIZE);
+        for (const auto& [heapIndex, path] : streamedByHeapIndex) {
+            if (heapIndex >= kMaxFeedbackTextures) {
+                continue;
+            }
+            StreamedTexture& streamed = streamedTextures.at(path);
+            uint32_t& word = feedback.mapped[heapIndex];
+            if (word != kFeedbackNone) {
+                const int32_t requested = static_cast<int32_t>(streamed.residentLevel) +
+                    static_cast<int32_t>(word) - kFeedbackLodBias;
+                const auto level =
+                    static_cast<uint32_t>(std::clamp(requested, 0, static_cast<int32_t>(streamed.tailLevel)));
+                streamed.windowLevel = std::min(streamed.windowLevel, level);
+                if (level < streamed.residentLevel) {
+                    changes.push_back({.path = path, .level = level});
+                }
+                word = kFeedbackNone;
+            }
+            if (windowEnds) {
+                if (streamed.windowLevel > streamed.residentLevel) {
+                    changes.push_back({.path = path, .level = streamed.windowLevel});
+                }
+                streamed.windowLevel = streamed.tailLevel;
+            }
+        }
+        vmaFlushAllocation(allocator.allocator, feedback.memory, 0, VK_WHOLE_SIZE);
+    }
+    if (changes.empty()) {
+        return;
+    }
+
+    // Finest requests first: they are the most visibly blurry.
+    std::ranges::sort(changes, {}, &LevelChange::level);
+    std::vector<RecordedTexture> recorded;
+    ktx_size_t uploadedBytes = 0;
+    {
+        UploadBatch batch = uploads.graphicsBatch();
+        for (const LevelChange& change : changes) {
+            StreamedTexture& streamed = streamedTextures.at(change.path);
+            if (change.level == streamed.residentLevel) {
+                continue; // upgraded and trimmed in the same frame
+            }
+            ktx_size_t bytes = 0;
+            for (uint32_t level = change.level; level < streamed.data->numLevels; ++level) {
+                bytes += ktxTexture_GetImageSize(streamed.data.get(), level);
+            }
+            if (!recorded.empty() && uploadedBytes + bytes > kMaxStreamingBytesPerFrame) {
+                continue; // still requested next frame
+            }
+            std::optional<RecordedTexture> texture =
+                recordKtxUpload(batch, change.path, streamed.data.get(), change.level);
+            if (!texture) {
+                continue;
+            }
+            uploadedBytes += bytes;
+            streamed.residentLevel = change.level;
+            recorded.push_back(std::move(*texture));
+        }
+        // Frames are submitted to the same queue later, so they sample the new images after the copies.
+        batch.submit();
+    }
 
-        log_info(std::format("STB texture loaded: {}×{}, {} mips", texWidth, texHeight, mipLevels), "TextureManager");
-        return loadedTextures[path].descriptorHeapIndex;
+    // New heap slot per swap: frames in flight keep sampling the old image through the old slot.
+    for (RecordedTexture& texture : recorded) {
+        TextureAsset& current = loadedTextures.at(texture.path);
+        const uint32_t oldIndex = current.descriptorHeapIndex;
+        streamedByHeapIndex.erase(oldIndex);
+        retiredTextures.push_back({.asset = std::move(current), .releaseFrame = frameCounter + MAX_FRAMES_IN_FLIGHT});
+        writeDescriptor(texture);
+        remapTextureIndex(storage, oldIndex, loadedTextures.at(texture.path).descriptorHeapIndex);
     }
+    TracyPlot("Textures/StreamedBytes", static_cast<double>(uploadedBytes));
+    log_info(std::format("Mip streaming: {} texture(s) swapped, {} KiB uploaded", recorded.size(),
+                         uploadedBytes >> 10),
+             "TextureManager");
+}
+
+void TextureManager::recordFeedbackBarrier(vk::raii::CommandBuffer& commandBuffer) const
+{
+    // One barrier covers the mip feedback and the virtual texture page requests.
+    const vk::MemoryBarrier2 toHost{.srcStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+                                    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                                    .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+                                    .dstAccessMask = vk::AccessFlagBits2::eHostRead};
+    commandBuffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &toHost});
 }
 
 // Find a suitable memory type index on the physical device that satisfies
@@ -298,46 +648,6 @@ uint32_t TextureManager::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyF
     throw std::runtime_error("failed to find suitable memory type");
 }
 
-// Create a buffer of given size/usage and allocate memory through VMA.
-void TextureManager::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-                                  vk::raii::Buffer& buffer, VmaAllocation& bufferMemory,
-                                  std::string_view memoryDebugBaseName)
-{
-    ZoneScopedN("TextureManager::createBuffer");
-    log_info("createBuffer() started", "TextureManager");
-    // const bool needsConcurrent = (usage &
-    // vk::BufferUsageFlagBits::eTransferSrc ||
-    //                               usage &
-    //                               vk::BufferUsageFlagBits::eTransferDst) &&
-    //                              transferQueueFamilyIndex != UINT32_MAX &&
-    //                              transferQueueFamilyIndex !=
-    //                              graphicsQueueFamilyIndex;
-    // TODO currently disable concurrent sharing for buffers until testing is done
-    const bool needsConcurrent = false;
-    vk::BufferCreateInfo bufferInfo{.size = size,
-                                    .usage = usage,
-                                    .sharingMode =
-                                        needsConcurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
-                                    .queueFamilyIndexCount = needsConcurrent ? 2u : 0u,
-                                    .pQueueFamilyIndices = nullptr};
-    VmaAllocationCreateInfo allocInfo{};
-    if (properties & vk::MemoryPropertyFlagBits::eHostVisible)
-    {
-        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-        // Keep host access but avoid CREATE_MAPPED to prevent double map/unmap;
-        // we map explicitly where needed.
-        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-        allocInfo.priority = 0.25f;
-    }
-    else
-    {
-        allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-        allocInfo.priority = 0.75f;
-    }
-
-    allocator.alocateBuffer(bufferInfo, allocInfo, buffer, bufferMemory, memoryDebugBaseName);
-}
-
 // Create an image with the requested properties and allocate GPU memory
 // for it via VMA. Returns the vk::ImageCreateInfo used (for callers that
 // need it).
@@ -383,53 +693,6 @@ vk::ImageCreateInfo TextureManager::createImage(uint32_t width, uint32_t height,
     return imageInfo;
 }
 
-// Allocate and begin a short-lived command buffer for immediate-submit
-// operations (one-time use), returned in recording state.
-vk::raii::CommandBuffer TextureManager::beginSingleTimeCommands(const vk::raii::Queue& queue)
-{
-    ZoneScopedN("TextureManager::beginSingleTimeCommands");
-    log_info("beginSingleTimeCommands() started", "TextureManager");
-    vk::CommandBufferAllocateInfo allocInfo{
-        .commandPool = commandPool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1};
-    auto commandBuffers = device.allocateCommandBuffers(allocInfo);
-    vk::raii::CommandBuffer commandBuffer = std::move(commandBuffers[0]);
-    vk::CommandBufferBeginInfo beginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
-    commandBuffer.begin(beginInfo);
-    return commandBuffer;
-}
-
-// End the one-time command buffer, submit it to the provided queue and
-// wait for completion (synchronous helper).
-void TextureManager::endSingleTimeCommands(vk::raii::CommandBuffer& commandBuffer, const vk::raii::Queue& queue)
-{
-    ZoneScopedN("TextureManager::endSingleTimeCommands");
-    log_info("endSingleTimeCommands() started", "TextureManager");
-    commandBuffer.end();
-    // Prefer synchronization2 submit (avoids WARNING-deprecation-sync2 / legacy QueueSubmit).
-    const vk::CommandBufferSubmitInfo commandBufferInfo{.commandBuffer = *commandBuffer};
-    const vk::SubmitInfo2 submitInfo{.commandBufferInfoCount = 1, .pCommandBufferInfos = &commandBufferInfo};
-    queue.submit2(submitInfo, nullptr);
-    queue.waitIdle();
-}
-
-
-// Record a command to copy buffer contents into the given image (used for
-// staging uploads).
-void TextureManager::copyBufferToImage(vk::raii::CommandBuffer& commandBuffer, const vk::raii::Buffer& buffer,
-                                       const vk::raii::Image& image, uint32_t width, uint32_t height)
-{
-    ZoneScopedN("TextureManager::copyBufferToImage");
-    log_info("copyBufferToImage() started", "TextureManager");
-    vk::BufferImageCopy region{.bufferOffset = 0,
-                               .bufferRowLength = 0,
-                               .bufferImageHeight = 0,
-                               .imageSubresource = {vk::ImageAspectFlagBits::eColor, 0, 0, 1},
-                               .imageOffset = {0, 0, 0},
-                               .imageExtent = {width, height, 1}};
-
-    commandBuffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, {region});
-}
-
 // Generate mipmaps on the GPU by successively blitting between mip levels.
 // Layout strategy (avoids BestPractices-PipelineBarrier-readToReadBarrier):
 //   - Each level is written as TransferDst (base copy or blit destination).
@@ -440,8 +703,9 @@ void TextureManager::copyBufferToImage(vk::raii::CommandBuffer& commandBuffer, c
 //     already-read levels, one barrier covers TransferSrc → ShaderReadOnly (layout change;
 //     availability of the original TransferWrite was established by the earlier Dst→Src
 //     barriers + transfer execution dependency). No per-mip TransferSrc→ShaderRead in the loop.
-void TextureManager::generateMipmaps(vk::raii::Image& image, vk::Format imageFormat, int32_t texWidth,
-                                     int32_t texHeight, uint32_t mipLevelsIn)
+void TextureManager::generateMipmaps(vk::raii::CommandBuffer& commandBuffer, vk::raii::Image& image,
+                                     vk::Format imageFormat, int32_t texWidth, int32_t texHeight,
+                                     uint32_t mipLevelsIn)
 {
     ZoneScopedN("TextureManager::generateMipmaps");
     log_info("generateMipmaps() started", "TextureManager");
@@ -451,8 +715,6 @@ void TextureManager::generateMipmaps(vk::raii::Image& image, vk::Format imageFor
         throw std::runtime_error("Texture image format does not support linear blitting!");
     }
 
-    auto commandBuffer = beginSingleTimeCommands(graphicsQueue);
-
     int32_t mipWidth = texWidth;
     int32_t mipHeight = texHeight;
 
@@ -538,6 +800,4 @@ void TextureManager::generateMipmaps(vk::raii::Image& image, vk::Format imageFor
         const vk::DependencyInfo dep{.imageMemoryBarrierCount = 2, .pImageMemoryBarriers = barriers};
         commandBuffer.pipelineBarrier2(dep);
     }
-
-    endSingleTimeCommands(commandBuffer, graphicsQueue);
 }
@@ -10,30 +10,78 @@
 #include "../util/vk_utils.hpp"
 #include "../static_headers/logger.hpp"
 #include "vk_descriptors.hpp"
+#include "upload_batch.hpp"
+#include "virtual_texture.hpp"
 #include "ktxvulkan.h"
+#include <array>
+#include <deque>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
 
 
 
 // Loads textures into GPU images and registers SampledImage descriptors on the
 // resource heap. Sampling state comes from the DescriptorManager sampler heap
 // (not a VkSampler object).
+// Files are decoded on jobExecutor() workers (requestTexture); PNG/JPG sources
+// are cooked once into UASTC KTX2 with precomputed mips (TextureCache) and
+// transcoded to BC7 there. poll() then packs every finished decode into the
+// shared staging ring and records all copies (+ mip blits for raw RGBA8
+// fallbacks) into one graphics-queue batch with no host wait; a texture's
+// descriptor is written right after the batch is submitted (later frames on the
+// same queue are ordered behind it). Textures that fail to load resolve to a
+// 1x1 white fallback instead of throwing. Large cooked textures are handed to
+// the VirtualTextureCache instead of getting an image of their own
+// (ENGINE_VIRTUAL_TEXTURING): only their pinned page is uploaded here.
+// Other KTX textures stream their mips (ENGINE_MIP_STREAMING): only the levels
+// up to kStreamingTailSize are uploaded at load, fragMain reports the finest
+// level it sampled per heap index, and beginFrame() swaps in an image with the
+// requested levels (or trims one nobody looked at) under a new descriptor. The
+// replaced image and heap slot are released once no frame in flight uses them.
 class TextureManager {
 public:
-    explicit TextureManager(Device &deviceWrapper, const VkAllocator &allocator, DescriptorManager &descriptorManager);
+    explicit TextureManager(Device &deviceWrapper, const VkAllocator &allocator, DescriptorManager &descriptorManager,
+                            UploadContext &uploads);
     ~TextureManager();
 
     void init();
 
-    // Format-detecting texture loader.
-    // Inspects the file extension and routes to the KTX or
-    // stb (PNG/etc.) pipeline accordingly.
+    // Synchronous load: requestTexture + wait for the decode + poll(). Returns the
+    // heap index (the fallback's when the file cannot be loaded).
     [[nodiscard]] uint32_t loadTexture(std::string texturePath);
 
+    // Main thread. Starts decoding unless the texture is resident or already
+    // decoding; returns the key for textureIndex / isTextureReady (the resolved path).
+    std::string requestTexture(std::string_view texturePath);
+    // Main thread, once per frame: uploads every finished decode in one batch.
+    void poll();
+    // Resident (or failed → fallback) textures only.
+    [[nodiscard]] bool isTextureReady(const std::string &key) const;
+    [[nodiscard]] uint32_t textureIndex(const std::string &key) const;
+    // MaterialRef::materialId for key: kVirtualTextureMaterialBit | id for virtual textures, otherwise 0.
+    [[nodiscard]] uint32_t materialId(const std::string &key) const;
+    [[nodiscard]] uint32_t pendingTextureCount() const noexcept { return static_cast<uint32_t>(decodeJobs.size()); }
+
+    // Main thread, after the fence of frameSlot: reads its mip feedback, swaps streamed images (remapping the
+    // entities in storage), releases retired ones and runs the virtual texture streamer.
+    void beginFrame(uint32_t frameSlot, ObjectStorage &storage);
+    // Makes this frame's feedback writes (mip and virtual texture) visible to the host read in beginFrame.
+    void recordFeedbackBarrier(vk::raii::CommandBuffer &commandBuffer) const;
+    // uint32[kMaxFeedbackTextures] of biased LODs indexed by heap index; 0 when mip streaming is off.
+    [[nodiscard]] vk::DeviceAddress feedbackAddress(uint32_t frameSlot) const noexcept
+    {
+        return mipFeedback[frameSlot].address;
+    }
+
     // Stable handles / cached data — direct access
     Device &deviceWrapper;
     const VkAllocator &allocator;
     DescriptorManager &descriptorManager;
+    UploadContext &uploads;
     const vk::raii::PhysicalDevice &physicalDevice;
     const vk::raii::Device &device;
     const vk::raii::Queue &graphicsQueue;
@@ -42,29 +90,84 @@ public:
     uint32_t transferQueueFamilyIndex;
 
     std::unordered_map<std::string, TextureAsset> loadedTextures;
-    vk::raii::CommandPool commandPool = nullptr;
-    vk::raii::Buffer stagingBuffer = nullptr;
-    VmaAllocation stagingBufferMemory = nullptr;
+    std::unordered_set<std::string> failedTextures; // drawn with the fallback
+    TextureAsset fallbackTexture{};
+    // Null when ENGINE_VIRTUAL_TEXTURING is 0; the renderer streams its pages every frame.
+    std::unique_ptr<VirtualTextureCache> virtualTextures;
+    std::unordered_map<std::string, uint32_t> virtualTextureIds;
     vk::ImageViewCreateInfo textureImageViewCreateInfo;
     uint32_t mipLevels = 0;
 
 private:
+    struct StbiDeleter { void operator()(stbi_uc *pixels) const { stbi_image_free(pixels); } };
+    struct KtxDeleter { void operator()(ktxTexture *texture) const { ktxTexture_Destroy(texture); } };
+
+    // CPU result of decodeTexture: KTX file contents or RGBA8 texels; neither on failure.
+    struct DecodedTexture {
+        std::string path;
+        std::unique_ptr<ktxTexture, KtxDeleter> ktx;
+        std::unique_ptr<stbi_uc, StbiDeleter> pixels;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+    // Streamed texture: the file's levels stay on the CPU, the image holds [residentLevel, numLevels).
+    struct StreamedTexture {
+        std::unique_ptr<ktxTexture, KtxDeleter> data;
+        uint32_t residentLevel = 0;
+        uint32_t tailLevel = 0;   // what it is trimmed back to when unused
+        uint32_t windowLevel = 0; // finest level requested in the current trim window
+    };
+    // Replaced image + heap slot, destroyed once frames in flight are done with them.
+    struct RetiredTexture {
+        TextureAsset asset;
+        uint32_t releaseFrame = 0;
+    };
+    struct FeedbackBuffer {
+        vk::raii::Buffer buffer = nullptr;
+        VmaAllocation memory = nullptr;
+        uint32_t *mapped = nullptr;
+        vk::DeviceAddress address = 0;
+    };
+    // Created image + view description; the descriptor is written once its batch is submitted.
+    struct RecordedTexture {
+        std::string path;
+        TextureAsset asset;
+        vk::ImageViewCreateInfo viewInfo;
+    };
+
+    // Reads + decodes one file (cooking PNG/JPG sources through TextureCache, transcoding Basis KTX2 to
+    // transcodeTarget); touches no shared state, runs on jobExecutor() workers.
+    [[nodiscard]] static DecodedTexture decodeTexture(std::string path, ktx_transcode_fmt_e transcodeTarget);
+    // Creates the image and records copy + mip chain for RGBA8 texels into batch.
+    [[nodiscard]] RecordedTexture recordUpload(UploadBatch &batch, std::string path, const void *pixels,
+                                               uint32_t width, uint32_t height);
+    // Creates the image and records copies of the stored levels from firstLevel on; nullopt for formats Vulkan
+    // cannot name.
+    [[nodiscard]] std::optional<RecordedTexture> recordKtxUpload(UploadBatch &batch, const std::string &path,
+                                                                 ktxTexture *texture, uint32_t firstLevel = 0);
+    void writeDescriptor(RecordedTexture &recorded);
+    void destroyTexture(TextureAsset &asset);
+    void createFeedbackBuffers();
+
+    std::unordered_map<std::string, std::future<DecodedTexture>> decodeJobs;
+    std::unordered_map<std::string, StreamedTexture> streamedTextures;
+    std::unordered_map<uint32_t, std::string> streamedByHeapIndex;
+    std::deque<RetiredTexture> retiredTextures;
+    std::array<FeedbackBuffer, MAX_FRAMES_IN_FLIGHT> mipFeedback;
+    uint32_t frameCounter = 0;
+    // BC7 when the device samples BC formats, otherwise uncompressed RGBA8.
+    ktx_transcode_fmt_e transcodeTarget = KTX_TTF_RGBA32;
+
     // Resolve a path relative to the executable directory if it's a relative path
     [[nodiscard]] std::string resolvePath(std::string_view path);
 
     auto findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) -> uint32_t;
-    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
-                      vk::raii::Buffer &buffer, VmaAllocation &bufferMemory,
-                      std::string_view memoryDebugBaseName = "TextureBufferMemory");
     vk::ImageCreateInfo createImage(uint32_t width, uint32_t height, uint32_t mipLevelsIn, vk::Format format,
                      vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags properties,
                      vk::raii::Image &image, VmaAllocation &imageMemory,
                      std::string_view memoryDebugBaseName = "TextureImageMemory");
 
-    auto beginSingleTimeCommands(const vk::raii::Queue &queue) -> vk::raii::CommandBuffer;
-    void endSingleTimeCommands(vk::raii::CommandBuffer &commandBuffer, const vk::raii::Queue &queue);
-    void copyBufferToImage(vk::raii::CommandBuffer &commandBuffer, const vk::raii::Buffer &buffer,
-                           const vk::raii::Image &image, uint32_t width, uint32_t height);
-    void generateMipmaps(vk::raii::Image &image, vk::Format imageFormat, int32_t texWidth, int32_t texHeight,
-                         uint32_t mipLevels);
+    // Records the blit chain into commandBuffer; leaves every level in ShaderReadOnlyOptimal.
+    void generateMipmaps(vk::raii::CommandBuffer &commandBuffer, vk::raii::Image &image, vk::Format imageFormat,
+                         int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 };
@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <limits>
+#include "../Constants.h"
 
 
 struct TextureAsset {
@@ -26,38 +29,122 @@ static_assert(sizeof(Vertex) == 32, "Vertex must stay 32 B for mesh BDA / scalar
 static_assert(offsetof(Vertex, color) == 12);
 static_assert(offsetof(Vertex, texCoord) == 24);
 
-namespace std
+// Compact GPU vertex (ENGINE_PACKED_VERTICES, matches mesh.slang PackedVertex, 16 B). Positions are snorm16
+// relative to the mesh's object-space bounding sphere (ObjectUB::meshBounds): pos = center + radius * q / 32767.
+// The constant color is dropped. Built from Vertex by AssetsLoader::allocateGeometry.
+struct PackedVertex
 {
-    template <>
-    struct hash<Vertex>
-    {
-        size_t operator()(Vertex const& vertex) const
-        {
-            return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-} // namespace std
+    int16_t position[4]; // xyz quantized, w = 0
+    uint32_t texCoord; // half2 (x in the low 16 bits)
+    uint32_t normal; // octahedral snorm16x2 slot; the loaders import no normals yet, so 0
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match mesh.slang (uint2 + uint + uint, 16 B)");
+static_assert(offsetof(PackedVertex, texCoord) == 8);
+static_assert(offsetof(PackedVertex, normal) == 12);
+
+// Element type of the GPU vertex table.
+#if ENGINE_PACKED_VERTICES
+using GpuVertex = PackedVertex;
+#else
+using GpuVertex = Vertex;
+#endif
+
 
+// parentLodError of meshlets no coarser level replaces (DAG roots).
+inline constexpr float kMeshletLodRootError = std::numeric_limits<float>::max();
 
 // GPU-friendly meshlet header (CPU layout matches mesh.slang MeshletDesc / SSBO).
+// A mesh's meshlets form a cluster LOD DAG (AssetsLoader::buildMeshletLods): the task shader draws a meshlet
+// when its own projected error is under the pixel threshold and its parent group's is not. Siblings share
+// lodSphere/lodError and children of one group share parentLodSphere/parentLodError, so a group is always
+// swapped as a whole.
 struct alignas(16) MeshletDesc
 {
     uint32_t vertexOffset = 0; // into meshletVertices
     uint32_t triangleOffset = 0; // into meshletTriangles (first corner index)
-    uint32_t vertexCount = 0;
-    uint32_t triangleCount = 0;
+    uint16_t vertexCount = 0; // <= 64, shares one uint with triangleCount on the GPU
+    uint16_t triangleCount = 0; // <= 126
+    uint32_t cone = 0; // snorm8 x4: cone axis xyz + cutoff (meshopt cone_axis_s8 / cone_cutoff_s8)
     glm::vec4 boundingSphere{0.0f}; // xyz = center, w = radius (object space)
+    glm::vec4 lodSphere{0.0f}; // object space bounds of the group this meshlet was simplified from
+    glm::vec4 parentLodSphere{0.0f}; // bounds of the group this meshlet was simplified into
+    float lodError = 0.0f; // object space simplification error of this meshlet (0 = source geometry)
+    float parentLodError = kMeshletLodRootError;
+    uint32_t lodLevel = 0; // 0 = source geometry
+    uint32_t reserved = 0;
 };
-static_assert(sizeof(MeshletDesc) == 32, "MeshletDesc must match mesh.slang (4x uint + float4, 32 B)");
+static_assert(sizeof(MeshletDesc) == 80, "MeshletDesc must match mesh.slang (4x uint + 3x float4 + 4x 32-bit, 80 B)");
+static_assert(offsetof(MeshletDesc, cone) == 12);
+static_assert(offsetof(MeshletDesc, boundingSphere) == 16);
+static_assert(offsetof(MeshletDesc, lodSphere) == 32);
+static_assert(offsetof(MeshletDesc, lodError) == 64);
 
 // Per-entity range into the global meshlet arrays.
 struct MeshletDraw
 {
     uint32_t firstMeshlet = 0;
     uint32_t meshletCount = 0;
+    glm::vec4 boundingSphere{0.0f}; // object-space bounds of the whole range (w = 0: unknown)
+};
+
+// Discrete mesh LODs (AssetsLoader::buildDiscreteLods, selectMeshLods), only for meshes without a cluster LOD DAG.
+// LOD i keeps about kMeshLodRatios[i] of the source triangles and is drawn once the bounding sphere covers less
+// than kMeshLodScreenSizes[i] of the viewport height. All LODs share the mesh's vertices.
+inline constexpr uint32_t kMaxMeshLods = 4;
+inline constexpr std::array<float, kMaxMeshLods> kMeshLodRatios{1.0f, 0.5f, 0.25f, 0.1f};
+inline constexpr std::array<float, kMaxMeshLods> kMeshLodScreenSizes{1.0f, 0.25f, 0.1f, 0.04f};
+
+// An entity's meshlet range per discrete LOD, finest first.
+struct MeshLodChain
+{
+    std::array<MeshletDraw, kMaxMeshLods> lods{};
+    uint32_t lodCount = 1;
+};
+
+// One mesh's sub-ranges of the shared geometry arenas (GeometryPool), in elements.
+struct GeometryRanges
+{
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    uint32_t firstMeshletVertex = 0;
+    uint32_t meshletVertexCount = 0;
+    uint32_t firstMeshletTriangle = 0;
+    uint32_t meshletTriangleCount = 0;
 };
 
+// Per-entity input of the GPU cull pass (matches cull.slang InstanceDraw, 16 B).
+struct InstanceDraw
+{
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    uint32_t textureIndex = 0;
+    uint32_t flags = 0; // EntityFlag bits
+};
+static_assert(sizeof(InstanceDraw) == 16, "InstanceDraw must match cull.slang (4x uint, 16 B)");
+
+// One indirect mesh-task command per visible entity, written by cull.slang.
+// The first 12 bytes are VkDrawMeshTasksIndirectCommandEXT; the rest is read by mesh.slang
+// (textureIndex/samplerIndex form the texture DescriptorHandle).
+struct DrawMeshTasksCommand
+{
+    uint32_t groupCountX;
+    uint32_t groupCountY;
+    uint32_t groupCountZ;
+    uint32_t entityId;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    uint32_t textureIndex;
+    uint32_t samplerIndex;
+};
+static_assert(sizeof(DrawMeshTasksCommand) == 32, "DrawMeshTasksCommand must match mesh.slang / cull.slang");
+static_assert(offsetof(DrawMeshTasksCommand, entityId) == 12);
+
+// MaterialRef::materialId / ObjectUB::materialID: with this bit set the low bits are a VirtualTextureCache id and
+// fragMain samples through the page table instead of the texture handle.
+inline constexpr uint32_t kVirtualTextureMaterialBit = 1u << 31;
+
 struct MaterialRef
 {
     uint32_t textureIndex = 0;
@@ -96,7 +183,11 @@ struct alignas(16) CameraData {
     glm::vec2 jitterOffset;    // TAA subpixel jitter offset
     float farZ;                // Far clipping plane
     float frameDeltaTime;      // Delta time in seconds
-    glm::vec4 cameraParams; // reserved
+    glm::vec4 cameraParams; // x = cluster LOD error threshold in pixels (0 = full detail), yzw reserved
+
+    // World-space frustum planes for GPU culling (xyz = inward normal, w = distance).
+    // Order: left, right, bottom, top, near, far.
+    glm::vec4 frustumPlanes[6];
 };
 
 struct alignas(16) ObjectUB {
@@ -109,7 +200,8 @@ struct alignas(16) ObjectUB {
     // uint64_t indexBufferAddress;  // GPU Virtual Address of index array (8 bytes)
 
     // Bounding Box / Sphere for GPU Culling (Frustum & Occlusion)
-    glm::vec4 boundingSphere;     // xyz = center, w = radius (16 bytes)
+    glm::vec4 boundingSphere;     // world space: xyz = center, w = radius, 0 = unknown (16 bytes)
+    glm::vec4 meshBounds;         // object space mesh sphere PackedVertex positions are relative to (16 bytes)
 
     // Resource & Material Handles
     uint32_t materialID;          // Index into global Material SSBO array (4 bytes)
@@ -117,6 +209,8 @@ struct alignas(16) ObjectUB {
     uint32_t baseVertex;          // Vertex offset in buffer (4 bytes)
     uint32_t baseIndex;           // Index offset in buffer (4 bytes)
 };
+// scatter.slang copies ObjectUBs as kObjectUbWords uint4s.
+static_assert(sizeof(ObjectUB) == 160, "ObjectUB must stay 10 x 16 B (scatter.slang kObjectUbWords)");
 
 
 struct EngineSettings
@@ -0,0 +1,362 @@
+#include "upload_batch.hpp"
+#include "../static_headers/logger.hpp"
+#include "../util/debug.hpp"
+#include "../util/vk_tracy.hpp"
+#include "../util/vk_utils.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    bool hasDedicatedTransfer(const Device& device)
+    {
+        return device.transferIndex != UINT32_MAX && device.transferIndex != device.graphicsIndex;
+    }
+} // anonymous namespace
+
+// ── StagingRing ─────────────────────────────────────────────
+
+StagingRing::StagingRing(const vk::raii::Device& deviceIn, const VkAllocator& allocatorIn,
+                         const std::vector<uint32_t>& queueFamilyIndicesIn, vk::DeviceSize capacity) :
+    device(deviceIn), allocator(allocatorIn), queueFamilyIndices(queueFamilyIndicesIn), ringCapacity(capacity)
+{
+    ZoneScopedN("StagingRing::StagingRing");
+    if (!std::has_single_bit(capacity)) {
+        throw std::runtime_error(std::format("StagingRing capacity {} is not a power of two", capacity));
+    }
+    createBuffer(ringCapacity, vk::BufferUsageFlagBits::eTransferSrc,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, ringBuffer,
+                 ringMemory, allocator.allocator, device, queueFamilyIndices, "StagingRingMemory",
+                 VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    setDebugName(device, ringBuffer, "StagingRing");
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator.allocator, ringMemory, &info);
+    ringMapped = static_cast<std::byte*>(info.pMappedData);
+    tracyResourceAlloc(static_cast<VkBuffer>(*ringBuffer), static_cast<size_t>(ringCapacity), "GPU/StagingRing");
+    log_info(std::format("Staging ring created: {} MiB", ringCapacity >> 20), "StagingRing");
+}
+
+StagingRing::~StagingRing()
+{
+    // Engine::cleanup idles the device first, so every region is complete.
+    for (Region& region : regions) {
+        destroyDedicated(region.dedicated);
+    }
+    regions.clear();
+    destroyDedicated(openDedicated);
+    if (ringMemory != nullptr) {
+        VkBuffer raw = ringBuffer.release();
+        tracyResourceFree(raw, "GPU/StagingRing");
+        vmaDestroyBuffer(allocator.allocator, raw, ringMemory);
+        ringMemory = nullptr;
+    }
+}
+
+std::optional<StagingAllocation> StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    assert(std::has_single_bit(alignment) && alignment <= ringCapacity);
+    if (size > ringCapacity) {
+        return allocateDedicated(size);
+    }
+
+    for (;;) {
+        uint64_t position = alignUp(head, alignment);
+        // An allocation never straddles the end of the buffer: skip the remainder and start the next lap.
+        if (position % ringCapacity + size > ringCapacity) {
+            position = alignUp(position, ringCapacity);
+        }
+        if (position + size - tail <= ringCapacity) {
+            head = position + size;
+            const vk::DeviceSize offset = position % ringCapacity;
+            return StagingAllocation{
+                .buffer = *ringBuffer, .memory = ringMemory, .offset = offset, .mapped = ringMapped + offset};
+        }
+        if (regions.empty()) {
+            return std::nullopt;
+        }
+        if (reclaim() == 0) {
+            ZoneScopedN("StagingRing::waitForSpace");
+            const Region& oldest = regions.front();
+            const vk::SemaphoreWaitInfo waitInfo{
+                .semaphoreCount = 1, .pSemaphores = &**oldest.timeline, .pValues = &oldest.value};
+            (void)device.waitSemaphores(waitInfo, UINT64_MAX);
+            reclaim();
+        }
+    }
+}
+
+StagingAllocation StagingRing::allocateDedicated(vk::DeviceSize size)
+{
+    ZoneScopedN("StagingRing::allocateDedicated");
+    log_info(std::format("Staging request of {} bytes exceeds the ring, using a dedicated buffer", size),
+             "StagingRing");
+    vk::raii::Buffer buffer = nullptr;
+    VmaAllocation memory = nullptr;
+    createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer, memory,
+                 allocator.allocator, device, queueFamilyIndices, "StagingDedicatedMemory",
+                 VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    setDebugName(device, buffer, "StagingDedicated");
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(allocator.allocator, memory, &info);
+    VkBuffer raw = buffer.release();
+    tracyResourceAlloc(raw, static_cast<size_t>(size), "GPU/StagingDedicated");
+    openDedicated.push_back(DedicatedBuffer{.buffer = raw, .memory = memory});
+    return StagingAllocation{
+        .buffer = raw, .memory = memory, .offset = 0, .mapped = static_cast<std::byte*>(info.pMappedData)};
+}
+
+void StagingRing::flush(const StagingAllocation& allocation, vk::DeviceSize size) const
+{
+    vmaFlushAllocation(allocator.allocator, allocation.memory, allocation.offset, size);
+}
+
+void StagingRing::release(const vk::raii::Semaphore& timeline, uint64_t value)
+{
+    if (head == released && openDedicated.empty()) {
+        return;
+    }
+    regions.push_back(Region{.end = head, .timeline = &timeline, .value = value, .dedicated = std::move(openDedicated)});
+    openDedicated.clear();
+    released = head;
+}
+
+uint32_t StagingRing::reclaim()
+{
+    // FIFO: a region completing before an older one (other queue) waits for it.
+    uint32_t reclaimed = 0;
+    while (!regions.empty() && regions.front().timeline->getCounterValue() >= regions.front().value) {
+        tail = regions.front().end;
+        destroyDedicated(regions.front().dedicated);
+        regions.pop_front();
+        ++reclaimed;
+    }
+    return reclaimed;
+}
+
+uint32_t StagingRing::dedicatedBufferCount() const noexcept
+{
+    size_t count = openDedicated.size();
+    for (const Region& region : regions) {
+        count += region.dedicated.size();
+    }
+    return static_cast<uint32_t>(count);
+}
+
+void StagingRing::destroyDedicated(std::vector<DedicatedBuffer>& buffers)
+{
+    for (const DedicatedBuffer& dedicated : buffers) {
+        tracyResourceFree(dedicated.buffer, "GPU/StagingDedicated");
+        vmaDestroyBuffer(allocator.allocator, dedicated.buffer, dedicated.memory);
+    }
+    buffers.clear();
+}
+
+// ── UploadQueue ─────────────────────────────────────────────
+
+UploadQueue::UploadQueue(const vk::raii::Device& deviceIn, const vk::raii::Queue& queueIn, uint32_t queueFamilyIndex,
+                         std::string_view nameIn) :
+    familyIndex(queueFamilyIndex), device(deviceIn), queue(queueIn), name(nameIn)
+{
+    commandPool = vk::raii::CommandPool(
+        device, {.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+                 .queueFamilyIndex = familyIndex});
+    setDebugName(device, commandPool, std::format("{}CommandPool", name));
+
+    const vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> timelineInfo{
+        {}, {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}};
+    timelineSemaphore = vk::raii::Semaphore(device, timelineInfo.get<vk::SemaphoreCreateInfo>());
+    setDebugName(device, timelineSemaphore, std::format("{}Timeline", name));
+}
+
+vk::raii::CommandBuffer& UploadQueue::begin()
+{
+    ZoneScopedN("UploadQueue::begin");
+    const uint64_t completed = completedValue();
+    const auto reusable = std::ranges::find_if(
+        slots, [completed](const Slot& slot) { return !slot.recording && slot.value <= completed; });
+    Slot* slot = nullptr;
+    if (reusable != slots.end()) {
+        slot = &*reusable;
+        slot->commandBuffer.reset();
+    } else {
+        vk::raii::CommandBuffers buffers(device, {.commandPool = *commandPool,
+                                                  .level = vk::CommandBufferLevel::ePrimary,
+                                                  .commandBufferCount = 1});
+        slot = &slots.emplace_back(Slot{.commandBuffer = std::move(buffers.front())});
+        setDebugName(device, slot->commandBuffer, std::format("{}CommandBuffer_{}", name, slots.size() - 1));
+    }
+    slot->recording = true;
+    slot->commandBuffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    return slot->commandBuffer;
+}
+
+uint64_t UploadQueue::submit(vk::raii::CommandBuffer& commandBuffer)
+{
+    ZoneScopedN("UploadQueue::submit");
+    const auto slot =
+        std::ranges::find_if(slots, [&commandBuffer](const Slot& s) { return &s.commandBuffer == &commandBuffer; });
+    assert(slot != slots.end() && slot->recording);
+    commandBuffer.end();
+    slot->value = ++nextValue;
+    slot->recording = false;
+
+    const vk::CommandBufferSubmitInfo commandBufferInfo{.commandBuffer = *commandBuffer};
+    const vk::SemaphoreSubmitInfo signalSemaphoreInfo{.semaphore = *timelineSemaphore,
+                                                      .value = slot->value,
+                                                      .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+    const vk::SubmitInfo2 submitInfo{.commandBufferInfoCount = 1,
+                                     .pCommandBufferInfos = &commandBufferInfo,
+                                     .signalSemaphoreInfoCount = 1,
+                                     .pSignalSemaphoreInfos = &signalSemaphoreInfo};
+    queue.submit2(submitInfo, nullptr);
+    return slot->value;
+}
+
+void UploadQueue::wait(uint64_t value) const
+{
+    ZoneScopedN("UploadQueue::wait");
+    const vk::SemaphoreWaitInfo waitInfo{.semaphoreCount = 1, .pSemaphores = &*timelineSemaphore, .pValues = &value};
+    (void)device.waitSemaphores(waitInfo, UINT64_MAX);
+}
+
+uint64_t UploadQueue::completedValue() const
+{
+    return timelineSemaphore.getCounterValue();
+}
+
+// ── UploadBatch ─────────────────────────────────────────────
+
+UploadBatch::UploadBatch(StagingRing& ringIn, UploadQueue& queueIn) : ring(ringIn), queue(queueIn) {}
+
+UploadBatch::~UploadBatch()
+{
+    if (recording != nullptr) {
+        submit();
+    }
+}
+
+vk::raii::CommandBuffer& UploadBatch::recordingBuffer()
+{
+    if (recording == nullptr) {
+        recording = &queue.begin();
+    }
+    return *recording;
+}
+
+void UploadBatch::recordPendingCopies()
+{
+    if (pendingRegions.empty()) {
+        return;
+    }
+    recordingBuffer().copyBuffer(pendingSource, pendingDestination, pendingRegions);
+    pendingRegions.clear();
+}
+
+StagingAllocation UploadBatch::reserve(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    std::optional<StagingAllocation> allocation = ring.allocate(size, alignment);
+    if (!allocation) {
+        // The ring is full of this batch's own data: submit it so the ring can wait for it.
+        submit();
+        allocation = ring.allocate(size, alignment);
+        if (!allocation) {
+            throw std::runtime_error(std::format("StagingRing cannot fit {} bytes", size));
+        }
+    }
+    recordingBuffer();
+    return *allocation;
+}
+
+StagingAllocation UploadBatch::stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment)
+{
+    ZoneScopedN("UploadBatch::stage");
+    const StagingAllocation allocation = reserve(size, alignment);
+    std::memcpy(allocation.mapped, data, static_cast<size_t>(size));
+    ring.flush(allocation, size);
+    return allocation;
+}
+
+void UploadBatch::copyToBuffer(vk::Buffer destination, vk::DeviceSize destinationOffset, const void* data,
+                               vk::DeviceSize size)
+{
+    if (size == 0) {
+        return;
+    }
+    const StagingAllocation staging = stage(data, size);
+    copyBuffer(staging.buffer, destination,
+               vk::BufferCopy{.srcOffset = staging.offset, .dstOffset = destinationOffset, .size = size});
+}
+
+void UploadBatch::copyToImage(vk::Image destination, uint32_t mipLevel, vk::Extent3D extent, const void* data,
+                              vk::DeviceSize size, vk::DeviceSize texelBytes, vk::Offset3D offset,
+                              vk::ImageLayout layout)
+{
+    // bufferOffset must be a multiple of the texel / block size (and of 4).
+    const StagingAllocation staging = stage(data, size, std::bit_ceil(std::max<vk::DeviceSize>(texelBytes, 4)));
+    const vk::BufferImageCopy region{.bufferOffset = staging.offset,
+                                     .bufferRowLength = 0,
+                                     .bufferImageHeight = 0,
+                                     .imageSubresource = {vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1},
+                                     .imageOffset = offset,
+                                     .imageExtent = extent};
+    commandBuffer().copyBufferToImage(staging.buffer, destination, layout, region);
+}
+
+void UploadBatch::copyBuffer(vk::Buffer source, vk::Buffer destination, const vk::BufferCopy& region)
+{
+    if (!pendingRegions.empty() && (source != pendingSource || destination != pendingDestination)) {
+        recordPendingCopies();
+    }
+    pendingSource = source;
+    pendingDestination = destination;
+    pendingRegions.push_back(region);
+}
+
+vk::raii::CommandBuffer& UploadBatch::commandBuffer()
+{
+    recordPendingCopies();
+    return recordingBuffer();
+}
+
+uint64_t UploadBatch::submit()
+{
+    ZoneScopedN("UploadBatch::submit");
+    if (recording == nullptr) {
+        return queue.lastSubmittedValue();
+    }
+    recordPendingCopies();
+    const uint64_t value = queue.submit(*recording);
+    recording = nullptr;
+    ring.release(queue.timeline(), value);
+    return value;
+}
+
+void UploadBatch::submitAndWait()
+{
+    queue.wait(submit());
+}
+
+// ── UploadContext ───────────────────────────────────────────
+
+UploadContext::UploadContext(const Device& device, const VkAllocator& allocator) :
+    staging(device.vkdevice, allocator, device.queueFamilyIndices),
+    graphics(device.vkdevice, device.graphicsQueue, device.graphicsIndex, "GraphicsUpload")
+{
+    if (hasDedicatedTransfer(device)) {
+        dedicatedTransfer.emplace(device.vkdevice, device.transferQueue, device.transferIndex, "TransferUpload");
+    }
+    log_info(std::format("Upload queues: graphics family {}, buffer uploads on family {}", device.graphicsIndex,
+                         transfer().familyIndex),
+             "UploadContext");
+}
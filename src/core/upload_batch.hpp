@@ -0,0 +1,204 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+#include "vk_allocator.hpp"
+#include "vk_device.hpp"
+
+// Host-visible copy source handed out by StagingRing::allocate / UploadBatch::stage.
+struct StagingAllocation
+{
+    vk::Buffer buffer;
+    VmaAllocation memory = nullptr;
+    vk::DeviceSize offset = 0; // into buffer (and memory)
+    std::byte* mapped = nullptr;
+};
+
+// One persistently mapped host-visible buffer shared by every upload. Space is handed out FIFO and
+// returned once the timeline value of the submit that read it is reached, so steady-state uploads create
+// no VMA allocations and never idle a queue. Requests larger than the ring get a dedicated buffer with the
+// same lifetime. Main thread only.
+class StagingRing
+{
+public:
+    static constexpr vk::DeviceSize kDefaultCapacity = 64ull * 1024 * 1024;
+
+    // capacity must be a power of two.
+    StagingRing(const vk::raii::Device& device, const VkAllocator& allocator,
+                const std::vector<uint32_t>& queueFamilyIndices, vk::DeviceSize capacity = kDefaultCapacity);
+    ~StagingRing();
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    // Blocks on the oldest submitted region while the ring is full. nullopt when the missing space is held
+    // by allocations that were never released: the caller has to submit them first.
+    [[nodiscard]] std::optional<StagingAllocation> allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+    // Makes host writes to [allocation.offset, +size) visible to the device (no-op on coherent memory).
+    void flush(const StagingAllocation& allocation, vk::DeviceSize size) const;
+    // Everything allocated since the previous release() is read by the submit signalling (timeline, value).
+    void release(const vk::raii::Semaphore& timeline, uint64_t value);
+    // Returns the space of completed submits to the ring without blocking; returns the regions reclaimed.
+    uint32_t reclaim();
+
+    [[nodiscard]] vk::DeviceSize capacity() const noexcept { return ringCapacity; }
+    [[nodiscard]] vk::DeviceSize usedBytes() const noexcept { return head - tail; }
+    [[nodiscard]] uint32_t pendingRegionCount() const noexcept { return static_cast<uint32_t>(regions.size()); }
+    [[nodiscard]] uint32_t dedicatedBufferCount() const noexcept;
+
+private:
+    struct DedicatedBuffer
+    {
+        VkBuffer buffer;
+        VmaAllocation memory;
+    };
+    struct Region
+    {
+        uint64_t end; // ring position just past the region's last allocation
+        const vk::raii::Semaphore* timeline;
+        uint64_t value;
+        std::vector<DedicatedBuffer> dedicated;
+    };
+
+    StagingAllocation allocateDedicated(vk::DeviceSize size);
+    void destroyDedicated(std::vector<DedicatedBuffer>& buffers);
+
+    const vk::raii::Device& device;
+    const VkAllocator& allocator;
+    const std::vector<uint32_t>& queueFamilyIndices;
+
+    vk::raii::Buffer ringBuffer = nullptr;
+    VmaAllocation ringMemory = nullptr;
+    std::byte* ringMapped = nullptr;
+    vk::DeviceSize ringCapacity = 0;
+
+    // Monotonic positions (byte offset = position % capacity): tail <= released <= head.
+    uint64_t tail = 0;
+    uint64_t released = 0;
+    uint64_t head = 0;
+    std::deque<Region> regions;
+    std::vector<DedicatedBuffer> openDedicated; // allocated since the last release()
+};
+
+// A queue uploads are submitted to: its timeline semaphore and recycled one-time command buffers.
+class UploadQueue
+{
+public:
+    UploadQueue(const vk::raii::Device& device, const vk::raii::Queue& queue, uint32_t queueFamilyIndex,
+                std::string_view name);
+
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    // A command buffer in the recording state, reused once the submit that last used it has completed.
+    [[nodiscard]] vk::raii::CommandBuffer& begin();
+    // Ends and submits a command buffer from begin(); returns the timeline value the submit signals.
+    uint64_t submit(vk::raii::CommandBuffer& commandBuffer);
+
+    void wait(uint64_t value) const;
+    [[nodiscard]] uint64_t completedValue() const;
+    [[nodiscard]] uint64_t lastSubmittedValue() const noexcept { return nextValue; }
+    [[nodiscard]] const vk::raii::Semaphore& timeline() const noexcept { return timelineSemaphore; }
+
+    const uint32_t familyIndex;
+
+private:
+    struct Slot
+    {
+        vk::raii::CommandBuffer commandBuffer = nullptr;
+        uint64_t value = 0; // timeline value of the last submit that used it
+        bool recording = false;
+    };
+
+    const vk::raii::Device& device;
+    const vk::raii::Queue& queue;
+    std::string name;
+    vk::raii::CommandPool commandPool = nullptr;
+    vk::raii::Semaphore timelineSemaphore = nullptr;
+    std::deque<Slot> slots; // deque: begin() hands out references that must survive growth
+    uint64_t nextValue = 0;
+};
+
+// Records many copies sourced from the staging ring into one command buffer and submits them together.
+// Consecutive buffer copies between the same pair of buffers are merged into one vkCmdCopyBuffer.
+// stage() flushes the batch early when the ring is full, so commandBuffer() is only valid until the next
+// stage()/copy call. Destroying a batch submits whatever it still holds.
+class UploadBatch
+{
+public:
+    UploadBatch(StagingRing& ring, UploadQueue& queue);
+    ~UploadBatch();
+
+    UploadBatch(const UploadBatch&) = delete;
+    UploadBatch& operator=(const UploadBatch&) = delete;
+
+    // Copies size bytes into staging memory for a copy command recorded by the caller.
+    [[nodiscard]] StagingAllocation stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment = 16);
+    void copyToBuffer(vk::Buffer destination, vk::DeviceSize destinationOffset, const void* data,
+                      vk::DeviceSize size);
+    // copyToBuffer without a source array: write(std::byte*) fills the size staging bytes in place.
+    template <typename Write>
+    void writeToBuffer(vk::Buffer destination, vk::DeviceSize destinationOffset, vk::DeviceSize size, Write&& write)
+    {
+        if (size == 0) {
+            return;
+        }
+        const StagingAllocation staging = reserve(size, 16);
+        write(staging.mapped);
+        ring.flush(staging, size);
+        copyBuffer(staging.buffer, destination,
+                   vk::BufferCopy{.srcOffset = staging.offset, .dstOffset = destinationOffset, .size = size});
+    }
+    // Copies tightly packed texels into a region of one mip of a color image (in layout, eTransferDstOptimal by
+    // default). For block-compressed formats texelBytes is the block size and offset is block-aligned.
+    void copyToImage(vk::Image destination, uint32_t mipLevel, vk::Extent3D extent, const void* data,
+                     vk::DeviceSize size, vk::DeviceSize texelBytes, vk::Offset3D offset = {},
+                     vk::ImageLayout layout = vk::ImageLayout::eTransferDstOptimal);
+    // Device-to-device copy recorded in order with the staged ones.
+    void copyBuffer(vk::Buffer source, vk::Buffer destination, const vk::BufferCopy& region);
+
+    // For barriers / blits between copies. Pending merged copies are recorded first.
+    [[nodiscard]] vk::raii::CommandBuffer& commandBuffer();
+
+    // Submits everything recorded so far and returns the signalled timeline value (the queue's last
+    // submitted value when the batch is empty).
+    uint64_t submit();
+    // submit() + host wait: for callers that read the result on the CPU or destroy the source right after.
+    void submitAndWait();
+
+    [[nodiscard]] UploadQueue& uploadQueue() const noexcept { return queue; }
+
+private:
+    // Staging space for size bytes; submits the batch first when the ring is full of its own data.
+    [[nodiscard]] StagingAllocation reserve(vk::DeviceSize size, vk::DeviceSize alignment);
+    vk::raii::CommandBuffer& recordingBuffer();
+    void recordPendingCopies();
+
+    StagingRing& ring;
+    UploadQueue& queue;
+    vk::raii::CommandBuffer* recording = nullptr;
+
+    vk::Buffer pendingSource;
+    vk::Buffer pendingDestination;
+    std::vector<vk::BufferCopy> pendingRegions;
+};
+
+// Staging ring + the upload queues shared by ResourceManager, TextureManager and AssetStreamer. Uploads
+// that blit (mip generation) go to graphics; buffer uploads to the dedicated transfer family when present.
+class UploadContext
+{
+public:
+    UploadContext(const Device& device, const VkAllocator& allocator);
+
+    [[nodiscard]] UploadQueue& transfer() noexcept { return dedicatedTransfer ? *dedicatedTransfer : graphics; }
+    [[nodiscard]] UploadBatch graphicsBatch() { return UploadBatch(staging, graphics); }
+    [[nodiscard]] UploadBatch transferBatch() { return UploadBatch(staging, transfer()); }
+
+    StagingRing staging;
+    UploadQueue graphics;
+    std::optional<UploadQueue> dedicatedTransfer;
+};
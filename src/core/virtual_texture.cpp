@@ -0,0 +1,481 @@
+#include "virtual_texture.hpp"
+#include "../static_headers/logger.hpp"
+#include "../util/vk_tracy.hpp"
+#include "../util/vk_utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <functional>
+
+namespace {
+
+// 32 x 32 tiles of 136 texels: 4352² texels, 18 MiB as BC7 (72 MiB as RGBA8).
+constexpr uint32_t kAtlasTilesPerSide = 32;
+// Page table entries per frame slot; a 16K x 16K texture needs ~22K.
+constexpr uint32_t kMaxPageTableEntries = 1u << 18;
+constexpr vk::DeviceSize kPageTableOffset = (sizeof(VirtualTextureGlobals) + 15) & ~vk::DeviceSize{15};
+// Hashed feedback slots per frame; a collision only drops a request, it comes back next frame.
+constexpr uint32_t kFeedbackSlots = 4096;
+// Smaller textures are cheaper to keep fully resident.
+constexpr uint32_t kMinVirtualTextureSize = 2048;
+// Bounds the transfer work and the CPU cutting per frame; the rest waits for the next feedback.
+constexpr uint32_t kMaxPageUploadsPerFrame = 32;
+// Feedback word fragMain writes: valid | texture << 24 | level << 20 | y << 10 | x.
+constexpr uint32_t kFeedbackValid = 1u << 31;
+constexpr uint32_t kMaxPagesPerSide = 1u << 10;
+constexpr uint32_t kNoTexture = ~0u;
+
+uint32_t pinnedLevel(uint32_t width, uint32_t height)
+{
+    uint32_t level = 0;
+    while (std::max(width >> level, height >> level) > kVirtualPageSize) {
+        ++level;
+    }
+    return level;
+}
+
+uint32_t pagesAlong(uint32_t size, uint32_t level)
+{
+    return (std::max(size >> level, 1u) + kVirtualPageSize - 1) / kVirtualPageSize;
+}
+
+uint32_t wrap(int64_t value, uint32_t count)
+{
+    const int64_t n = count;
+    return static_cast<uint32_t>(((value % n) + n) % n);
+}
+
+} // anonymous namespace
+
+VirtualTextureCache::VirtualTextureCache(Device& deviceIn, const VkAllocator& allocatorIn,
+                                         DescriptorManager& descriptorManagerIn, UploadContext& uploadsIn,
+                                         vk::Format atlasFormatIn) :
+    device(deviceIn), allocator(allocatorIn), descriptorManager(descriptorManagerIn), uploads(uploadsIn),
+    atlasFormat(atlasFormatIn), blockDim(vk::blockExtent(atlasFormatIn)[0]),
+    blockBytes(vk::blockSize(atlasFormatIn)), atlasTilesPerSide(kAtlasTilesPerSide)
+{
+    ZoneScopedN("VirtualTextureCache::VirtualTextureCache");
+    const vk::raii::Device& vkDevice = device.vkdevice;
+    const uint32_t atlasSize = atlasTilesPerSide * kVirtualTileSize;
+    // Pages are copied on the transfer queue while the graphics queue samples other tiles.
+    const bool concurrent = device.queueFamilyIndices.size() > 1;
+    const vk::ImageCreateInfo imageInfo{
+        .imageType = vk::ImageType::e2D,
+        .format = atlasFormat,
+        .extent = {atlasSize, atlasSize, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = vk::SampleCountFlagBits::e1,
+        .tiling = vk::ImageTiling::eOptimal,
+        .usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        .sharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+        .queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(device.queueFamilyIndices.size()) : 0u,
+        .pQueueFamilyIndices = concurrent ? device.queueFamilyIndices.data() : nullptr};
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    allocInfo.priority = 0.9f;
+    allocator.alocateImage(imageInfo, allocInfo, atlasImage, atlasMemory, "VirtualTextureAtlasMemory");
+    setDebugName(vkDevice, atlasImage, "VirtualTextureAtlas");
+    const vk::DeviceSize atlasBytes =
+        static_cast<vk::DeviceSize>(atlasSize / blockDim) * (atlasSize / blockDim) * blockBytes;
+    tracyResourceAlloc(static_cast<VkImage>(*atlasImage), atlasBytes, "GPU/Textures");
+
+    // General for its whole life: transfer writes to free tiles and sampling of resident ones overlap.
+    const vk::ImageViewCreateInfo viewInfo{.image = atlasImage,
+                                           .viewType = vk::ImageViewType::e2D,
+                                           .format = atlasFormat,
+                                           .subresourceRange = {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
+    atlasView = vk::raii::ImageView(vkDevice, viewInfo);
+    atlasDescriptorIndex = descriptorManager.reserveImageDescriptors(1);
+    descriptorManager.writeImageDescriptorAt(atlasDescriptorIndex, viewInfo, vk::DescriptorType::eSampledImage,
+                                             vk::ImageLayout::eGeneral);
+    {
+        UploadBatch batch = uploads.graphicsBatch();
+        transitionImageLayout(&batch.commandBuffer(), *atlasImage, 1, vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eGeneral, {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1},
+                              VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                              vk::PipelineStageFlagBits2::eTopOfPipe,
+                              vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eFragmentShader,
+                              vk::AccessFlagBits2::eNone,
+                              vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderRead);
+        batch.submit();
+    }
+
+    // Tiles [0, kMaxVirtualTextures) hold the pinned page of the texture with that id; the rest stream.
+    const uint32_t tileCount = atlasTilesPerSide * atlasTilesPerSide;
+    tileOwners.assign(tileCount, PageKey{.texture = kNoTexture});
+    for (uint32_t tile = tileCount; tile-- > kMaxVirtualTextures;) {
+        freeTiles.push_back(static_cast<uint16_t>(tile));
+    }
+
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        FrameResources& frame = frames[i];
+        const vk::DeviceSize size = kPageTableOffset + sizeof(uint32_t) * vk::DeviceSize{kMaxPageTableEntries};
+        createBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                     frame.buffer, frame.memory, allocator.allocator, vkDevice, device.queueFamilyIndices,
+                     std::format("VirtualTexturePageTableMemory_{}", i));
+        void* mapped = nullptr;
+        vmaMapMemory(allocator.allocator, frame.memory, &mapped);
+        frame.mapped = static_cast<std::byte*>(mapped);
+        frame.address = vkDevice.getBufferAddress({.buffer = *frame.buffer});
+        setDebugName(vkDevice, frame.buffer, std::format("VirtualTexturePageTable_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*frame.buffer), static_cast<size_t>(size), "GPU/VirtualTexture");
+
+        // Written by the GPU, read back by the CPU: cached host memory.
+        const vk::BufferCreateInfo feedbackInfo{
+            .size = sizeof(uint32_t) * kFeedbackSlots,
+            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+            .sharingMode = vk::SharingMode::eExclusive};
+        VmaAllocationCreateInfo feedbackAlloc{};
+        feedbackAlloc.usage = VMA_MEMORY_USAGE_AUTO;
+        feedbackAlloc.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+        feedbackAlloc.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        feedbackAlloc.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+        allocator.alocateBuffer(feedbackInfo, feedbackAlloc, frame.feedback, frame.feedbackMemory,
+                                std::format("VirtualTextureFeedbackMemory_{}", i));
+        void* feedbackMapped = nullptr;
+        vmaMapMemory(allocator.allocator, frame.feedbackMemory, &feedbackMapped);
+        frame.feedbackMapped = static_cast<uint32_t*>(feedbackMapped);
+        std::memset(frame.feedbackMapped, 0, sizeof(uint32_t) * kFeedbackSlots);
+        vmaFlushAllocation(allocator.allocator, frame.feedbackMemory, 0, VK_WHOLE_SIZE);
+        frame.feedbackAddress = vkDevice.getBufferAddress({.buffer = *frame.feedback});
+        setDebugName(vkDevice, frame.feedback, std::format("VirtualTextureFeedback_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*frame.feedback), sizeof(uint32_t) * kFeedbackSlots,
+                           "GPU/VirtualTexture");
+        publish(frame);
+    }
+
+    log_info(std::format("Atlas {}x{} {} ({} tiles of {} texels, {} MiB)", atlasSize, atlasSize,
+                         vk::to_string(atlasFormat), tileCount, kVirtualTileSize, atlasBytes >> 20),
+             "VirtualTextureCache");
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+    ZoneScopedN("VirtualTextureCache::~VirtualTextureCache");
+    // Engine::cleanup idles the device first.
+    for (FrameResources& frame : frames) {
+        vmaUnmapMemory(allocator.allocator, frame.memory);
+        VkBuffer table = frame.buffer.release();
+        tracyResourceFree(table, "GPU/VirtualTexture");
+        vmaDestroyBuffer(allocator.allocator, table, frame.memory);
+        vmaUnmapMemory(allocator.allocator, frame.feedbackMemory);
+        VkBuffer feedback = frame.feedback.release();
+        tracyResourceFree(feedback, "GPU/VirtualTexture");
+        vmaDestroyBuffer(allocator.allocator, feedback, frame.feedbackMemory);
+    }
+    atlasView = nullptr;
+    VkImage atlas = atlasImage.release();
+    tracyResourceFree(atlas, "GPU/Textures");
+    vmaDestroyImage(allocator.allocator, atlas, atlasMemory);
+}
+
+bool VirtualTextureCache::accepts(ktxTexture* texture) const
+{
+    if (textures.size() >= kMaxVirtualTextures ||
+        std::max(texture->baseWidth, texture->baseHeight) < kMinVirtualTextureSize ||
+        static_cast<vk::Format>(ktxTexture_GetVkFormat(texture)) != atlasFormat) {
+        return false;
+    }
+    const uint32_t pinned = pinnedLevel(texture->baseWidth, texture->baseHeight);
+    if (texture->numLevels <= pinned || pagesAlong(texture->baseWidth, 0) > kMaxPagesPerSide ||
+        pagesAlong(texture->baseHeight, 0) > kMaxPagesPerSide) {
+        return false;
+    }
+    size_t entries = 0;
+    for (uint32_t level = 0; level <= pinned; ++level) {
+        entries += size_t{pagesAlong(texture->baseWidth, level)} * pagesAlong(texture->baseHeight, level);
+    }
+    return pageTable.size() + entries <= kMaxPageTableEntries;
+}
+
+uint32_t VirtualTextureCache::add(UploadBatch& batch, std::string path, ktxTexture* texture)
+{
+    ZoneScopedN("VirtualTextureCache::add");
+    const auto id = static_cast<uint32_t>(textures.size());
+    VirtualTexture& added = textures.emplace_back(
+        VirtualTexture{.path = std::move(path), .data = std::unique_ptr<ktxTexture, KtxDeleter>(texture)});
+    added.desc = VirtualTextureDesc{
+        .pageTableOffset = static_cast<uint32_t>(pageTable.size()),
+        .width = texture->baseWidth,
+        .height = texture->baseHeight,
+        .pagedLevels = pinnedLevel(texture->baseWidth, texture->baseHeight) + 1,
+    };
+    uint32_t pageCount = 0;
+    for (uint32_t level = 0; level < added.desc.pagedLevels; ++level) {
+        added.levelOffsets.push_back(pageCount);
+        pageCount += pagesX(added, level) * pagesY(added, level);
+    }
+    added.pages.resize(pageCount);
+    pageTable.resize(pageTable.size() + pageCount);
+    dirtyTextures.push_back(true);
+
+    // The pinned page lives in the tile reserved for this id; frames on the graphics queue are ordered after it.
+    const PageKey pinned{.texture = id, .level = added.desc.pagedLevels - 1, .x = 0, .y = 0};
+    recordPageUpload(batch, pinned, static_cast<uint16_t>(id));
+    const vk::MemoryBarrier2 toSampled{.srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                                       .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                       .dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+                                       .dstAccessMask = vk::AccessFlagBits2::eShaderRead};
+    batch.commandBuffer().pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &toSampled});
+    Page& root = page(pinned);
+    root.state = PageState::Resident;
+    root.tile = static_cast<uint16_t>(id);
+    ++residentPages;
+
+    log_info(std::format("Virtual texture {}: {} {}x{}, {} levels in {} pages", id, added.path, added.desc.width,
+                         added.desc.height, added.desc.pagedLevels, pageCount),
+             "VirtualTextureCache");
+    return id;
+}
+
+VirtualTextureCache::Page& VirtualTextureCache::page(const PageKey& key)
+{
+    VirtualTexture& texture = textures[key.texture];
+    return texture.pages[texture.levelOffsets[key.level] + key.y * pagesX(texture, key.level) + key.x];
+}
+
+uint32_t VirtualTextureCache::pagesX(const VirtualTexture& texture, uint32_t level) const
+{
+    return pagesAlong(texture.desc.width, level);
+}
+
+uint32_t VirtualTextureCache::pagesY(const VirtualTexture& texture, uint32_t level) const
+{
+    return pagesAlong(texture.desc.height, level);
+}
+
+void VirtualTextureCache::beginFrame(uint32_t frameSlot)
+{
+    ZoneScopedN("VirtualTextureCache::beginFrame");
+    ++frameCounter;
+    FrameResources& frame = frames[frameSlot];
+
+    // Pages whose copy the transfer queue finished are sampled from this frame on.
+    const uint64_t completed = uploads.transfer().completedValue();
+    while (!pendingPages.empty() && pendingPages.front().timelineValue <= completed) {
+        const PageKey key = pendingPages.front().key;
+        pendingPages.pop_front();
+        page(key).state = PageState::Resident;
+        dirtyTextures[key.texture] = true;
+        ++residentPages;
+    }
+    while (!retiredTiles.empty() && retiredTiles.front().releaseFrame <= frameCounter) {
+        freeTiles.push_back(retiredTiles.front().tile);
+        retiredTiles.pop_front();
+    }
+
+    // This slot's fence has signalled, so its feedback is complete; cleared for the frame recorded next.
+    std::vector<PageKey> missing;
+    {
+        ZoneScopedN("VirtualTextureCache::readFeedback");
+        vmaInvalidateAllocation(allocator.allocator, frame.feedbackMemory, 0, VK_WHOLE_SIZE);
+        for (uint32_t slot = 0; slot < kFeedbackSlots; ++slot) {
+            const uint32_t word = frame.feedbackMapped[slot];
+            if ((word & kFeedbackValid) == 0) {
+                continue;
+            }
+            const PageKey key{.texture = (word >> 24) & 0x3Fu,
+                              .level = (word >> 20) & 0xFu,
+                              .x = word & 0x3FFu,
+                              .y = (word >> 10) & 0x3FFu};
+            if (key.texture >= textures.size() || key.level >= textures[key.texture].desc.pagedLevels ||
+                key.x >= pagesX(textures[key.texture], key.level) ||
+                key.y >= pagesY(textures[key.texture], key.level)) {
+                continue;
+            }
+            touch(key, missing);
+        }
+        std::memset(frame.feedbackMapped, 0, sizeof(uint32_t) * kFeedbackSlots);
+        vmaFlushAllocation(allocator.allocator, frame.feedbackMemory, 0, VK_WHOLE_SIZE);
+    }
+
+    // Coarse levels first: they cover the most screen and are what finer misses fall back to.
+    std::ranges::stable_sort(missing, std::greater{}, &PageKey::level);
+    uint32_t uploaded = 0;
+    if (!missing.empty()) {
+        std::vector<PageKey> recorded;
+        UploadBatch batch = uploads.transferBatch();
+        for (const PageKey& key : missing) {
+            if (uploaded == kMaxPageUploadsPerFrame) {
+                break;
+            }
+            const std::optional<uint16_t> tile = allocateTile();
+            if (!tile) {
+                break;
+            }
+            recordPageUpload(batch, key, *tile);
+            Page& streamed = page(key);
+            streamed.state = PageState::Pending;
+            streamed.tile = *tile;
+            tileOwners[*tile] = key;
+            recorded.push_back(key);
+            ++uploaded;
+        }
+        if (!recorded.empty()) {
+            const uint64_t value = batch.submit();
+            for (const PageKey& key : recorded) {
+                pendingPages.push_back(PendingPage{.key = key, .timelineValue = value});
+            }
+        }
+        // Out of tiles: free the least recently requested pages for the misses left over.
+        const auto leftover = std::min<uint32_t>(static_cast<uint32_t>(missing.size()) - uploaded,
+                                                 kMaxPageUploadsPerFrame);
+        if (leftover > 0 && freeTiles.empty()) {
+            evictPages(leftover);
+        }
+    }
+
+    bool tableChanged = false;
+    for (uint32_t texture = 0; texture < textures.size(); ++texture) {
+        if (dirtyTextures[texture]) {
+            rebuildPageTable(texture);
+            dirtyTextures[texture] = false;
+            tableChanged = true;
+        }
+    }
+    if (tableChanged) {
+        ++tableVersion;
+    }
+    publish(frame);
+
+    TracyPlot("VirtualTexture/ResidentPages", static_cast<double>(residentPages));
+    TracyPlot("VirtualTexture/PendingPages", static_cast<double>(pendingPages.size()));
+    TracyPlot("VirtualTexture/PageUploads", static_cast<double>(uploaded));
+    TracyPlot("VirtualTexture/MissingPages", static_cast<double>(missing.size()));
+}
+
+void VirtualTextureCache::touch(const PageKey& key, std::vector<PageKey>& missing)
+{
+    const uint32_t pinned = textures[key.texture].desc.pagedLevels - 1;
+    for (uint32_t level = key.level; level <= pinned; ++level) {
+        const uint32_t shift = level - key.level;
+        const PageKey ancestor{.texture = key.texture, .level = level, .x = key.x >> shift, .y = key.y >> shift};
+        Page& visited = page(ancestor);
+        if (visited.lastRequested == frameCounter) {
+            break; // this chain up to the pinned page was already walked this frame
+        }
+        visited.lastRequested = frameCounter;
+        if (visited.state == PageState::Missing) {
+            missing.push_back(ancestor);
+        }
+    }
+}
+
+std::optional<uint16_t> VirtualTextureCache::allocateTile()
+{
+    if (freeTiles.empty()) {
+        return std::nullopt;
+    }
+    const uint16_t tile = freeTiles.back();
+    freeTiles.pop_back();
+    return tile;
+}
+
+void VirtualTextureCache::evictPages(uint32_t count)
+{
+    ZoneScopedN("VirtualTextureCache::evictPages");
+    // Pages requested by a frame that may still be in flight are kept.
+    std::vector<std::pair<uint32_t, uint16_t>> candidates; // lastRequested, tile
+    for (uint32_t tile = kMaxVirtualTextures; tile < tileOwners.size(); ++tile) {
+        const PageKey& owner = tileOwners[tile];
+        if (owner.texture == kNoTexture) {
+            continue;
+        }
+        const Page& resident = page(owner);
+        if (resident.state == PageState::Resident && resident.lastRequested + MAX_FRAMES_IN_FLIGHT < frameCounter) {
+            candidates.emplace_back(resident.lastRequested, static_cast<uint16_t>(tile));
+        }
+    }
+    count = std::min(count, static_cast<uint32_t>(candidates.size()));
+    std::ranges::partial_sort(candidates, candidates.begin() + count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint16_t tile = candidates[i].second;
+        const PageKey owner = tileOwners[tile];
+        page(owner).state = PageState::Missing;
+        dirtyTextures[owner.texture] = true;
+        tileOwners[tile].texture = kNoTexture;
+        --residentPages;
+        // Older page tables still point at the tile until every frame in flight has finished with them.
+        retiredTiles.push_back(RetiredTile{.tile = tile, .releaseFrame = frameCounter + MAX_FRAMES_IN_FLIGHT});
+    }
+}
+
+void VirtualTextureCache::recordPageUpload(UploadBatch& batch, const PageKey& key, uint16_t tile)
+{
+    ZoneScopedN("VirtualTextureCache::recordPageUpload");
+    const VirtualTexture& texture = textures[key.texture];
+    ktxTexture* data = texture.data.get();
+    ktx_size_t levelOffset = 0;
+    ktxTexture_GetImageOffset(data, key.level, 0, 0, &levelOffset);
+    const std::byte* level = reinterpret_cast<const std::byte*>(ktxTexture_GetData(data) + levelOffset);
+
+    const uint32_t levelBlocksX = (std::max(texture.desc.width >> key.level, 1u) + blockDim - 1) / blockDim;
+    const uint32_t levelBlocksY = (std::max(texture.desc.height >> key.level, 1u) + blockDim - 1) / blockDim;
+    const uint32_t pageBlocks = kVirtualPageSize / blockDim;
+    const uint32_t borderBlocks = kVirtualPageBorder / blockDim;
+    const uint32_t tileBlocks = kVirtualTileSize / blockDim;
+    pageScratch.resize(static_cast<size_t>(tileBlocks) * tileBlocks * blockBytes);
+    // Wrapping matches the repeat sampler, so borders on the texture edge hold the opposite edge.
+    for (uint32_t y = 0; y < tileBlocks; ++y) {
+        const uint32_t sourceY = wrap(int64_t{key.y} * pageBlocks + y - borderBlocks, levelBlocksY);
+        for (uint32_t x = 0; x < tileBlocks; ++x) {
+            const uint32_t sourceX = wrap(int64_t{key.x} * pageBlocks + x - borderBlocks, levelBlocksX);
+            std::memcpy(pageScratch.data() + (static_cast<size_t>(y) * tileBlocks + x) * blockBytes,
+                        level + (static_cast<size_t>(sourceY) * levelBlocksX + sourceX) * blockBytes, blockBytes);
+        }
+    }
+    const vk::Offset3D offset{static_cast<int32_t>((tile % atlasTilesPerSide) * kVirtualTileSize),
+                              static_cast<int32_t>((tile / atlasTilesPerSide) * kVirtualTileSize), 0};
+    batch.copyToImage(*atlasImage, 0, {kVirtualTileSize, kVirtualTileSize, 1}, pageScratch.data(),
+                      pageScratch.size(), blockBytes, offset, vk::ImageLayout::eGeneral);
+}
+
+void VirtualTextureCache::rebuildPageTable(uint32_t textureId)
+{
+    ZoneScopedN("VirtualTextureCache::rebuildPageTable");
+    const VirtualTexture& texture = textures[textureId];
+    uint32_t* entries = pageTable.data() + texture.desc.pageTableOffset;
+    // Coarse to fine: a page that is not resident inherits its parent's (already resolved) entry.
+    for (uint32_t level = texture.desc.pagedLevels; level-- > 0;) {
+        const uint32_t columns = pagesX(texture, level);
+        const uint32_t rows = pagesY(texture, level);
+        const uint32_t parentColumns = level + 1 < texture.desc.pagedLevels ? pagesX(texture, level + 1) : 0;
+        for (uint32_t y = 0; y < rows; ++y) {
+            for (uint32_t x = 0; x < columns; ++x) {
+                const uint32_t index = texture.levelOffsets[level] + y * columns + x;
+                const Page& current = texture.pages[index];
+                if (current.state == PageState::Resident) {
+                    entries[index] = (current.tile % atlasTilesPerSide) | (current.tile / atlasTilesPerSide) << 8 |
+                        level << 16;
+                } else {
+                    entries[index] = entries[texture.levelOffsets[level + 1] + (y / 2) * parentColumns + x / 2];
+                }
+            }
+        }
+    }
+}
+
+void VirtualTextureCache::publish(FrameResources& frame)
+{
+    VirtualTextureGlobals globals{
+        .pageTable = frame.address + kPageTableOffset,
+        .feedback = frame.feedbackAddress,
+        .atlas = {.resourceIndex = atlasDescriptorIndex, .samplerIndex = 0},
+        .atlasTexelSize = 1.0f / static_cast<float>(atlasTilesPerSide * kVirtualTileSize),
+        .feedbackMask = kFeedbackSlots - 1,
+        .frameIndex = frameCounter,
+        .textureCount = static_cast<uint32_t>(textures.size()),
+    };
+    for (uint32_t i = 0; i < textures.size(); ++i) {
+        globals.textures[i] = textures[i].desc;
+    }
+    std::memcpy(frame.mapped, &globals, sizeof(globals));
+    if (frame.tableVersion != tableVersion) {
+        std::memcpy(frame.mapped + kPageTableOffset, pageTable.data(), pageTable.size() * sizeof(uint32_t));
+        frame.tableVersion = tableVersion;
+    }
+}
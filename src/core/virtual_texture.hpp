@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+#include "../Constants.h"
+#include "../render/push_data.hpp"
+#include "ktxvulkan.h"
+#include "upload_batch.hpp"
+#include "vk_allocator.hpp"
+#include "vk_descriptors.hpp"
+#include "vk_device.hpp"
+
+// ── GPU layout (matches VirtualTextureGlobals / VirtualTextureDesc in mesh.slang) ──
+inline constexpr uint32_t kMaxVirtualTextures = 64;
+// Page side in texels, plus a border on every side so bilinear taps never leave the tile.
+inline constexpr uint32_t kVirtualPageSize = 128;
+inline constexpr uint32_t kVirtualPageBorder = 4;
+inline constexpr uint32_t kVirtualTileSize = kVirtualPageSize + 2 * kVirtualPageBorder;
+
+struct VirtualTextureDesc
+{
+    uint32_t pageTableOffset; // first entry of level 0 in the page table
+    uint32_t width;
+    uint32_t height;
+    uint32_t pagedLevels; // levels 0..pagedLevels-1; the last one is a single pinned page
+};
+
+// One per frame in flight, followed by the page table: uint32 entries, level 0 first, rows of pages per level.
+// An entry names the atlas tile of the finest resident page covering it: tileX | tileY << 8 | level << 16.
+struct VirtualTextureGlobals
+{
+    vk::DeviceAddress pageTable;
+    vk::DeviceAddress feedback; // uint32[feedbackMask + 1], hashed page requests written by fragMain
+    SlangHandle atlas;
+    float atlasTexelSize; // 1 / atlas side in texels
+    uint32_t feedbackMask;
+    uint32_t frameIndex; // rotates which pixels write feedback
+    uint32_t textureCount;
+    VirtualTextureDesc textures[kMaxVirtualTextures];
+};
+
+static_assert(offsetof(VirtualTextureGlobals, atlas) == 16);
+static_assert(offsetof(VirtualTextureGlobals, textures) == 40);
+
+// Virtual texturing for textures too large to keep resident: every mip level is cut into kVirtualPageSize
+// pages that live in one physical atlas image only while fragMain asks for them.
+//   1. fragMain writes the page it wanted (texture, level, page) into a hashed per-frame feedback buffer and
+//      samples the finest resident ancestor through the page table.
+//   2. beginFrame() (after the frame slot's fence) reads that feedback, queues the missing pages coarse level
+//      first, evicts the least recently requested ones and copies the new pages from the CPU-side levels into
+//      the atlas through the transfer queue. Pages enter the page table once the copy's timeline value is
+//      reached; evicted tiles are reused only after every frame that could still sample them has finished.
+// The level that fits into one page is pinned at add(), so every texel always has a resident fallback.
+// The atlas holds the format cooked textures transcode to (BC7 or RGBA8); other textures stay regular images.
+// Main thread only.
+class VirtualTextureCache
+{
+public:
+    VirtualTextureCache(Device& device, const VkAllocator& allocator, DescriptorManager& descriptorManager,
+                        UploadContext& uploads, vk::Format atlasFormat);
+    ~VirtualTextureCache();
+
+    VirtualTextureCache(const VirtualTextureCache&) = delete;
+    VirtualTextureCache& operator=(const VirtualTextureCache&) = delete;
+
+    // Large enough to be worth paging, in the atlas format, and room left for its pages.
+    [[nodiscard]] bool accepts(ktxTexture* texture) const;
+    // Takes ownership of texture (its level data is what pages are cut from) and records the pinned page into
+    // batch. Returns the virtual texture id for ObjectUB::materialID (kVirtualTextureMaterialBit | id).
+    uint32_t add(UploadBatch& batch, std::string path, ktxTexture* texture);
+
+    // Main thread, after the fence of frameSlot: consumes its feedback, streams pages, publishes its table.
+    // The frame's feedback writes are made host-visible by TextureManager::recordFeedbackBarrier.
+    void beginFrame(uint32_t frameSlot);
+
+    [[nodiscard]] vk::DeviceAddress frameAddress(uint32_t frameSlot) const noexcept
+    {
+        return frames[frameSlot].address;
+    }
+    [[nodiscard]] uint32_t textureCount() const noexcept { return static_cast<uint32_t>(textures.size()); }
+    [[nodiscard]] uint32_t residentPageCount() const noexcept { return residentPages; }
+
+private:
+    struct KtxDeleter { void operator()(ktxTexture* texture) const { ktxTexture_Destroy(texture); } };
+
+    enum class PageState : uint8_t { Missing, Pending, Resident };
+    struct Page
+    {
+        PageState state = PageState::Missing;
+        uint16_t tile = 0;
+        uint32_t lastRequested = 0; // frameCounter of the latest feedback naming it (or a descendant)
+    };
+    struct VirtualTexture
+    {
+        std::string path;
+        std::unique_ptr<ktxTexture, KtxDeleter> data;
+        VirtualTextureDesc desc{};
+        std::vector<uint32_t> levelOffsets; // first page of each level, relative to desc.pageTableOffset
+        std::vector<Page> pages;
+    };
+    struct PageKey
+    {
+        uint32_t texture;
+        uint32_t level;
+        uint32_t x;
+        uint32_t y;
+    };
+    struct PendingPage
+    {
+        PageKey key;
+        uint64_t timelineValue;
+    };
+    struct RetiredTile
+    {
+        uint16_t tile;
+        uint32_t releaseFrame;
+    };
+    struct FrameResources
+    {
+        vk::raii::Buffer buffer = nullptr; // VirtualTextureGlobals + page table
+        VmaAllocation memory = nullptr;
+        std::byte* mapped = nullptr;
+        vk::DeviceAddress address = 0;
+        uint64_t tableVersion = ~0ull;
+        vk::raii::Buffer feedback = nullptr;
+        VmaAllocation feedbackMemory = nullptr;
+        uint32_t* feedbackMapped = nullptr;
+        vk::DeviceAddress feedbackAddress = 0;
+    };
+
+    [[nodiscard]] Page& page(const PageKey& key);
+    [[nodiscard]] uint32_t pagesX(const VirtualTexture& texture, uint32_t level) const;
+    [[nodiscard]] uint32_t pagesY(const VirtualTexture& texture, uint32_t level) const;
+    // Marks the requested page and its ancestors as used; appends the missing ones to missing.
+    void touch(const PageKey& key, std::vector<PageKey>& missing);
+    // nullopt when no tile is free; evictPages() makes room for a later frame.
+    [[nodiscard]] std::optional<uint16_t> allocateTile();
+    // Retires up to count least recently requested streamed pages not requested by a frame still in flight.
+    void evictPages(uint32_t count);
+    // Cuts page + border out of the CPU-side level (wrapping at the texture edges) and records its copy.
+    void recordPageUpload(UploadBatch& batch, const PageKey& key, uint16_t tile);
+    // Points every page of texture at its finest resident ancestor.
+    void rebuildPageTable(uint32_t texture);
+    void publish(FrameResources& frame);
+
+    Device& device;
+    const VkAllocator& allocator;
+    DescriptorManager& descriptorManager;
+    UploadContext& uploads;
+    const vk::Format atlasFormat;
+    const uint32_t blockDim;   // texels per block side (4 for BC7, 1 for RGBA8)
+    const uint32_t blockBytes; // bytes per block
+
+    vk::raii::Image atlasImage = nullptr;
+    VmaAllocation atlasMemory = nullptr;
+    vk::raii::ImageView atlasView = nullptr;
+    uint32_t atlasDescriptorIndex = 0;
+    uint32_t atlasTilesPerSide = 0;
+
+    std::vector<VirtualTexture> textures;
+    std::vector<uint32_t> pageTable; // CPU copy of the entries every frame slot gets
+    std::vector<bool> dirtyTextures;
+    uint64_t tableVersion = 0;
+
+    std::vector<uint16_t> freeTiles;
+    std::vector<PageKey> tileOwners; // indexed by tile; texture == ~0u while the tile holds no streamed page
+    std::deque<RetiredTile> retiredTiles;
+    std::deque<PendingPage> pendingPages;
+    std::vector<std::byte> pageScratch;
+
+    std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> frames;
+    uint32_t frameCounter = 0;
+    uint32_t residentPages = 0;
+};
@@ -98,48 +98,80 @@ void DescriptorManager::createHeaps()
 
 void DescriptorManager::writeImageDescriptor(TextureAsset& textureAsset, const vk::ImageViewCreateInfo& imageViewCreateInfo)
 {
-    auto resources = std::vector<vk::ResourceDescriptorInfoEXT>();
-    auto descriptors = std::vector<vk::HostAddressRangeEXT>();
+    ZoneScopedN("DescriptorManager::writeImageDescriptor");
+    // Slots released by streamed / replaced textures first, so the heap does not grow with every swap.
+    if (!freeImageDescriptors.empty()) {
+        const uint32_t heapIndex = freeImageDescriptors.back();
+        freeImageDescriptors.pop_back();
+        writeImageDescriptorAt(heapIndex, imageViewCreateInfo, vk::DescriptorType::eSampledImage,
+                               vk::ImageLayout::eShaderReadOnlyOptimal);
+        textureAsset.descriptorHeapIndex = heapIndex;
+        return;
+    }
 
     // Pack sampled-image descriptors with size as array stride (untyped heap indexing).
     // Spec: imageDescriptorAlignment <= imageDescriptorSize, so consecutive slots stay aligned.
     const vk::DeviceSize currentResOffset = alignUp(textureDescriptorOffset, imageDescriptorAlignment);
+    const uint32_t heapIndex = static_cast<uint32_t>(currentResOffset / imageDescriptorSize);
+    writeImageDescriptorAt(heapIndex, imageViewCreateInfo, vk::DescriptorType::eSampledImage,
+                           vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    // Advance cursor so the next texture gets a new heap slot (was missing — every
+    // load overwrote slot 0 and both models shared the last texture).
+    textureDescriptorOffset = currentResOffset + imageDescriptorSize;
+    textureDescriptorOffset = alignUp(textureDescriptorOffset, imageDescriptorAlignment);
+
+    textureAsset.descriptorHeapIndex = heapIndex;
+
+    log_info(std::format("Descriptor heap image write: offset={} size={} align={} index={} nextOffset={}",
+                         currentResOffset, imageDescriptorSize, imageDescriptorAlignment, heapIndex,
+                         textureDescriptorOffset),
+             "DescriptorHeap");
+}
+
+void DescriptorManager::releaseImageDescriptor(uint32_t heapIndex)
+{
+    freeImageDescriptors.push_back(heapIndex);
+}
+
+uint32_t DescriptorManager::reserveImageDescriptors(uint32_t count)
+{
+    ZoneScopedN("DescriptorManager::reserveImageDescriptors");
+    const vk::DeviceSize firstOffset = alignUp(textureDescriptorOffset, imageDescriptorAlignment);
+    textureDescriptorOffset = alignUp(firstOffset + imageDescriptorSize * count, imageDescriptorAlignment);
+
+    const uint32_t firstIndex = static_cast<uint32_t>(firstOffset / imageDescriptorSize);
+    log_info(std::format("Descriptor heap reserved image slots [{}, {})", firstIndex, firstIndex + count),
+             "DescriptorHeap");
+    return firstIndex;
+}
+
+void DescriptorManager::writeImageDescriptorAt(uint32_t heapIndex, const vk::ImageViewCreateInfo& imageViewCreateInfo,
+                                               vk::DescriptorType descriptorType, vk::ImageLayout layout)
+{
+    ZoneScopedN("DescriptorManager::writeImageDescriptorAt");
+    const vk::DeviceSize offset = static_cast<vk::DeviceSize>(heapIndex) * imageDescriptorSize;
     const auto descriptorImageInfo = vk::ImageDescriptorInfoEXT{
         .sType = vk::StructureType::eImageDescriptorInfoEXT,
         .pNext = nullptr,
         .pView = &imageViewCreateInfo,
-        .layout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .layout = layout,
     };
     const auto imageInfo = vk::ResourceDescriptorInfoEXT{
         .sType = vk::StructureType::eResourceDescriptorInfoEXT,
         .pNext = nullptr,
-        .type = vk::DescriptorType::eSampledImage,
+        .type = descriptorType,
         .data = vk::ResourceDescriptorDataEXT{&descriptorImageInfo},
     };
     const auto imageWrite = vk::HostAddressRangeEXT{
-        .address = static_cast<uint8_t*>(mappedResourceHeapPtr) + currentResOffset,
+        .address = static_cast<uint8_t*>(mappedResourceHeapPtr) + offset,
         .size = imageDescriptorSize,
     };
-    resources.push_back(imageInfo);
-    descriptors.push_back(imageWrite);
 
     {
-        ZoneScopedN("DescriptorManager::createHeapDescriptors::writeResourceDescriptorsEXT");
-        device.writeResourceDescriptorsEXT(resources, descriptors);
+        ZoneScopedN("DescriptorManager::writeImageDescriptorAt::writeResourceDescriptorsEXT");
+        device.writeResourceDescriptorsEXT(imageInfo, imageWrite);
     }
-
-    // Advance cursor so the next texture gets a new heap slot (was missing — every
-    // load overwrote slot 0 and both models shared the last texture).
-    textureDescriptorOffset = currentResOffset + imageDescriptorSize;
-    textureDescriptorOffset = alignUp(textureDescriptorOffset, imageDescriptorAlignment);
-
-    const uint32_t heapIndex = static_cast<uint32_t>(currentResOffset / imageDescriptorSize);
-    textureAsset.descriptorHeapIndex = heapIndex;
-
-    log_info(std::format("Descriptor heap image write: offset={} size={} align={} index={} nextOffset={}",
-                         currentResOffset, imageDescriptorSize, imageDescriptorAlignment, heapIndex,
-                         textureDescriptorOffset),
-             "DescriptorHeap");
 }
 
 
@@ -177,6 +209,35 @@ void DescriptorManager::createHeapDescriptors()
         device.writeSamplerDescriptorsEXT(samplerInfo, samplerWrite);
     }
 
+    // Depth pyramid sampler: a linear fetch returns the max of the 2x2 footprint (farthest depth),
+    // so one SampleLevel both downsamples the pyramid and tests a Hi-Z footprint conservatively.
+    depthPyramidSamplerOffset = alignUp(currentSampOffset + samplerDescriptorSize, samplerDescriptorAlignment);
+    const vk::SamplerReductionModeCreateInfo reductionInfo{
+        .reductionMode = vk::SamplerReductionMode::eMax,
+    };
+    const vk::SamplerCreateInfo depthPyramidSamplerInfo{.pNext = &reductionInfo,
+                                                        .magFilter = vk::Filter::eLinear,
+                                                        .minFilter = vk::Filter::eLinear,
+                                                        .mipmapMode = vk::SamplerMipmapMode::eNearest,
+                                                        .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+                                                        .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+                                                        .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+                                                        .mipLodBias = 0.0f,
+                                                        .anisotropyEnable = vk::False,
+                                                        .maxAnisotropy = 1.0f,
+                                                        .compareEnable = vk::False,
+                                                        .compareOp = vk::CompareOp::eAlways,
+                                                        .minLod = 0.0f,
+                                                        .maxLod = vk::LodClampNone};
+    const vk::HostAddressRangeEXT depthPyramidSamplerWrite{
+        .address = static_cast<uint8_t*>(mappedSamplerHeapPtr) + depthPyramidSamplerOffset,
+        .size = samplerDescriptorSize,
+    };
+    {
+        ZoneScopedN("DescriptorManager::createHeapDescriptors::writeDepthPyramidSampler");
+        device.writeSamplerDescriptorsEXT(depthPyramidSamplerInfo, depthPyramidSamplerWrite);
+    }
+
     log_info(std::format("Descriptor heap sampler layout samplerDescSize={} "
                          "samplerAlign={} samplerIndex={}",
                          samplerDescriptorSize,
@@ -278,3 +339,11 @@ uint32_t DescriptorManager::getSamplerDescriptorIndex() const
     }
     return static_cast<uint32_t>(samplerDescriptorOffset / samplerDescriptorSize);
 }
+
+uint32_t DescriptorManager::getDepthPyramidSamplerIndex() const
+{
+    if (samplerDescriptorSize == 0) {
+        return 0;
+    }
+    return static_cast<uint32_t>(depthPyramidSamplerOffset / samplerDescriptorSize);
+}
@@ -32,7 +32,17 @@ public:
     // Computed indices (not raw field passthrough)
     [[nodiscard]] auto getTextureDescriptorIndex() const -> uint32_t;
     [[nodiscard]] auto getSamplerDescriptorIndex() const -> uint32_t;
+    // Clamp-to-edge sampler with VK_SAMPLER_REDUCTION_MODE_MAX (depth pyramid build + Hi-Z tests).
+    [[nodiscard]] auto getDepthPyramidSamplerIndex() const -> uint32_t;
+    // Sampled image in a slot freed by releaseImageDescriptor, or a new one; sets textureAsset.descriptorHeapIndex.
     void writeImageDescriptor(TextureAsset& textureAsset, const vk::ImageViewCreateInfo& imageViewCreateInfo);
+    // Returns a writeImageDescriptor slot for reuse; no frame in flight may still read it.
+    void releaseImageDescriptor(uint32_t heapIndex);
+    // Reserve count consecutive image slots for render targets that are rewritten on resize.
+    [[nodiscard]] uint32_t reserveImageDescriptors(uint32_t count);
+    // Sampled or storage image descriptor written into an already-reserved slot.
+    void writeImageDescriptorAt(uint32_t heapIndex, const vk::ImageViewCreateInfo& imageViewCreateInfo,
+                                vk::DescriptorType descriptorType, vk::ImageLayout layout);
 
 
 
@@ -56,7 +66,9 @@ public:
     vk::BindHeapInfoEXT samplerHeapInfo{};
 
     vk::DeviceSize textureDescriptorOffset = 0;
+    std::vector<uint32_t> freeImageDescriptors;
     vk::DeviceSize samplerDescriptorOffset = 0;
+    vk::DeviceSize depthPyramidSamplerOffset = 0;
     vk::raii::DescriptorSetLayout descriptorSetLayout = nullptr;
     vk::raii::DescriptorPool descriptorPool = nullptr;
     std::vector<vk::raii::DescriptorSet> descriptorSets;
@@ -460,6 +460,9 @@ void Device::createLogicalDevice()
         descriptorHeapFeatureQuery.get<vk::PhysicalDeviceDescriptorHeapFeaturesEXT>().descriptorHeap == vk::True;
     descriptorBindingMode =
         descriptorHeapFeatureSupported ? DescriptorBindingMode::DescriptorHeaps : DescriptorBindingMode::LegacySets;
+    // Optional: without it TextureManager transcodes cooked textures to RGBA8 instead of BC7.
+    textureCompressionBC =
+        descriptorHeapFeatureQuery.get<vk::PhysicalDeviceFeatures2>().features.textureCompressionBC == vk::True;
 
     // Build a pNext feature chain covering every extension the engine depends on.
     // Each structure is zero-initialised by default; only fields set to `true` here
@@ -496,6 +499,7 @@ void Device::createLogicalDevice()
                                  .sampleRateShading = true,
                                  .multiDrawIndirect = true,
                                  .samplerAnisotropy = true,
+                                 .textureCompressionBC = textureCompressionBC,
                                  .shaderInt64 = true,
                              }},
                         // vk::PhysicalDeviceVulkan11Features
@@ -513,8 +517,12 @@ void Device::createLogicalDevice()
                             .descriptorBindingPartiallyBound = true,
                             .descriptorBindingVariableDescriptorCount = true,
                             .runtimeDescriptorArray = true,
+                            // Max-reduction sampler for the Hi-Z depth pyramid
+                            .samplerFilterMinmax = true,
                             // Vertex float3@0/12 packing with slang -fvk-use-scalar-layout
                             .scalarBlockLayout = true,
+                            // Streamed geometry uploads on the transfer queue (AssetStreamer)
+                            .timelineSemaphore = true,
                             .bufferDeviceAddress = true,
                             .vulkanMemoryModel = true,
                             .vulkanMemoryModelDeviceScope = true,
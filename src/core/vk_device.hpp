@@ -184,4 +184,5 @@ public:
         HardwareCapabilities{}; ///< Cached hardware capability support flags (e.g., ray-tracing, mesh shaders).
     DescriptorBindingMode descriptorBindingMode =
         DescriptorBindingMode::LegacySets; ///< Runtime-selected descriptor binding path.
+    bool textureCompressionBC = false; ///< BC1-7 sampled images enabled (cooked textures transcode to BC7).
 };
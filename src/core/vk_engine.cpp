@@ -10,6 +10,7 @@
 #endif
 
 #include <algorithm>
+#include <cmath>
 #include <format>
 
 
@@ -51,6 +52,7 @@ void Engine::initialize()
     device->init();
 
     allocator = std::make_unique<VkAllocator>(*device);
+    uploads = std::make_unique<UploadContext>(*device, *allocator);
 
     descriptorManager = std::make_unique<DescriptorManager>(device->vkdevice, allocator->allocator,
                                                             device->queueFamilyIndices, device->capabilities);
@@ -60,21 +62,22 @@ void Engine::initialize()
     swapChain->init();
 
     camera = std::make_unique<Camera>(*swapChain);
-    textureManager = std::make_unique<TextureManager>(*device, *allocator, *descriptorManager);
+    textureManager = std::make_unique<TextureManager>(*device, *allocator, *descriptorManager, *uploads);
     textureManager->init();
 
     scene = std::make_unique<Scene>();
     assetsLoader = std::make_unique<AssetsLoader>(scene->objectStorage, *textureManager);
 
-    const glm::vec3 initialAssetPos{0.0f, 0.0f, 0.0f};
-    assetsLoader->loadModel(MODEL_PATH.string(), initialAssetPos);
-    // Aim free-fly camera at the only startup model so the scene is visible immediately.
-    camera->focusOn(initialAssetPos);
     resourceManager = std::make_unique<ResourceManager>(
-        *device, *allocator, assetsLoader->vertices, assetsLoader->meshlets, assetsLoader->meshletVertices,
-        assetsLoader->meshletTriangles, scene->objectStorage);
+        *device, *allocator, assetsLoader->geometry, scene->objectStorage, *uploads);
     resourceManager->init();
     resourceManager->createCameraBuffers(*camera);
+    assetStreamer = std::make_unique<AssetStreamer>(*resourceManager, *assetsLoader);
+
+    const glm::vec3 initialAssetPos{0.0f, 0.0f, 0.0f};
+    assetStreamer->load(MODEL_PATH.string(), initialAssetPos);
+    // Aim free-fly camera at the only startup model so the scene is visible immediately.
+    camera->focusOn(initialAssetPos);
 
     tracyContext = std::make_unique<VkTracyContext>();
     {
@@ -101,6 +104,7 @@ void Engine::initialize()
 
     renderer = std::make_unique<Renderer>(*device, *swapChain, *resourceManager, *descriptorManager, *pipeline, *camera,
                                           tracyContext.get(), enableImGui);
+    renderer->setTextureManager(textureManager.get());
     renderer->rebuildSwapchainResources();
 
 #if ENGINE_ENABLE_IMGUI
@@ -310,12 +314,21 @@ void Engine::run()
                     camera->moveUp(-step);
             }
 
+            {
+                ZoneScopedN("AssetStreaming");
+                assetStreamer->poll();
+            }
+
             // Upload camera for this frame's in-flight slot before recording/submit.
             {
                 ZoneScopedN("DrawFrame");
                 camera->updateCameraData(renderer->currentFrame);
                 renderer->drawFrame();
             }
+            {
+                ZoneScopedN("SpatialIndex");
+                scene->updateSpatialIndex();
+            }
         } else {
             ZoneScopedN("MinimizedWait");
             SDL_Delay(100);
@@ -388,9 +401,21 @@ void Engine::drawImGui()
     }
 
     ImGui::InputFloat3("Model Position", &loadedModelPosition[0]);
+    ImGui::InputInt("Instances", &loadedInstanceCount);
+    loadedInstanceCount = std::clamp(loadedInstanceCount, 1, 1 << 16);
+    ImGui::InputFloat("Instance Spacing", &loadedInstanceSpacing);
     if (ImGui::Button("Load Object")) {
         loadObject();
     }
+    if (const uint32_t pending = assetStreamer->pendingCount(); pending > 0) {
+        ImGui::SameLine();
+        ImGui::Text("Streaming %u model(s)...", pending);
+    }
+    if (const VirtualTextureCache* virtualTextures = textureManager->virtualTextures.get();
+        virtualTextures != nullptr && virtualTextures->textureCount() > 0) {
+        ImGui::Text("Virtual textures: %u, resident pages: %u", virtualTextures->textureCount(),
+                    virtualTextures->residentPageCount());
+    }
     ImGui::End();
     ImGui::Render();
 #endif
@@ -485,10 +510,16 @@ void Engine::loadObject()
         TracyMessage(msg.c_str(), msg.size());
     }
 #endif
-    device->vkdevice.waitIdle();
-    assetsLoader->loadModel(assetPath, glm::make_vec3(loadedModelPosition));
-    resourceManager->recreateObjectsBuffers();
-    resourceManager->ensureInstanceCapacity(scene->objectStorage.size());
+    // Instances on a square XZ grid starting at the model position; all share one copy of the geometry.
+    const auto instanceCount = static_cast<uint32_t>(std::max(loadedInstanceCount, 1));
+    const auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+    std::vector<Transform> instances(instanceCount);
+    for (uint32_t i = 0; i < instanceCount; ++i) {
+        instances[i].position = glm::make_vec3(loadedModelPosition) +
+            glm::vec3(static_cast<float>(i % columns), 0.0f, static_cast<float>(i / columns)) * loadedInstanceSpacing;
+    }
+    // Parsed on a worker and uploaded on the transfer queue; the entities appear once the copy completes.
+    assetStreamer->request(assetPath, std::move(instances));
 }
 
 void Engine::shutdown() { cleanup(); }
@@ -520,22 +551,25 @@ void Engine::cleanup()
     }
 #endif
 
+    assetStreamer.reset(); // joins parse jobs, releases an in-flight upload's buffers
+
     if (scene) {
         scene->objectStorage.clear();
+        scene->bvh.clear();
     }
     log_info("Object storage cleared", "Engine");
     // Explicitly clear command buffers before destroying other resources
     if (resourceManager) {
         resourceManager->commandBuffers.clear();
-        resourceManager->transferCommandBuffer.clear();
     }
 
     renderer.reset();
     pipeline.reset();
     descriptorManager.reset();
     textureManager.reset();
-    resourceManager.reset(); // before assetsLoader: holds refs to its vertex/index vectors
+    resourceManager.reset(); // before assetsLoader: holds refs to its geometry pool
     assetsLoader.reset();
+    uploads.reset(); // after every uploader; the device is idle, so all staging regions are complete
     scene.reset();
     camera.reset();
     log_info("Resources cleaned up", "Engine");
@@ -1,7 +1,9 @@
 #pragma once
 #include "../Constants.h"
+#include "asset_streamer.hpp"
 #include "assets_loader.hpp"
 #include "texture_manager.hpp"
+#include "upload_batch.hpp"
 #include "../render/vk_pipeline.hpp"
 #include "../render/vk_renderer.hpp"
 #include "../util/vk_tracy.hpp"
@@ -23,9 +25,11 @@ class Engine{
     SDL_Window *window = nullptr;
     std::unique_ptr<Device> device;
     std::unique_ptr<VkAllocator> allocator;
+    std::unique_ptr<UploadContext> uploads;
     std::unique_ptr<SwapChain> swapChain;
     std::unique_ptr<Scene> scene;
     std::unique_ptr<AssetsLoader> assetsLoader;
+    std::unique_ptr<AssetStreamer> assetStreamer;
     std::unique_ptr<ResourceManager> resourceManager;
     std::unique_ptr<VkTracyContext> tracyContext;
     std::unique_ptr<TextureManager> textureManager;
@@ -46,6 +50,9 @@ class Engine{
     std::vector<std::filesystem::path> discoveredAssets;
     int selectedAssetIndex = -1;
     float loadedModelPosition[3] = {0.0f, 0.0f, 0.0f};
+    // "Load Object" spawns a square grid of this many instances, spaced by loadedInstanceSpacing.
+    int loadedInstanceCount = 1;
+    float loadedInstanceSpacing = 2.0f;
     char assetsPathInput[260] = ENGINE_MODELS_DIR;
     void createImGuiDescriptorPool();
     void drawImGui();
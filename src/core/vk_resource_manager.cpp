@@ -1,5 +1,6 @@
 #include "vk_resource_manager.hpp"
 #include <algorithm>
+#include <bit>
 #include <format>
 #include <span>
 #include <glm/gtc/matrix_transform.hpp>
@@ -7,16 +8,15 @@
 #include "Constants.h"
 #include "static_headers/logger.hpp"
 #include "util/debug.hpp"
+#include "util/jobs.hpp"
 #include "util/vk_tracy.hpp"
 #include "util/vk_utils.hpp"
 
 ResourceManager::ResourceManager(const Device &deviceWrapper,
                const VkAllocator &allocator,
-               const std::vector<Vertex> &verticesIn,
-               const std::vector<MeshletDesc>& meshletsIn,
-               const std::vector<uint32_t>& meshletVerticesIn,
-               const std::vector<uint8_t>& meshletTrianglesIn,
-               ObjectStorage &objectStorageIn)
+               GeometryPool &geometryPoolIn,
+               ObjectStorage &objectStorageIn,
+               UploadContext &uploadsIn)
     : deviceWrapper(deviceWrapper),
       allocator(allocator),
       physicalDevice(deviceWrapper.physicalDevice),
@@ -26,37 +26,88 @@ ResourceManager::ResourceManager(const Device &deviceWrapper,
       transferQueue(deviceWrapper.transferQueue),
       hardwareCapabilities(deviceWrapper.capabilities),
       objectStorage(objectStorageIn),
+      uploads(uploadsIn),
       graphicsIndex(deviceWrapper.graphicsIndex),
       transferIndex(deviceWrapper.transferIndex),
       msaaSamples(deviceWrapper.msaaSamples),
-      vertices(verticesIn),
-      meshlets(meshletsIn),
-      meshletVertices(meshletVerticesIn),
-      meshletTriangles(meshletTrianglesIn)
+      geometryPool(geometryPoolIn)
 {
     log_info("Initialized", "ResourceManager");
 }
 
-void ResourceManager::destroyInstanceUboBuffers()
+void ResourceManager::releaseBuffer(vk::raii::Buffer& buffer, VmaAllocation& memory, const char* tracyName,
+                                    bool deferred)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+    VkBuffer raw = buffer.release();
+    if (deferred)
+    {
+        retiredBuffers.push_back(RetiredBuffer{.buffer = raw,
+                                               .memory = memory,
+                                               .tracyName = tracyName,
+                                               .releaseFrame = retireFrameCounter + MAX_FRAMES_IN_FLIGHT});
+    }
+    else
+    {
+        tracyResourceFree(raw, tracyName);
+        vmaDestroyBuffer(allocator.allocator, raw, memory);
+    }
+    memory = nullptr;
+}
+
+void ResourceManager::releaseRetiredBuffers()
+{
+    ++retireFrameCounter;
+    geometryPool.releaseRetired();
+    std::erase_if(retiredBuffers, [this](const RetiredBuffer& retired)
+    {
+        if (retired.releaseFrame > retireFrameCounter)
+        {
+            return false;
+        }
+        tracyResourceFree(retired.buffer, retired.tracyName);
+        vmaDestroyBuffer(allocator.allocator, retired.buffer, retired.memory);
+        return true;
+    });
+}
+
+void ResourceManager::destroyInstanceUboBuffers(bool deferred)
 {
     ZoneScopedN("ResourceManager::destroyInstanceUboBuffers");
+    releaseBuffer(instanceUboBuffer, instanceUboMemory, "GPU/InstanceUBO", deferred);
+    trackedInstanceUboBytes = 0;
+    instanceUboBaseAddress = 0;
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
     {
-        if (instanceUboMapped[i] != nullptr && instanceUboMemory[i] != nullptr)
+        if (instanceUploadMapped[i] != nullptr && instanceUploadMemory[i] != nullptr)
         {
-            vmaUnmapMemory(allocator.allocator, instanceUboMemory[i]);
-            instanceUboMapped[i] = nullptr;
+            vmaUnmapMemory(allocator.allocator, instanceUploadMemory[i]);
+            instanceUploadMapped[i] = nullptr;
         }
-        if (instanceUboMemory[i] != nullptr)
+        releaseBuffer(instanceUploadBuffers[i], instanceUploadMemory[i], "GPU/InstanceUploads", deferred);
+        trackedInstanceUploadBytes[i] = 0;
+        instanceUploadAddresses[i] = 0;
+        instanceUploadCounts[i] = 0;
+
+        if (instanceDrawMapped[i] != nullptr && instanceDrawMemory[i] != nullptr)
         {
-            VkBuffer raw = instanceUboBuffers[i].release();
-            tracyResourceFree(raw, "GPU/InstanceUBO");
-            vmaDestroyBuffer(allocator.allocator, raw, instanceUboMemory[i]);
-            instanceUboMemory[i] = nullptr;
-            trackedInstanceUboBytes[i] = 0;
+            vmaUnmapMemory(allocator.allocator, instanceDrawMemory[i]);
+            instanceDrawMapped[i] = nullptr;
         }
-        instanceUboBaseAddresses[i] = 0;
+        releaseBuffer(instanceDrawBuffers[i], instanceDrawMemory[i], "GPU/InstanceDraws", deferred);
+        trackedInstanceDrawBytes[i] = 0;
+        instanceDrawAddresses[i] = 0;
+
+        releaseBuffer(drawCommandBuffers[i], drawCommandMemory[i], "GPU/DrawCommands", deferred);
+        trackedDrawCommandBytes[i] = 0;
+        drawCommandAddresses[i] = 0;
     }
+    releaseBuffer(visibilityBuffer, visibilityMemory, "GPU/Visibility", deferred);
+    trackedVisibilityBytes = 0;
+    visibilityAddress = 0;
     instanceCapacity = 0;
 }
 
@@ -65,6 +116,11 @@ ResourceManager::~ResourceManager()
     ZoneScopedN("ResourceManager::~ResourceManager");
     log_info("Destructor called", "ResourceManager");
     destroyInstanceUboBuffers();
+    for (const RetiredBuffer& retired : retiredBuffers) {
+        tracyResourceFree(retired.buffer, retired.tracyName);
+        vmaDestroyBuffer(allocator.allocator, retired.buffer, retired.memory);
+    }
+    retiredBuffers.clear();
     {
         if (vertexBufferMemory) {
             VkBuffer raw = vertexBuffer.release();
@@ -109,6 +165,19 @@ ResourceManager::~ResourceManager()
             vmaDestroyImage(allocator.allocator, raw, depthImageMemory);
             trackedDepthBytes = 0;
         }
+        if (depthResolveImageMemory) {
+            depthResolveImageView = nullptr;
+            VkImage raw = depthResolveImage.release();
+            tracyResourceFree(raw, "GPU/DepthResolve");
+            vmaDestroyImage(allocator.allocator, raw, depthResolveImageMemory);
+            trackedDepthResolveBytes = 0;
+        }
+        if (depthPyramidMemory) {
+            VkImage raw = depthPyramidImage.release();
+            tracyResourceFree(raw, "GPU/DepthPyramid");
+            vmaDestroyImage(allocator.allocator, raw, depthPyramidMemory);
+            trackedDepthPyramidBytes = 0;
+        }
     }
 }
 
@@ -118,10 +187,9 @@ void ResourceManager::init()
     log_info("init() started", "ResourceManager");
     createCommandPool();
     createCommandBuffers();
+    createSecondaryCommandBuffers(static_cast<uint32_t>(jobExecutor().num_workers()));
     createUniformBuffers();
-    createVertexBuffer();
-    // Meshlet tables + BDAs for mesh shaders (static geometry; single addresses).
-    createMeshBuffers();
+    // Vertex + meshlet tables are created by the first geometry upload (AssetStreamer).
 }
 
 void ResourceManager::createSyncObjects()
@@ -153,18 +221,37 @@ void ResourceManager::updateUniformBuffers(uint32_t currentImage)
 
     ensureInstanceCapacity(objectStorage.size());
 
-    applyYawSpin(objectStorage.transforms, 0.01f);
+    applyYawSpin(objectStorage, 0.01f);
 
     const glm::mat4 meshPreRotation =
         glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
-    auto* mapped = static_cast<ObjectUB*>(instanceUboMapped[currentImage]);
-    writeObjectUbs(objectStorage, std::span(mapped, objectStorage.size()), meshPreRotation);
+    // Only entities whose ObjectUB changed are listed; the renderer scatters them into the device array.
+    auto* mappedUploads = static_cast<std::byte*>(instanceUploadMapped[currentImage]);
+    instanceUploadCounts[currentImage] = writeObjectUbUploads(
+        objectStorage, std::span(reinterpret_cast<ObjectUB*>(mappedUploads), objectStorage.size()),
+        std::span(reinterpret_cast<uint32_t*>(mappedUploads + instanceUploadIndexOffset()), objectStorage.size()),
+        meshPreRotation);
+    TracyPlot("Vulkan/InstanceUploadBytes",
+              static_cast<double>(instanceUploadCounts[currentImage] * (sizeof(ObjectUB) + sizeof(uint32_t))));
+
+    auto* mappedDraws = static_cast<InstanceDraw*>(instanceDrawMapped[currentImage]);
+    writeInstanceDraws(objectStorage, std::span(mappedDraws, objectStorage.size()));
+}
+
+vk::DeviceAddress ResourceManager::instanceUboAddress(EntityId entityId) const noexcept
+{
+    return instanceUboBaseAddress + static_cast<vk::DeviceAddress>(entityId) * sizeof(ObjectUB);
+}
+
+vk::DeviceSize ResourceManager::instanceUploadIndexOffset() const noexcept
+{
+    return sizeof(ObjectUB) * static_cast<vk::DeviceSize>(instanceCapacity);
 }
 
-vk::DeviceAddress ResourceManager::instanceUboAddress(uint32_t frameSlot, EntityId entityId) const noexcept
+vk::DeviceSize ResourceManager::lateDrawCommandsOffset() const noexcept
 {
-    return instanceUboBaseAddresses[frameSlot] + static_cast<vk::DeviceAddress>(entityId) * sizeof(ObjectUB);
+    return kDrawCommandsOffset + sizeof(DrawMeshTasksCommand) * static_cast<vk::DeviceSize>(instanceCapacity);
 }
 
 
@@ -177,12 +264,6 @@ void ResourceManager::createCommandPool()
                                        .queueFamilyIndex = graphicsIndex};
     commandPool = vk::raii::CommandPool(device, poolInfo);
     setDebugName(device, commandPool, "GraphicsCommandPool");
-    vk::CommandPoolCreateInfo transferPoolInfo{.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-                                               .queueFamilyIndex = transferIndex};
-    if (transferIndex != graphicsIndex && transferIndex != UINT32_MAX) {
-        transferCommandPool = vk::raii::CommandPool(device, transferPoolInfo);
-        setDebugName(device, transferCommandPool, "TransferCommandPool");
-    }
 }
 
 void ResourceManager::createCommandBuffers()
@@ -197,17 +278,32 @@ void ResourceManager::createCommandBuffers()
     for (size_t i = 0; i < commandBuffers.size(); ++i) {
         setDebugName(device, commandBuffers[i], std::format("GraphicsCommandBuffer_{}", i));
     }
-    if (transferIndex != UINT32_MAX && transferIndex != graphicsIndex) {
-        vk::CommandBufferAllocateInfo transferAllocInfo{.commandPool = transferCommandPool,
-                                                        .level = vk::CommandBufferLevel::ePrimary,
-                                                        .commandBufferCount = MAX_FRAMES_IN_FLIGHT};
-        transferCommandBuffer = vk::raii::CommandBuffers(device, transferAllocInfo);
-        for (size_t i = 0; i < transferCommandBuffer.size(); ++i) {
-            setDebugName(device, transferCommandBuffer[i], std::format("TransferCommandBuffer_{}", i));
+    log_info(std::format("Command buffers allocated: {}", commandBuffers.size()), "ResourceManager");
+}
+
+void ResourceManager::createSecondaryCommandBuffers(uint32_t workerCount)
+{
+    ZoneScopedN("ResourceManager::createSecondaryCommandBuffers");
+    log_info("createSecondaryCommandBuffers() started", "ResourceManager");
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+        auto& contexts = secondaryRecordContexts[frame];
+        contexts.clear();
+        contexts.reserve(workerCount);
+        for (uint32_t worker = 0; worker < workerCount; ++worker) {
+            SecondaryRecordContext context;
+            context.pool = vk::raii::CommandPool(
+                device, {.flags = vk::CommandPoolCreateFlagBits::eTransient, .queueFamilyIndex = graphicsIndex});
+            setDebugName(device, context.pool, std::format("SecondaryCommandPool_{}_{}", frame, worker));
+
+            vk::raii::CommandBuffers buffers(device, {.commandPool = context.pool,
+                                                      .level = vk::CommandBufferLevel::eSecondary,
+                                                      .commandBufferCount = 1});
+            context.commandBuffer = std::move(buffers.front());
+            setDebugName(device, context.commandBuffer, std::format("SecondaryCommandBuffer_{}_{}", frame, worker));
+            contexts.push_back(std::move(context));
         }
     }
-    log_info(std::format("Command buffers allocated: {}", commandBuffers.size()), "ResourceManager");
-    log_info(std::format("Transfer command buffers allocated: {}", transferCommandBuffer.size()), "ResourceManager");
+    log_info(std::format("Secondary command buffers allocated: {} per frame", workerCount), "ResourceManager");
 }
 
 [[nodiscard]] vk::raii::ShaderModule ResourceManager::createShaderModule(const std::vector<char>& code) const
@@ -220,20 +316,6 @@ void ResourceManager::createCommandBuffers()
     return shaderModule;
 }
 
-void ResourceManager::copyBuffer(vk::raii::Buffer& srcBuffer, vk::raii::Buffer& dstBuffer, vk::DeviceSize size)
-{
-    ZoneScopedN("ResourceManager::copyBuffer");
-    log_info("copyBuffer() started", "ResourceManager");
-    transferCommandBuffer[0].begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
-    transferCommandBuffer[0].copyBuffer(srcBuffer, dstBuffer, vk::BufferCopy(0, 0, size));
-    transferCommandBuffer[0].end();
-    vk::CommandBufferSubmitInfo commandBufferInfo = {.commandBuffer = *transferCommandBuffer[0]};
-    const vk::SubmitInfo2 submitInfo{.commandBufferInfoCount = 1, .pCommandBufferInfos = &commandBufferInfo};
-    transferQueue.submit2(submitInfo, nullptr);
-    transferQueue.waitIdle();
-}
-
-
 void ResourceManager::endCommandBuffer(vk::raii::CommandBuffer& commandBuffer, const vk::raii::Queue& queue)
 {
     ZoneScopedN("ResourceManager::endCommandBuffer");
@@ -246,202 +328,6 @@ void ResourceManager::endCommandBuffer(vk::raii::CommandBuffer& commandBuffer, c
     queue.waitIdle();
 }
 
-void ResourceManager::createVertexBuffer()
-{
-    ZoneScopedN("ResourceManager::createVertexBuffer");
-    log_info("createVertexBuffer() started", "ResourceManager");
-    log_info(std::format("Creating vertex buffer with {} vertices", vertices.size()), "ResourceManager");
-
-    if (vertices.empty()) {
-        log_info("No vertices present, skipping vertex buffer creation", "ResourceManager");
-        return;
-    }
-
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-
-    createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                 stagingBufferMemory, allocator.allocator, device, queueFamilyIndices, "VertexStagingBufferMemory");
-    setDebugName(device, stagingBuffer, "VertexStagingBuffer");
-
-    void* dataStaging = nullptr;
-    vmaMapMemory(allocator.allocator, stagingBufferMemory, &dataStaging);
-    memcpy(dataStaging, vertices.data(), bufferSize);
-    vmaUnmapMemory(allocator.allocator, stagingBufferMemory);
-
-    if (vertexBufferMemory != nullptr) {
-        VkBuffer rawVertex = vertexBuffer.release();
-        tracyResourceFree(rawVertex, "GPU/Vertices");
-        vmaDestroyBuffer(allocator.allocator, rawVertex, vertexBufferMemory);
-        vertexBufferMemory = nullptr;
-        trackedVertexBytes = 0;
-    }
-
-    // eStorageBuffer | eShaderDeviceAddress: mesh shader BDA loads (MeshPushData.vertices).
-    createBuffer(bufferSize,
-                 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer |
-                     vk::BufferUsageFlagBits::eShaderDeviceAddress,
-                 vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory, allocator.allocator, device, queueFamilyIndices, "VertexBufferMemory");
-    setDebugName(device, vertexBuffer, "VertexBuffer");
-    tracyResourceAlloc(static_cast<VkBuffer>(*vertexBuffer), static_cast<size_t>(bufferSize), "GPU/Vertices");
-    trackedVertexBytes = bufferSize;
-
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-    // Free staging buffer after use to avoid leaking allocations
-    if (stagingBufferMemory != nullptr) {
-        VkBuffer rawStaging = stagingBuffer.release();
-        vmaDestroyBuffer(allocator.allocator, rawStaging, stagingBufferMemory);
-        stagingBufferMemory = nullptr;
-    }
-
-    vertexBufferAddress = device.getBufferAddress({.buffer = *vertexBuffer});
-}
-
-void ResourceManager::createMeshBuffers()
-{
-    ZoneScopedN("ResourceManager::createMeshBuffers");
-    log_info("createMeshBuffers() started", "ResourceManager");
-    // Create meshlet descriptor buffer (MeshletDesc[])
-    log_info(std::format("Creating Meshlet buffer with {} entries", meshlets.size()), "ResourceManager");
-    if (meshlets.empty()) {
-        log_info("No meshlets present, skipping meshlet buffer creation", "ResourceManager");
-    } else {
-        vk::DeviceSize bufferSize = sizeof(MeshletDesc) * meshlets.size();
-
-        createBuffer(bufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                     stagingBufferMemory, allocator.allocator, device, queueFamilyIndices, "MeshletStagingBufferMemory");
-        setDebugName(device, stagingBuffer, "MeshletStagingBuffer");
-
-        void* data = nullptr;
-        vmaMapMemory(allocator.allocator, stagingBufferMemory, &data);
-        memcpy(data, meshlets.data(), bufferSize);
-        vmaUnmapMemory(allocator.allocator, stagingBufferMemory);
-
-        if (meshletBufferMemory != nullptr) {
-            VkBuffer rawMeshlet = meshletBuffer.release();
-            tracyResourceFree(rawMeshlet, "GPU/Meshlets");
-            vmaDestroyBuffer(allocator.allocator, rawMeshlet, meshletBufferMemory);
-            meshletBufferMemory = nullptr;
-            trackedMeshletBytes = 0;
-        }
-
-        createBuffer(bufferSize,
-                     vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal, meshletBuffer, meshletBufferMemory, allocator.allocator, device, queueFamilyIndices,
-                     "MeshletBufferMemory");
-        setDebugName(device, meshletBuffer, "MeshletBuffer");
-        tracyResourceAlloc(static_cast<VkBuffer>(*meshletBuffer), static_cast<size_t>(bufferSize), "GPU/Meshlets");
-        trackedMeshletBytes = bufferSize;
-
-        copyBuffer(stagingBuffer, meshletBuffer, bufferSize);
-
-        // Free staging buffer after use to avoid leaking allocations
-        if (stagingBufferMemory != nullptr) {
-            VkBuffer rawStaging = stagingBuffer.release();
-            vmaDestroyBuffer(allocator.allocator, rawStaging, stagingBufferMemory);
-            stagingBufferMemory = nullptr;
-        }
-
-        meshletBufferAddress = device.getBufferAddress({.buffer = *meshletBuffer});
-    }
-
-    // Create meshlet vertex remap buffer (uint32_t[])
-    log_info(std::format("Creating meshletVertexBuffer buffer with {} entries", meshletVertices.size()), "ResourceManager");
-    if (meshletVertices.empty()) {
-        log_info("No meshlet vertex remap data, skipping meshletVertexBuffer creation", "ResourceManager");
-    } else {
-        vk::DeviceSize vertexBufferSize = sizeof(meshletVertices[0]) * meshletVertices.size();
-
-        createBuffer(vertexBufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                     stagingBufferMemory, allocator.allocator, device, queueFamilyIndices, "MeshletVertexStagingBufferMemory");
-        setDebugName(device, stagingBuffer, "MeshletVertexStagingBuffer");
-
-        void* vdata = nullptr;
-        vmaMapMemory(allocator.allocator, stagingBufferMemory, &vdata);
-        memcpy(vdata, meshletVertices.data(), vertexBufferSize);
-        vmaUnmapMemory(allocator.allocator, stagingBufferMemory);
-
-        if (meshletVertexBufferMemory != nullptr) {
-            VkBuffer raw = meshletVertexBuffer.release();
-            tracyResourceFree(raw, "GPU/MeshletVertices");
-            vmaDestroyBuffer(allocator.allocator, raw, meshletVertexBufferMemory);
-            meshletVertexBufferMemory = nullptr;
-            trackedMeshletVertexBytes = 0;
-        }
-
-        // Remap table is SSBO-style BDA traffic in the mesh shader (uint[]), not a vertex binding.
-        createBuffer(vertexBufferSize,
-                     vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer |
-                         vk::BufferUsageFlagBits::eShaderDeviceAddress,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal, meshletVertexBuffer, meshletVertexBufferMemory, allocator.allocator,
-                     device, queueFamilyIndices, "MeshletVertexBufferMemory");
-        setDebugName(device, meshletVertexBuffer, "MeshletVertexBuffer");
-        tracyResourceAlloc(static_cast<VkBuffer>(*meshletVertexBuffer), static_cast<size_t>(vertexBufferSize),
-                           "GPU/MeshletVertices");
-        trackedMeshletVertexBytes = vertexBufferSize;
-
-        copyBuffer(stagingBuffer, meshletVertexBuffer, vertexBufferSize);
-
-        if (stagingBufferMemory != nullptr) {
-            VkBuffer rawStaging = stagingBuffer.release();
-            vmaDestroyBuffer(allocator.allocator, rawStaging, stagingBufferMemory);
-            stagingBufferMemory = nullptr;
-        }
-
-        meshletVertexBufferAddress = device.getBufferAddress({.buffer = *meshletVertexBuffer});
-    }
-
-    // Create meshlet triangle local-corner buffer (uint8_t[])
-    log_info(std::format("Creating meshletTriangleBuffer buffer with {} entries", meshletTriangles.size()), "ResourceManager");
-    if (meshletTriangles.empty()) {
-        log_info("No meshlet triangle data, skipping meshletTriangleBuffer creation", "ResourceManager");
-    } else {
-        vk::DeviceSize triBufferSize = sizeof(meshletTriangles[0]) * meshletTriangles.size();
-
-        createBuffer(triBufferSize, vk::BufferUsageFlagBits::eTransferSrc,
-                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, stagingBuffer,
-                     stagingBufferMemory, allocator.allocator, device, queueFamilyIndices, "MeshletTriangleStagingBufferMemory");
-        setDebugName(device, stagingBuffer, "MeshletTriangleStagingBuffer");
-
-        void* tdata = nullptr;
-        vmaMapMemory(allocator.allocator, stagingBufferMemory, &tdata);
-        memcpy(tdata, meshletTriangles.data(), triBufferSize);
-        vmaUnmapMemory(allocator.allocator, stagingBufferMemory);
-
-        if (meshletTriangleBufferMemory != nullptr) {
-            VkBuffer raw = meshletTriangleBuffer.release();
-            tracyResourceFree(raw, "GPU/MeshletTriangles");
-            vmaDestroyBuffer(allocator.allocator, raw, meshletTriangleBufferMemory);
-            meshletTriangleBufferMemory = nullptr;
-            trackedMeshletTriangleBytes = 0;
-        }
-
-        createBuffer(triBufferSize,
-                     vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal, meshletTriangleBuffer, meshletTriangleBufferMemory, allocator.allocator,
-                     device, queueFamilyIndices, "MeshletTriangleBufferMemory");
-        setDebugName(device, meshletTriangleBuffer, "MeshletTriangleBuffer");
-        tracyResourceAlloc(static_cast<VkBuffer>(*meshletTriangleBuffer), static_cast<size_t>(triBufferSize),
-                           "GPU/MeshletTriangles");
-        trackedMeshletTriangleBytes = triBufferSize;
-
-        copyBuffer(stagingBuffer, meshletTriangleBuffer, triBufferSize);
-
-        if (stagingBufferMemory != nullptr) {
-            VkBuffer rawStaging = stagingBuffer.release();
-            vmaDestroyBuffer(allocator.allocator, rawStaging, stagingBufferMemory);
-            stagingBufferMemory = nullptr;
-        }
-
-        meshletTriangleBufferAddress = device.getBufferAddress({.buffer = *meshletTriangleBuffer});
-    }
-
-}
-
 void ResourceManager::createCameraBuffers(Camera& camera)
 {
     ZoneScopedN("ResourceManager::createCameraBuffers");
@@ -485,31 +371,98 @@ void ResourceManager::ensureInstanceCapacity(uint32_t entityCount)
     log_info(std::format("Growing instance ObjectUB capacity {} -> {}", instanceCapacity, newCapacity),
              "ResourceManager");
 
-    destroyInstanceUboBuffers();
+    // Frames in flight may still read the old arrays (streamed loads grow them without a device wait).
+    destroyInstanceUboBuffers(true);
     instanceCapacity = newCapacity;
 
     const vk::DeviceSize bufferSize = sizeof(ObjectUB) * static_cast<vk::DeviceSize>(instanceCapacity);
+    createBuffer(bufferSize, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, instanceUboBuffer, instanceUboMemory, allocator.allocator,
+                 device, queueFamilyIndices, "InstanceObjectUBMemory");
+    instanceUboBaseAddress = device.getBufferAddress({.buffer = *instanceUboBuffer});
+    setDebugName(device, instanceUboBuffer, "InstanceObjectUB");
+    tracyResourceAlloc(static_cast<VkBuffer>(*instanceUboBuffer), static_cast<size_t>(bufferSize), "GPU/InstanceUBO");
+    trackedInstanceUboBytes = bufferSize;
+
+    // Sized for every entity changing at once (the first frame after a capacity change uploads them all).
+    const vk::DeviceSize uploadBufferSize = instanceUploadIndexOffset() +
+        sizeof(uint32_t) * static_cast<vk::DeviceSize>(instanceCapacity);
     for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
     {
         vk::raii::Buffer buffer({});
         VmaAllocation bufferMem = nullptr;
-        createBuffer(bufferSize,
-                     vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
-                         vk::BufferUsageFlagBits::eShaderDeviceAddress,
+        createBuffer(uploadBufferSize,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
                      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, buffer,
                      bufferMem, allocator.allocator, device, queueFamilyIndices,
-                     std::format("InstanceObjectUBMemory_{}", i));
-        instanceUboBuffers[i] = std::move(buffer);
-        instanceUboMemory[i] = bufferMem;
+                     std::format("InstanceUploadMemory_{}", i));
+        instanceUploadBuffers[i] = std::move(buffer);
+        instanceUploadMemory[i] = bufferMem;
         void* data = nullptr;
         vmaMapMemory(allocator.allocator, bufferMem, &data);
-        instanceUboMapped[i] = data;
-        instanceUboBaseAddresses[i] = device.getBufferAddress({.buffer = *instanceUboBuffers[i]});
-        setDebugName(device, instanceUboBuffers[i], std::format("InstanceObjectUB_{}", i));
-        tracyResourceAlloc(static_cast<VkBuffer>(*instanceUboBuffers[i]), static_cast<size_t>(bufferSize),
-                           "GPU/InstanceUBO");
-        trackedInstanceUboBytes[i] = bufferSize;
+        instanceUploadMapped[i] = data;
+        instanceUploadAddresses[i] = device.getBufferAddress({.buffer = *instanceUploadBuffers[i]});
+        setDebugName(device, instanceUploadBuffers[i], std::format("InstanceUploads_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*instanceUploadBuffers[i]), static_cast<size_t>(uploadBufferSize),
+                           "GPU/InstanceUploads");
+        trackedInstanceUploadBytes[i] = uploadBufferSize;
+
+        const vk::DeviceSize drawBufferSize = sizeof(InstanceDraw) * static_cast<vk::DeviceSize>(instanceCapacity);
+        vk::raii::Buffer drawBuffer({});
+        VmaAllocation drawBufferMem = nullptr;
+        createBuffer(drawBufferSize,
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, drawBuffer,
+                     drawBufferMem, allocator.allocator, device, queueFamilyIndices,
+                     std::format("InstanceDrawMemory_{}", i));
+        instanceDrawBuffers[i] = std::move(drawBuffer);
+        instanceDrawMemory[i] = drawBufferMem;
+        void* drawData = nullptr;
+        vmaMapMemory(allocator.allocator, drawBufferMem, &drawData);
+        instanceDrawMapped[i] = drawData;
+        instanceDrawAddresses[i] = device.getBufferAddress({.buffer = *instanceDrawBuffers[i]});
+        setDebugName(device, instanceDrawBuffers[i], std::format("InstanceDraws_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*instanceDrawBuffers[i]), static_cast<size_t>(drawBufferSize),
+                           "GPU/InstanceDraws");
+        trackedInstanceDrawBytes[i] = drawBufferSize;
+
+        // Written by cull.slang, consumed by drawMeshTasksIndirectCountEXT; the counts are reset with fillBuffer.
+        // Two command regions: early pass (last frame's visible set) and late pass (newly disoccluded).
+        const vk::DeviceSize commandBufferSize =
+            kDrawCommandsOffset + 2 * sizeof(DrawMeshTasksCommand) * static_cast<vk::DeviceSize>(instanceCapacity);
+        vk::raii::Buffer commandBuffer({});
+        VmaAllocation commandBufferMem = nullptr;
+        createBuffer(commandBufferSize,
+                     vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                         vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, commandBuffer, commandBufferMem, allocator.allocator,
+                     device, queueFamilyIndices, std::format("DrawCommandMemory_{}", i));
+        drawCommandBuffers[i] = std::move(commandBuffer);
+        drawCommandMemory[i] = commandBufferMem;
+        drawCommandAddresses[i] = device.getBufferAddress({.buffer = *drawCommandBuffers[i]});
+        setDebugName(device, drawCommandBuffers[i], std::format("DrawCommands_{}", i));
+        tracyResourceAlloc(static_cast<VkBuffer>(*drawCommandBuffers[i]), static_cast<size_t>(commandBufferSize),
+                           "GPU/DrawCommands");
+        trackedDrawCommandBytes[i] = commandBufferSize;
     }
+
+    // The new ObjectUB array starts empty: every entity is uploaded into it again.
+    objectStorage.invalidateObjectUbs();
+
+    // Fresh visibility starts all-zero: the first early pass draws nothing and the late pass
+    // (against an empty pyramid) re-establishes the visible set.
+    const vk::DeviceSize visibilitySize = sizeof(uint32_t) * static_cast<vk::DeviceSize>(instanceCapacity);
+    createBuffer(visibilitySize,
+                 vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                     vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, visibilityBuffer, visibilityMemory, allocator.allocator,
+                 device, queueFamilyIndices, "VisibilityMemory");
+    visibilityAddress = device.getBufferAddress({.buffer = *visibilityBuffer});
+    setDebugName(device, visibilityBuffer, "Visibility");
+    tracyResourceAlloc(static_cast<VkBuffer>(*visibilityBuffer), static_cast<size_t>(visibilitySize),
+                       "GPU/Visibility");
+    trackedVisibilityBytes = visibilitySize;
+    visibilityResetPending = true;
 }
 
 void ResourceManager::createUniformBuffers()
@@ -519,12 +472,101 @@ void ResourceManager::createUniformBuffers()
     ensureInstanceCapacity(std::max(objectStorage.size(), 1u));
 }
 
-void ResourceManager::recreateObjectsBuffers()
+ResourceManager::GeometryTable ResourceManager::geometryTable(uint32_t table)
+{
+    switch (table) {
+    case 0:
+        return {vertexBuffer, vertexBufferMemory, vertexBufferAddress, trackedVertexBytes,
+                sizeof(GpuVertex) * geometryPool.vertexRanges.capacity(), sizeof(GpuVertex), "VertexBuffer",
+                "GPU/Vertices"};
+    case 1:
+        return {meshletBuffer, meshletBufferMemory, meshletBufferAddress, trackedMeshletBytes,
+                sizeof(MeshletDesc) * geometryPool.meshletRanges.capacity(), sizeof(MeshletDesc), "MeshletBuffer",
+                "GPU/Meshlets"};
+    case 2:
+        return {meshletVertexBuffer, meshletVertexBufferMemory, meshletVertexBufferAddress,
+                trackedMeshletVertexBytes, sizeof(uint32_t) * geometryPool.meshletVertexRanges.capacity(),
+                sizeof(uint32_t), "MeshletVertexBuffer", "GPU/MeshletVertices"};
+    default:
+        return {meshletTriangleBuffer, meshletTriangleBufferMemory, meshletTriangleBufferAddress,
+                trackedMeshletTriangleBytes, sizeof(uint8_t) * geometryPool.meshletTriangleRanges.capacity(),
+                sizeof(uint8_t), "MeshletTriangleBuffer", "GPU/MeshletTriangles"};
+    }
+}
+
+void ResourceManager::recordGeometryUpload(UploadBatch& batch, const GeometryRanges& ranges,
+                                           const GeometryWriter& write, GeometryUpload& upload)
 {
-    ZoneScopedN("ResourceManager::recreateObjectsBuffers");
-    log_info("recreateObjectsBuffers() started", "ResourceManager");
-    createVertexBuffer();
-    createMeshBuffers();
+    ZoneScopedN("ResourceManager::recordGeometryUpload");
+    const std::array<vk::DeviceSize, kGeometryTableCount> firstElements{
+        ranges.firstVertex, ranges.firstMeshlet, ranges.firstMeshletVertex, ranges.firstMeshletTriangle};
+    const std::array<vk::DeviceSize, kGeometryTableCount> elementCounts{
+        ranges.vertexCount, ranges.meshletCount, ranges.meshletVertexCount, ranges.meshletTriangleCount};
+
+    // A table smaller than its arena is replaced and swapped in on completion (the first upload creates it).
+    // Live ranges can sit anywhere in the old arena, so all of it is carried over first.
+    // eStorageBuffer | eShaderDeviceAddress: mesh shader BDA loads (MeshPushData tables); eTransferSrc: source
+    // of the next carry-over.
+    bool carriedOver = false;
+    for (uint32_t t = 0; t < kGeometryTableCount; ++t) {
+        const GeometryTable table = geometryTable(t);
+        if (elementCounts[t] == 0 || table.arenaBytes <= table.capacity) {
+            continue;
+        }
+        createBuffer(table.arenaBytes,
+                     vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst |
+                         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress,
+                     vk::MemoryPropertyFlagBits::eDeviceLocal, upload.grownBuffers[t], upload.grownMemory[t],
+                     allocator.allocator, device, queueFamilyIndices, std::format("{}Memory", table.debugName));
+        setDebugName(device, upload.grownBuffers[t], table.debugName);
+        upload.grownCapacity[t] = table.arenaBytes;
+        if (table.memory != nullptr) {
+            batch.copyBuffer(*table.buffer, *upload.grownBuffers[t], vk::BufferCopy(0, 0, table.capacity));
+            carriedOver = true;
+        }
+    }
+    if (carriedOver) {
+        // The new range may start inside the carried-over region: order the two writes.
+        const vk::MemoryBarrier2 barrier{.srcStageMask = vk::PipelineStageFlagBits2::eAllTransfer,
+                                         .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                         .dstStageMask = vk::PipelineStageFlagBits2::eAllTransfer,
+                                         .dstAccessMask = vk::AccessFlagBits2::eTransferWrite};
+        batch.commandBuffer().pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+    }
+
+    // Freshly allocated pool ranges are not referenced by any draw (freed ones were retired past the frames in
+    // flight), so an in-place write needs no sync with the graphics queue.
+    for (uint32_t t = 0; t < kGeometryTableCount; ++t) {
+        if (elementCounts[t] == 0) {
+            continue;
+        }
+        const GeometryTable table = geometryTable(t);
+        const vk::Buffer destination = upload.grownMemory[t] != nullptr ? *upload.grownBuffers[t] : *table.buffer;
+        batch.writeToBuffer(destination, firstElements[t] * table.elementSize, elementCounts[t] * table.elementSize,
+                            [&](std::byte* staging) { write(t, staging); });
+    }
+}
+
+void ResourceManager::finishGeometryUpload(GeometryUpload& upload)
+{
+    ZoneScopedN("ResourceManager::finishGeometryUpload");
+    for (uint32_t t = 0; t < kGeometryTableCount; ++t) {
+        if (upload.grownMemory[t] == nullptr) {
+            continue;
+        }
+        const GeometryTable table = geometryTable(t);
+        log_info(std::format("{} grown {} -> {} bytes", table.debugName, table.capacity, upload.grownCapacity[t]),
+                 "ResourceManager");
+        releaseBuffer(table.buffer, table.memory, table.tracyName, true);
+        table.buffer = std::move(upload.grownBuffers[t]);
+        table.memory = upload.grownMemory[t];
+        table.capacity = upload.grownCapacity[t];
+        upload.grownMemory[t] = nullptr;
+        tracyResourceAlloc(static_cast<VkBuffer>(*table.buffer), static_cast<size_t>(table.capacity),
+                           table.tracyName);
+        table.address = device.getBufferAddress({.buffer = *table.buffer});
+    }
+    uploadTimelineReadyValue = std::max(uploadTimelineReadyValue, upload.timelineValue);
 }
 
 void ResourceManager::tracyPlotResources() const
@@ -543,17 +585,34 @@ void ResourceManager::tracyPlotResources() const
     TracyPlot("Vulkan/EntityCount", static_cast<double>(objectStorage.size()));
     TracyPlot("Vulkan/ActiveEntities", static_cast<double>(activeEntities));
     TracyPlot("Vulkan/ActiveMeshlets", static_cast<double>(activeMeshlets));
-    TracyPlot("Vulkan/MeshletCount", static_cast<double>(meshlets.size()));
-    TracyPlot("Vulkan/MeshletVertexCount", static_cast<double>(meshletVertices.size()));
-    TracyPlot("Vulkan/MeshletTriangleCorners", static_cast<double>(meshletTriangles.size()));
-    TracyPlot("Vulkan/VerticesInUse", static_cast<double>(vertices.size()));
+    TracyPlot("Vulkan/MeshletCount", static_cast<double>(geometryPool.meshletRanges.usedCount()));
+    TracyPlot("Vulkan/MeshletVertexCount", static_cast<double>(geometryPool.meshletVertexRanges.usedCount()));
+    TracyPlot("Vulkan/MeshletTriangleCorners", static_cast<double>(geometryPool.meshletTriangleRanges.usedCount()));
+    TracyPlot("Vulkan/VerticesInUse", static_cast<double>(geometryPool.vertexRanges.usedCount()));
+    TracyPlot("Vulkan/VertexPoolCapacity", static_cast<double>(geometryPool.vertexRanges.capacity()));
+    TracyPlot("Vulkan/GeometryFreeRanges",
+              static_cast<double>(geometryPool.vertexRanges.freeRangeCount() +
+                                  geometryPool.meshletRanges.freeRangeCount() +
+                                  geometryPool.meshletVertexRanges.freeRangeCount() +
+                                  geometryPool.meshletTriangleRanges.freeRangeCount()));
     TracyPlot("Vulkan/VertexBytesInUse", static_cast<double>(trackedVertexBytes));
     TracyPlot("Vulkan/MeshletBytes", static_cast<double>(trackedMeshletBytes));
     TracyPlot("Vulkan/MeshletVertexBytes", static_cast<double>(trackedMeshletVertexBytes));
     TracyPlot("Vulkan/MeshletTriangleBytes", static_cast<double>(trackedMeshletTriangleBytes));
     TracyPlot("Vulkan/InstanceCapacity", static_cast<double>(instanceCapacity));
-    TracyPlot("Vulkan/InstanceUboBytes", static_cast<double>(trackedInstanceUboBytes[0]));
+    TracyPlot("Vulkan/InstanceUboBytes", static_cast<double>(trackedInstanceUboBytes));
+    TracyPlot("Vulkan/InstanceUploadBufferBytes", static_cast<double>(trackedInstanceUploadBytes[0]));
+    TracyPlot("Vulkan/InstanceDrawBytes", static_cast<double>(trackedInstanceDrawBytes[0]));
+    TracyPlot("Vulkan/DrawCommandBytes", static_cast<double>(trackedDrawCommandBytes[0]));
+    TracyPlot("Vulkan/VisibilityBytes", static_cast<double>(trackedVisibilityBytes));
+    TracyPlot("Vulkan/DepthPyramidBytes", static_cast<double>(trackedDepthPyramidBytes));
+    TracyPlot("Vulkan/DepthPyramidLevels", static_cast<double>(depthPyramidLevels));
     TracyPlot("Vulkan/CommandBuffersInUse", static_cast<double>(commandBuffers.size()));
+    TracyPlot("Vulkan/RetiredBuffers", static_cast<double>(retiredBuffers.size()));
+    TracyPlot("Vulkan/UploadTimelineReady", static_cast<double>(uploadTimelineReadyValue));
+    TracyPlot("Vulkan/StagingRingBytes", static_cast<double>(uploads.staging.usedBytes()));
+    TracyPlot("Vulkan/StagingPendingRegions", static_cast<double>(uploads.staging.pendingRegionCount()));
+    TracyPlot("Vulkan/StagingDedicatedBuffers", static_cast<double>(uploads.staging.dedicatedBufferCount()));
     TracyPlot("Vulkan/MeshBdaReady",
               static_cast<double>(vertexBufferAddress != 0 && meshletBufferAddress != 0 &&
                                   meshletVertexBufferAddress != 0 && meshletTriangleBufferAddress != 0));
@@ -624,8 +683,9 @@ void ResourceManager::createColorResources()
     }
     vk::Format colorFormat = swapChainImageFormat;
 
+    // Not transient: the early and late Hi-Z passes store and reload the MSAA color between renderings.
     createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eTransientAttachment | vk::ImageUsageFlagBits::eColorAttachment,
+                vk::ImageUsageFlagBits::eColorAttachment,
                 vk::MemoryPropertyFlagBits::eDeviceLocal, colorImage, colorImageMemory, "ColorImageMemory");
     setDebugName(device, colorImage, "ColorImage");
     // Approximate MSAA color footprint (4 B/pixel * samples).
@@ -711,6 +771,7 @@ void ResourceManager::createDepthResources()
     ZoneScopedN("ResourceManager::createDepthResources");
     log_info("createDepthResources() started", "ResourceManager");
     vk::Format depthFormat = findDepthFormat();
+    depthImageFormat = depthFormat;
     log_info(std::format("Depth format selected: {}", vk::to_string(depthFormat)), "ResourceManager");
 
     // Destroy previous depth resources before recreating
@@ -746,6 +807,113 @@ void ResourceManager::createDepthResources()
                            .baseArrayLayer = 0,
                            .layerCount = 1});
     endCommandBuffer(commandBuffers[0], graphicsQueue);
+
+    createDepthPyramid();
+}
+
+void ResourceManager::createDepthPyramid()
+{
+    ZoneScopedN("ResourceManager::createDepthPyramid");
+    log_info("createDepthPyramid() started", "ResourceManager");
+    const vk::Format depthFormat = depthImageFormat;
+
+    if (depthResolveImageMemory != nullptr) {
+        depthResolveImageView = nullptr;
+        VkImage raw = depthResolveImage.release();
+        tracyResourceFree(raw, "GPU/DepthResolve");
+        vmaDestroyImage(allocator.allocator, raw, depthResolveImageMemory);
+        depthResolveImageMemory = nullptr;
+        trackedDepthResolveBytes = 0;
+    }
+    if (depthPyramidMemory != nullptr) {
+        VkImage raw = depthPyramidImage.release();
+        tracyResourceFree(raw, "GPU/DepthPyramid");
+        vmaDestroyImage(allocator.allocator, raw, depthPyramidMemory);
+        depthPyramidMemory = nullptr;
+        trackedDepthPyramidBytes = 0;
+    }
+
+    // MAX keeps the farthest sample per pixel, the only resolve that is conservative for occlusion. Any other
+    // mode (SAMPLE_ZERO) would let MSAA edge pixels report nearer depth than the covered geometry.
+    hiZOcclusion = static_cast<bool>(hardwareCapabilities.vulkan12.supportedDepthResolveModes &
+                                     vk::ResolveModeFlagBits::eMax);
+    depthResolveMode = hiZOcclusion ? vk::ResolveModeFlagBits::eMax : vk::ResolveModeFlagBits::eNone;
+    if (!hiZOcclusion) {
+        log_info("Device lacks MAX depth resolve; Hi-Z occlusion culling disabled (late pass culls by frustum only)",
+                 "ResourceManager");
+    }
+
+    createImage(swapChainExtent.width, swapChainExtent.height, 1, vk::SampleCountFlagBits::e1, depthFormat,
+                vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, depthResolveImage, depthResolveImageMemory,
+                "DepthResolveImageMemory");
+    setDebugName(device, depthResolveImage, "DepthResolveImage");
+    trackedDepthResolveBytes = static_cast<vk::DeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4u;
+    tracyResourceAlloc(static_cast<VkImage>(*depthResolveImage), static_cast<size_t>(trackedDepthResolveBytes),
+                       "GPU/DepthResolve");
+    depthResolveImageView = createImageView(depthResolveImage, depthFormat, vk::ImageAspectFlagBits::eDepth, 1);
+    setDebugName(device, depthResolveImageView, "DepthResolveImageView");
+
+    // Previous power of two keeps every 2x2 reduction exact; level 0 covers the whole screen in UV space.
+    depthPyramidExtent = vk::Extent2D{std::bit_floor(std::max(swapChainExtent.width, 1u)),
+                                      std::bit_floor(std::max(swapChainExtent.height, 1u))};
+    depthPyramidLevels = std::min<uint32_t>(
+        std::bit_width(std::max(depthPyramidExtent.width, depthPyramidExtent.height)), kMaxDepthPyramidLevels);
+
+    createImage(depthPyramidExtent.width, depthPyramidExtent.height, depthPyramidLevels, vk::SampleCountFlagBits::e1,
+                vk::Format::eR32Sfloat, vk::ImageTiling::eOptimal,
+                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eStorage,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, depthPyramidImage, depthPyramidMemory,
+                "DepthPyramidMemory");
+    setDebugName(device, depthPyramidImage, "DepthPyramid");
+    // Full mip chain ~ 4/3 of level 0.
+    trackedDepthPyramidBytes = static_cast<vk::DeviceSize>(depthPyramidExtent.width) * depthPyramidExtent.height *
+        4u * 4u / 3u;
+    tracyResourceAlloc(static_cast<VkImage>(*depthPyramidImage), static_cast<size_t>(trackedDepthPyramidBytes),
+                       "GPU/DepthPyramid");
+
+    commandBuffers[0].begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    transitionImageLayout(&commandBuffers[0], depthPyramidImage, depthPyramidLevels, vk::ImageLayout::eUndefined,
+                          vk::ImageLayout::eGeneral,
+                          {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                           .baseMipLevel = 0,
+                           .levelCount = depthPyramidLevels,
+                           .baseArrayLayer = 0,
+                           .layerCount = 1},
+                          VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, vk::PipelineStageFlagBits2::eTopOfPipe,
+                          vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eNone,
+                          vk::AccessFlagBits2::eShaderStorageWrite);
+    endCommandBuffer(commandBuffers[0], graphicsQueue);
+
+    log_info(std::format("Depth pyramid {}x{} levels={} depthResolve={} occlusion={}", depthPyramidExtent.width,
+                         depthPyramidExtent.height, depthPyramidLevels, vk::to_string(depthResolveMode),
+                         hiZOcclusion),
+             "ResourceManager");
+}
+
+vk::ImageViewCreateInfo ResourceManager::depthResolveViewInfo() const
+{
+    return vk::ImageViewCreateInfo{.image = *depthResolveImage,
+                                   .viewType = vk::ImageViewType::e2D,
+                                   .format = depthImageFormat,
+                                   .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eDepth,
+                                                        .baseMipLevel = 0,
+                                                        .levelCount = 1,
+                                                        .baseArrayLayer = 0,
+                                                        .layerCount = 1}};
+}
+
+vk::ImageViewCreateInfo ResourceManager::depthPyramidViewInfo(uint32_t baseLevel, uint32_t levelCount) const
+{
+    return vk::ImageViewCreateInfo{.image = *depthPyramidImage,
+                                   .viewType = vk::ImageViewType::e2D,
+                                   .format = vk::Format::eR32Sfloat,
+                                   .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                        .baseMipLevel = baseLevel,
+                                                        .levelCount = levelCount,
+                                                        .baseArrayLayer = 0,
+                                                        .layerCount = 1}};
 }
 
 bool ResourceManager::hasStencilComponent(vk::Format format)
@@ -1,50 +1,85 @@
 #pragma once
+#include <functional>
 #include <optional>
 #include <string_view>
 #include <vulkan/vulkan_raii.hpp>
 #include "../core/types.hpp"
-    #include "object_storage.hpp"
+#include "geometry_pool.hpp"
+#include "object_storage.hpp"
+#include "upload_batch.hpp"
 #include "vk_allocator.hpp"
 #include "vk_device.hpp"
 #include "scene/vk_camera.hpp"
 #include "Constants.h"
 
 // Manages GPU resources (buffers, images, command pools) using Device + Assets data.
-// Instance ObjectUB data lives in a single host-visible buffer per frame slot (SoA-friendly).
+// Instance ObjectUB data lives in one device-local array; each frame uploads only the changed entities through a
+// per-frame host-visible list that scatter.slang applies before the draws.
 // Geometry is mesh-shader only: vertex SSBO + meshlet tables via BDA (no index buffer).
 class ResourceManager {
 public:
 	ResourceManager(const Device &deviceWrapper,
 			   const VkAllocator &allocator,
-			   const std::vector<Vertex> &vertices,
-			   const std::vector<MeshletDesc>& meshlets,
-			   const std::vector<uint32_t>& meshletVertices,
-			   const std::vector<uint8_t>& meshletTriangles,
-			   ObjectStorage &objectStorage);
+			   GeometryPool &geometryPool,
+			   ObjectStorage &objectStorage,
+			   UploadContext &uploads);
 	~ResourceManager();
 
 	void init();
 	void createSyncObjects();
+    // Fills this frame slot's ObjectUB upload list and InstanceDraw array; runs before the frame is recorded.
     void updateUniformBuffers(uint32_t currentImage);
     void createCommandPool();
 	void createCommandBuffers();
+	// One transient pool + secondary buffer per (frame in flight, record worker) for parallel draw recording.
+	void createSecondaryCommandBuffers(uint32_t workerCount);
 	void createDepthResources();
-	void createVertexBuffer();
-    void createMeshBuffers();
-    // Grow/recreate the per-frame ObjectUB arrays so they fit at least entityCount entries.
+	// Single-sample depth resolve target + Hi-Z pyramid, sized from swapChainExtent (called by createDepthResources).
+	void createDepthPyramid();
+    // Grow/recreate the ObjectUB array and the per-frame instance buffers so they fit at least entityCount entries.
     void ensureInstanceCapacity(uint32_t entityCount);
     void createUniformBuffers();
 	void createColorResources();
-    void recreateObjectsBuffers();
     void createCameraBuffers(Camera& camera);
 	void setSwapChainImageCount(uint32_t count) { swapChainImageCount = count; createSyncObjects(); }
 
+	// ── Streamed geometry uploads (AssetStreamer) ──
+	// Vertices, meshlets, meshlet vertex remap, meshlet triangles.
+	static constexpr uint32_t kGeometryTableCount = 4;
+	// Upload of one mesh's pool ranges, recorded on the upload queue. Tables smaller than the pool's arena
+	// get a grown replacement (old contents copied on the GPU), swapped in by finishGeometryUpload.
+	struct GeometryUpload {
+		std::array<vk::raii::Buffer, kGeometryTableCount> grownBuffers = {nullptr, nullptr, nullptr, nullptr};
+		std::array<VmaAllocation, kGeometryTableCount> grownMemory = {nullptr, nullptr, nullptr, nullptr};
+		std::array<vk::DeviceSize, kGeometryTableCount> grownCapacity = {0, 0, 0, 0};
+		uint64_t timelineValue = 0;
+	};
+	// Fills one mesh's elements of geometry table t (order above) in staging memory, in their device form.
+	using GeometryWriter = std::function<void(uint32_t table, std::byte *destination)>;
+	// Stages `ranges` through `write` in `batch` and records their copies into the device tables. A table
+	// that does not exist yet is created here.
+	void recordGeometryUpload(UploadBatch &batch, const GeometryRanges &ranges, const GeometryWriter &write,
+							  GeometryUpload &upload);
+	// Call once upload.timelineValue is reached on uploads.transfer(): swaps in grown tables.
+	void finishGeometryUpload(GeometryUpload &upload);
+	// Counts a graphics submission and destroys buffers (and returns geometry pool ranges) retired
+	// MAX_FRAMES_IN_FLIGHT submissions ago (the fence waits preceding this submission cover them). Called right
+	// after each frame's submit.
+	void releaseRetiredBuffers();
+
 	// Per-frame Tracy plots for geometry / mesh / entity resource usage.
 	void tracyPlotResources() const;
 
 	[[nodiscard]] vk::raii::ShaderModule createShaderModule(const std::vector<char> &code) const;
 
-    [[nodiscard]] vk::DeviceAddress instanceUboAddress(uint32_t frameSlot, EntityId entityId) const noexcept;
+    [[nodiscard]] vk::DeviceAddress instanceUboAddress(EntityId entityId) const noexcept;
+    // Start of the uint32 entity indices inside instanceUploadBuffers[frame] (after ObjectUB[capacity]).
+    [[nodiscard]] vk::DeviceSize instanceUploadIndexOffset() const noexcept;
+    // Start of the late-pass DrawMeshTasksCommand region inside drawCommandBuffers[frame].
+    [[nodiscard]] vk::DeviceSize lateDrawCommandsOffset() const noexcept;
+    // Heap descriptor views (no VkImageView objects needed in descriptor-heap mode).
+    [[nodiscard]] vk::ImageViewCreateInfo depthResolveViewInfo() const;
+    [[nodiscard]] vk::ImageViewCreateInfo depthPyramidViewInfo(uint32_t baseLevel, uint32_t levelCount) const;
 
 
 	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, vk::SampleCountFlagBits samples,
@@ -53,7 +88,6 @@ public:
 					 std::string_view memoryDebugBaseName = "ResourceImageMemory");
 	vk::raii::ImageView createImageView(vk::raii::Image &image, vk::Format format, vk::ImageAspectFlags aspectFlags,
 										uint32_t mipLevels);
-	void copyBuffer(vk::raii::Buffer &srcBuffer, vk::raii::Buffer &dstBuffer, vk::DeviceSize size);
 	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
 	vk::Format findSupportedFormat(const std::vector<vk::Format> &candidates, vk::ImageTiling tiling,
@@ -76,14 +110,13 @@ static void endCommandBuffer(vk::raii::CommandBuffer &commandBuffer, const vk::r
 	const vk::raii::Queue &transferQueue;
     const HardwareCapabilities hardwareCapabilities;
     ObjectStorage &objectStorage;
+	UploadContext &uploads;
 	uint32_t graphicsIndex;
 	uint32_t transferIndex;
 	vk::SampleCountFlagBits msaaSamples;
 	vk::Extent2D swapChainExtent{};
-	const std::vector<Vertex> &vertices;
-    const std::vector<MeshletDesc> &meshlets;
-    const std::vector<uint32_t> &meshletVertices;
-    const std::vector<uint8_t> &meshletTriangles;
+	// Geometry arena ranges; the device tables below are sized to their capacity.
+	GeometryPool &geometryPool;
 	uint32_t swapChainImageCount = 0;
 	vk::Format swapChainImageFormat = vk::Format::eUndefined;
 
@@ -91,17 +124,37 @@ static void endCommandBuffer(vk::raii::CommandBuffer &commandBuffer, const vk::r
 	std::vector<vk::raii::Semaphore> presentCompleteSemaphore;
 	std::vector<vk::raii::Semaphore> renderFinishedSemaphore;
 	std::vector<vk::raii::Fence> inFlightFences;
+	// Graphics submits wait for uploads.transfer().timeline() at this value: the last geometry upload whose
+	// data draws may reference.
+	uint64_t uploadTimelineReadyValue = 0;
 	vk::raii::Image depthImage = nullptr;
 	VmaAllocation depthImageMemory = nullptr;
 	vk::raii::ImageView depthImageView = nullptr;
+	vk::Format depthImageFormat = vk::Format::eUndefined;
+	// Single-sample depth resolved at the end of the early pass; source of the depth pyramid.
+	vk::raii::Image depthResolveImage = nullptr;
+	VmaAllocation depthResolveImageMemory = nullptr;
+	vk::raii::ImageView depthResolveImageView = nullptr;
+	vk::ResolveModeFlagBits depthResolveMode = vk::ResolveModeFlagBits::eNone;
+	// Hi-Z occlusion needs the farthest sample per pixel (MAX resolve); without it the pyramid is not built and
+	// the late pass culls by frustum only.
+	bool hiZOcclusion = false;
+	// Hi-Z pyramid: R32 farthest depth, previous power of two of the extent, always in GENERAL.
+	static constexpr uint32_t kMaxDepthPyramidLevels = 16;
+	vk::raii::Image depthPyramidImage = nullptr;
+	VmaAllocation depthPyramidMemory = nullptr;
+	vk::Extent2D depthPyramidExtent{};
+	uint32_t depthPyramidLevels = 0;
 	vk::raii::CommandPool commandPool = nullptr;
-	vk::raii::CommandPool transferCommandPool = nullptr;
 	std::vector<vk::raii::CommandBuffer> commandBuffers;
-	std::vector<vk::raii::CommandBuffer> transferCommandBuffer;
+	// Pools are reset whole each frame by the worker that owns them (never shared between threads).
+	struct SecondaryRecordContext {
+		vk::raii::CommandPool pool = nullptr;
+		vk::raii::CommandBuffer commandBuffer = nullptr;
+	};
+	std::array<std::vector<SecondaryRecordContext>, MAX_FRAMES_IN_FLIGHT> secondaryRecordContexts;
 	vk::raii::Buffer vertexBuffer = nullptr;
 	VmaAllocation vertexBufferMemory = nullptr;
-	vk::raii::Buffer stagingBuffer = nullptr;
-	VmaAllocation stagingBufferMemory = nullptr;
 	vk::raii::Image colorImage = nullptr;
 	VmaAllocation colorImageMemory = nullptr;
 	vk::raii::ImageView colorImageView = nullptr;
@@ -124,16 +177,73 @@ static void endCommandBuffer(vk::raii::CommandBuffer &commandBuffer, const vk::r
     vk::DeviceAddress meshletTriangleBufferAddress = 0;
 
 
-    // One ObjectUB[capacity] buffer per frame-in-flight (host-visible).
-    std::array<vk::raii::Buffer, MAX_FRAMES_IN_FLIGHT> instanceUboBuffers = {nullptr, nullptr};
-    std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> instanceUboMemory = {nullptr, nullptr};
-    std::array<void*, MAX_FRAMES_IN_FLIGHT> instanceUboMapped = {nullptr, nullptr};
-    std::array<vk::DeviceAddress, MAX_FRAMES_IN_FLIGHT> instanceUboBaseAddresses = {0, 0};
-    // Allocated instance ObjectUB slots per frame buffer (may be > entity count).
+    // ObjectUB[capacity], device-local. Single copy, frames are serialized on the graphics queue; only
+    // scatter.slang writes it.
+    vk::raii::Buffer instanceUboBuffer = nullptr;
+    VmaAllocation instanceUboMemory = nullptr;
+    vk::DeviceAddress instanceUboBaseAddress = 0;
+    // Upload list per frame-in-flight (host-visible): ObjectUB[capacity], then uint32 entity index[capacity] from
+    // instanceUploadIndexOffset(). The first instanceUploadCounts[frame] entries are this frame's changes.
+    std::array<vk::raii::Buffer, MAX_FRAMES_IN_FLIGHT> instanceUploadBuffers = {nullptr, nullptr};
+    std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> instanceUploadMemory = {nullptr, nullptr};
+    std::array<void*, MAX_FRAMES_IN_FLIGHT> instanceUploadMapped = {nullptr, nullptr};
+    std::array<vk::DeviceAddress, MAX_FRAMES_IN_FLIGHT> instanceUploadAddresses = {0, 0};
+    std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> instanceUploadCounts = {0, 0};
+    // Allocated instance ObjectUB slots (may be > entity count).
     uint32_t instanceCapacity = 0;
 
+    // One InstanceDraw[capacity] buffer per frame-in-flight (host-visible, GPU cull input).
+    std::array<vk::raii::Buffer, MAX_FRAMES_IN_FLIGHT> instanceDrawBuffers = {nullptr, nullptr};
+    std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> instanceDrawMemory = {nullptr, nullptr};
+    std::array<void*, MAX_FRAMES_IN_FLIGHT> instanceDrawMapped = {nullptr, nullptr};
+    std::array<vk::DeviceAddress, MAX_FRAMES_IN_FLIGHT> instanceDrawAddresses = {0, 0};
+
+    // GPU cull output per frame-in-flight (device-local): early/late draw counts at offsets 0/4,
+    // then DrawMeshTasksCommand[capacity] per pass from kDrawCommandsOffset / lateDrawCommandsOffset().
+    static constexpr vk::DeviceSize kDrawCommandsOffset = 16;
+    static constexpr vk::DeviceSize kEarlyDrawCountOffset = 0;
+    static constexpr vk::DeviceSize kLateDrawCountOffset = 4;
+    std::array<vk::raii::Buffer, MAX_FRAMES_IN_FLIGHT> drawCommandBuffers = {nullptr, nullptr};
+    std::array<VmaAllocation, MAX_FRAMES_IN_FLIGHT> drawCommandMemory = {nullptr, nullptr};
+    std::array<vk::DeviceAddress, MAX_FRAMES_IN_FLIGHT> drawCommandAddresses = {0, 0};
+
+    // uint[capacity]: 1 if the entity passed the previous frame's late (Hi-Z) cull. Single device-local copy,
+    // frames are serialized on the graphics queue. The renderer zeroes it while visibilityResetPending is set.
+    // An entity moved by ObjectStorage::destroy inherits the removed one's bit for a frame; either value only
+    // changes which pass draws it (an extra early draw, or a late Hi-Z test), never whether it is drawn.
+    vk::raii::Buffer visibilityBuffer = nullptr;
+    VmaAllocation visibilityMemory = nullptr;
+    vk::DeviceAddress visibilityAddress = 0;
+    bool visibilityResetPending = false;
+
 private:
-    void destroyInstanceUboBuffers();
+    // deferred: hand the buffers to retiredBuffers instead of destroying them (frames may still read them).
+    void destroyInstanceUboBuffers(bool deferred = false);
+    // Destroys buffer now, or once the frames in flight are done with it when deferred.
+    void releaseBuffer(vk::raii::Buffer &buffer, VmaAllocation &memory, const char *tracyName, bool deferred);
+
+    // Device table + CPU arena of one geometry stream, indexed 0..kGeometryTableCount-1.
+    struct GeometryTable {
+        vk::raii::Buffer &buffer;
+        VmaAllocation &memory;
+        vk::DeviceAddress &address;
+        vk::DeviceSize &capacity;
+        vk::DeviceSize arenaBytes;
+        vk::DeviceSize elementSize;
+        const char *debugName;
+        const char *tracyName;
+    };
+    [[nodiscard]] GeometryTable geometryTable(uint32_t table);
+
+    struct RetiredBuffer {
+        VkBuffer buffer;
+        VmaAllocation memory;
+        const char *tracyName;
+        uint64_t releaseFrame;
+    };
+    std::vector<RetiredBuffer> retiredBuffers;
+    uint64_t retireFrameCounter = 0;
+
     // Track last-known sizes for Tracy free/realloc pairing.
     vk::DeviceSize trackedVertexBytes = 0;
     vk::DeviceSize trackedMeshletBytes = 0;
@@ -141,5 +251,11 @@ private:
     vk::DeviceSize trackedMeshletTriangleBytes = 0;
     vk::DeviceSize trackedColorBytes = 0;
     vk::DeviceSize trackedDepthBytes = 0;
-    std::array<vk::DeviceSize, MAX_FRAMES_IN_FLIGHT> trackedInstanceUboBytes = {0, 0};
+    vk::DeviceSize trackedDepthResolveBytes = 0;
+    vk::DeviceSize trackedDepthPyramidBytes = 0;
+    vk::DeviceSize trackedVisibilityBytes = 0;
+    vk::DeviceSize trackedInstanceUboBytes = 0;
+    std::array<vk::DeviceSize, MAX_FRAMES_IN_FLIGHT> trackedInstanceUploadBytes = {0, 0};
+    std::array<vk::DeviceSize, MAX_FRAMES_IN_FLIGHT> trackedInstanceDrawBytes = {0, 0};
+    std::array<vk::DeviceSize, MAX_FRAMES_IN_FLIGHT> trackedDrawCommandBytes = {0, 0};
 };
@@ -8,7 +8,6 @@
 
 // TODO add support for GLTF and KTX2
 // TODO Pipeline cache
-// TODO (createVertexBuffer, createIndexBuffer, createTextureImage) are still using the "single-time command" pattern
 
 void CheckSTL() {
     std::cout << "--------------------------------------------------\n";
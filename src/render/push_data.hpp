@@ -5,11 +5,27 @@
 #include <type_traits>
 #include <vulkan/vulkan.hpp>
 
+// Meshlets handled per task workgroup (matches mesh.slang kGroupSize).
+inline constexpr uint32_t kTaskGroupSize = 32;
+// Instanced direct draws put one entity per workgroup row; these are the spec minimums of
+// maxTaskWorkGroupCount[1] and maxTaskWorkGroupTotalCount, so every EXT_mesh_shader device accepts them.
+inline constexpr uint32_t kMaxTaskGroupCountY = 65535;
+inline constexpr uint32_t kMaxTaskGroupTotalCount = 1u << 22;
+
 struct alignas(8) SlangHandle {
     uint32_t resourceIndex;
     uint32_t samplerIndex;
 };
 
+// MeshPushData::cullFlags / CullPushData::cullFlags bits (mesh.slang, cull.slang).
+inline constexpr uint32_t kMeshCullFlagOcclusion = 1u << 0; // late pass: test against the depth pyramid
+
+// objectUbAddress is the ObjectUB array base; shaders index it with the entity id.
+// drawCommands == 0 selects the direct path (entityId / firstMeshlet / meshletCount / texture; workgroup row y
+// draws entity entityId + y), otherwise the task stage reads DrawMeshTasksCommand[SV_DrawIndex].
+// virtualTextures is this frame's VirtualTextureGlobals (0 = no virtual texturing); textureFeedback is this
+// frame's mip streaming feedback, one biased LOD per texture heap index, ~0u where nothing sampled it (address
+// 0 = no mip streaming).
 struct MeshPushData {
     vk::DeviceAddress cameraAddress;
     vk::DeviceAddress objectUbAddress;
@@ -17,17 +33,73 @@ struct MeshPushData {
     vk::DeviceAddress meshlets;
     vk::DeviceAddress meshletVertices;
     vk::DeviceAddress meshletTriangles;
-    uint32_t firstMeshlet;
-    uint32_t meshletCount;
+    vk::DeviceAddress drawCommands;
     SlangHandle texture;
     SlangHandle samplerHandle;
+    uint32_t entityId;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    uint32_t cullFlags;
+    SlangHandle depthPyramid;
+    SlangHandle depthPyramidSampler;
+    vk::DeviceAddress virtualTextures;
+    vk::DeviceAddress textureFeedback;
+};
+
+// cull.slang runs twice per frame (two-phase occlusion culling).
+enum class CullPhase : uint32_t {
+    Early = 0, // entities visible last frame, frustum test only
+    Late = 1,  // every entity against the depth pyramid; draws the newly visible, rewrites visibility
+};
+
+struct CullPushData {
+    vk::DeviceAddress cameraAddress;
+    vk::DeviceAddress objectUbAddress;
+    vk::DeviceAddress instanceDraws;
+    vk::DeviceAddress drawCommands;
+    vk::DeviceAddress drawCount;
+    vk::DeviceAddress visibility;
+    uint32_t entityCount;
+    CullPhase phase;
+    SlangHandle depthPyramid;
+    SlangHandle depthPyramidSampler;
+    uint32_t cullFlags;
+};
+
+// One dispatch per pyramid level: destination[level] = max-reduced source[sourceLevel].
+struct DepthPyramidPushData {
+    SlangHandle source;
+    SlangHandle destination;
+    SlangHandle reductionSampler;
+    uint32_t destinationWidth;
+    uint32_t destinationHeight;
+    float sourceLevel;
+};
+
+// Threads per depth_pyramid.slang workgroup side (8x8).
+inline constexpr uint32_t kDepthPyramidGroupSize = 8;
+
+// scatter.slang: objects[uploadIndices[i]] = uploads[i] for i < count (the frame's changed ObjectUBs).
+struct ScatterPushData {
+    vk::DeviceAddress uploads;
+    vk::DeviceAddress uploadIndices;
+    vk::DeviceAddress objects;
+    uint32_t count;
 };
 
+// Threads per scatter.slang workgroup; each copies 16 B of one ObjectUB.
+inline constexpr uint32_t kScatterGroupSize = 64;
+// Spec minimum of maxComputeWorkGroupCount[0]; scatter.slang grid-strides past it (full re-uploads after growth).
+inline constexpr uint32_t kScatterMaxGroups = 65535;
+
+// Entities handled per cull workgroup (matches cull.slang kCullGroupSize).
+inline constexpr uint32_t kCullGroupSize = 64;
+
 static_assert(sizeof(SlangHandle) == sizeof(uint32_t) * 2,
               "Descriptor handle push layout must be uint2");
 static_assert(sizeof(SlangHandle) == 8);
 
-// MeshPushData must match shaders/base/mesh.slang MeshPushData (72 bytes).
+// MeshPushData must match shaders/base/mesh.slang MeshPushData (120 bytes).
 static_assert(std::is_trivially_copyable_v<MeshPushData>);
 static_assert(offsetof(MeshPushData, cameraAddress) == 0);
 static_assert(offsetof(MeshPushData, objectUbAddress) == 8);
@@ -35,8 +107,38 @@ static_assert(offsetof(MeshPushData, vertices) == 16);
 static_assert(offsetof(MeshPushData, meshlets) == 24);
 static_assert(offsetof(MeshPushData, meshletVertices) == 32);
 static_assert(offsetof(MeshPushData, meshletTriangles) == 40);
-static_assert(offsetof(MeshPushData, firstMeshlet) == 48);
-static_assert(offsetof(MeshPushData, meshletCount) == 52);
+static_assert(offsetof(MeshPushData, drawCommands) == 48);
 static_assert(offsetof(MeshPushData, texture) == 56);
 static_assert(offsetof(MeshPushData, samplerHandle) == 64);
-static_assert(sizeof(MeshPushData) == 72);
+static_assert(offsetof(MeshPushData, entityId) == 72);
+static_assert(offsetof(MeshPushData, firstMeshlet) == 76);
+static_assert(offsetof(MeshPushData, meshletCount) == 80);
+static_assert(offsetof(MeshPushData, cullFlags) == 84);
+static_assert(offsetof(MeshPushData, depthPyramid) == 88);
+static_assert(offsetof(MeshPushData, depthPyramidSampler) == 96);
+static_assert(offsetof(MeshPushData, virtualTextures) == 104);
+static_assert(offsetof(MeshPushData, textureFeedback) == 112);
+static_assert(sizeof(MeshPushData) == 120);
+
+// CullPushData must match shaders/base/cull.slang CullPushData (76 B + 4 bytes tail padding).
+static_assert(std::is_trivially_copyable_v<CullPushData>);
+static_assert(offsetof(CullPushData, drawCount) == 32);
+static_assert(offsetof(CullPushData, visibility) == 40);
+static_assert(offsetof(CullPushData, entityCount) == 48);
+static_assert(offsetof(CullPushData, phase) == 52);
+static_assert(offsetof(CullPushData, depthPyramid) == 56);
+static_assert(offsetof(CullPushData, depthPyramidSampler) == 64);
+static_assert(offsetof(CullPushData, cullFlags) == 72);
+static_assert(sizeof(CullPushData) == 80);
+
+// ScatterPushData must match shaders/base/scatter.slang (28 B + 4 bytes tail padding).
+static_assert(std::is_trivially_copyable_v<ScatterPushData>);
+static_assert(offsetof(ScatterPushData, objects) == 16);
+static_assert(offsetof(ScatterPushData, count) == 24);
+static_assert(sizeof(ScatterPushData) == 32);
+
+// DepthPyramidPushData must match shaders/base/depth_pyramid.slang (36 bytes + 4 bytes tail padding).
+static_assert(std::is_trivially_copyable_v<DepthPyramidPushData>);
+static_assert(offsetof(DepthPyramidPushData, destinationWidth) == 24);
+static_assert(offsetof(DepthPyramidPushData, sourceLevel) == 32);
+static_assert(sizeof(DepthPyramidPushData) == 40);
@@ -5,6 +5,7 @@
 #include "push_data.hpp"
 
 #include <array>
+#include <format>
 #include <fstream>
 #include <limits>
 #include <stdexcept>
@@ -46,6 +47,9 @@ void Pipeline::init()
 {
     ZoneScopedN("Pipeline::init");
     createMeshPipeline();
+    createCullPipeline();
+    createDepthPyramidPipeline();
+    createScatterPipeline();
 }
 
 void Pipeline::createMeshPipeline()
@@ -56,7 +60,13 @@ void Pipeline::createMeshPipeline()
     vk::raii::ShaderModule shaderModule = resourceManager.createShaderModule(readFile(shaderPath));
     const bool useDescriptorHeaps = descriptorManager.descriptorBindingMode == DescriptorBindingMode::DescriptorHeaps;
 
-    // Mesh-only: no task stage, no vertex input / input assembly.
+    // Task + mesh: the task stage culls meshlets, no vertex input / input assembly.
+    const vk::PipelineShaderStageCreateInfo taskShaderStageInfo{
+        .pNext = nullptr,
+        .stage = vk::ShaderStageFlagBits::eTaskEXT,
+        .module = shaderModule,
+        .pName = "taskMain",
+    };
     const vk::PipelineShaderStageCreateInfo meshShaderStageInfo{
         .pNext = nullptr,
         .stage = vk::ShaderStageFlagBits::eMeshEXT,
@@ -69,7 +79,7 @@ void Pipeline::createMeshPipeline()
         .module = shaderModule,
         .pName = "fragMain",
     };
-    const std::array shaderStages = {meshShaderStageInfo, fragShaderStageInfo};
+    const std::array shaderStages = {taskShaderStageInfo, meshShaderStageInfo, fragShaderStageInfo};
 
     const std::vector dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
     const vk::PipelineDynamicStateCreateInfo dynamicState{
@@ -122,9 +132,10 @@ void Pipeline::createMeshPipeline()
         .stencilTestEnable = vk::False,
     };
 
-    // Must match MeshPushData / mesh.slang (72 B).
+    // Must match MeshPushData / mesh.slang (120 B).
     const vk::PushConstantRange pushDataRange{
-        .stageFlags = vk::ShaderStageFlagBits::eMeshEXT | vk::ShaderStageFlagBits::eFragment,
+        .stageFlags = vk::ShaderStageFlagBits::eTaskEXT | vk::ShaderStageFlagBits::eMeshEXT |
+            vk::ShaderStageFlagBits::eFragment,
         .offset = 0,
         .size = static_cast<uint32_t>(sizeof(MeshPushData)),
     };
@@ -184,3 +195,79 @@ void Pipeline::createMeshPipeline()
     pipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
     setDebugName(device, pipeline, "GraphicsPipeline_Mesh");
 }
+
+void Pipeline::createComputePipeline(std::string_view shaderName, const char* entryPoint, uint32_t pushDataSize,
+                                     vk::raii::PipelineLayout& layout, vk::raii::Pipeline& computePipeline,
+                                     std::string_view debugName)
+{
+    ZoneScopedN("Pipeline::createComputePipeline");
+    const auto shaderDir = std::filesystem::path(ENGINE_SHADER_DIR);
+    const auto shaderPath = (shaderDir / "base" / std::format("{}.spv", shaderName)).string();
+    vk::raii::ShaderModule shaderModule = resourceManager.createShaderModule(readFile(shaderPath));
+    const bool useDescriptorHeaps = descriptorManager.descriptorBindingMode == DescriptorBindingMode::DescriptorHeaps;
+
+    const vk::PipelineShaderStageCreateInfo computeShaderStageInfo{
+        .pNext = nullptr,
+        .stage = vk::ShaderStageFlagBits::eCompute,
+        .module = shaderModule,
+        .pName = entryPoint,
+    };
+
+    const vk::PushConstantRange pushDataRange{
+        .stageFlags = vk::ShaderStageFlagBits::eCompute,
+        .offset = 0,
+        .size = pushDataSize,
+    };
+
+    // Heap mode needs no layout; the legacy path only carries the push range.
+    if (useDescriptorHeaps) {
+        layout = VK_NULL_HANDLE;
+    } else {
+        const vk::PipelineLayoutCreateInfo pipelineLayoutInfo{
+            .setLayoutCount = 0,
+            .pSetLayouts = nullptr,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushDataRange,
+        };
+        layout = vk::raii::PipelineLayout(device, pipelineLayoutInfo);
+    }
+
+    setDebugName(device, shaderModule, std::format("ShaderModule_{}", debugName));
+    setDebugName(device, layout, std::format("PipelineLayout_{}", debugName));
+
+    const vk::PipelineCreateFlags2CreateInfoKHR pipelineFlags2CreateInfo{
+        .flags = vk::PipelineCreateFlagBits2KHR::eDescriptorHeapEXT,
+    };
+
+    const vk::ComputePipelineCreateInfo pipelineInfo{
+        .pNext = useDescriptorHeaps ? &pipelineFlags2CreateInfo : nullptr,
+        .stage = computeShaderStageInfo,
+        .layout = *layout,
+    };
+
+    computePipeline = vk::raii::Pipeline(device, nullptr, pipelineInfo);
+    setDebugName(device, computePipeline, std::format("ComputePipeline_{}", debugName));
+}
+
+void Pipeline::createCullPipeline()
+{
+    ZoneScopedN("Pipeline::createCullPipeline");
+    // Must match CullPushData / cull.slang (80 B).
+    createComputePipeline("cull", "cullMain", sizeof(CullPushData), cullPipelineLayout, cullPipeline, "Cull");
+}
+
+void Pipeline::createDepthPyramidPipeline()
+{
+    ZoneScopedN("Pipeline::createDepthPyramidPipeline");
+    // Must match DepthPyramidPushData / depth_pyramid.slang (40 B).
+    createComputePipeline("depth_pyramid", "depthPyramidMain", sizeof(DepthPyramidPushData),
+                          depthPyramidPipelineLayout, depthPyramidPipeline, "DepthPyramid");
+}
+
+void Pipeline::createScatterPipeline()
+{
+    ZoneScopedN("Pipeline::createScatterPipeline");
+    // Must match ScatterPushData / scatter.slang (32 B).
+    createComputePipeline("scatter", "scatterMain", sizeof(ScatterPushData), scatterPipelineLayout, scatterPipeline,
+                          "Scatter");
+}
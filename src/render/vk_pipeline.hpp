@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <string_view>
 #include <vulkan/vulkan_raii.hpp>
 #include "../core/types.hpp"
 #include "../core/vk_resource_manager.hpp"
@@ -16,6 +17,12 @@ public:
 
     void init();
     void createMeshPipeline();
+    // GPU instance culling (cull.slang): writes indirect mesh-task commands + draw count.
+    void createCullPipeline();
+    // Hi-Z pyramid reduction (depth_pyramid.slang), one dispatch per level.
+    void createDepthPyramidPipeline();
+    // Instance delta upload (scatter.slang): copies the frame's changed ObjectUBs into the device array.
+    void createScatterPipeline();
 
     const vk::raii::Device& device;
     const vk::Extent2D& swapChainExtent;
@@ -24,4 +31,16 @@ public:
     DescriptorManager& descriptorManager;
     vk::raii::PipelineLayout pipelineLayout = nullptr;
     vk::raii::Pipeline pipeline = nullptr;
+    vk::raii::PipelineLayout cullPipelineLayout = nullptr;
+    vk::raii::Pipeline cullPipeline = nullptr;
+    vk::raii::PipelineLayout depthPyramidPipelineLayout = nullptr;
+    vk::raii::Pipeline depthPyramidPipeline = nullptr;
+    vk::raii::PipelineLayout scatterPipelineLayout = nullptr;
+    vk::raii::Pipeline scatterPipeline = nullptr;
+
+private:
+    // Compute pipeline from shaders/base/<shaderName>.spv; push-only layout in legacy mode, none with heaps.
+    void createComputePipeline(std::string_view shaderName, const char* entryPoint, uint32_t pushDataSize,
+                               vk::raii::PipelineLayout& layout, vk::raii::Pipeline& computePipeline,
+                               std::string_view debugName);
 };
@@ -1,6 +1,7 @@
 #include "vk_renderer.hpp"
 #include "push_data.hpp"
 #include "../Constants.h"
+#include "../util/jobs.hpp"
 #include "../util/vk_tracy.hpp"
 #include "../util/vk_utils.hpp"
 #if ENGINE_ENABLE_IMGUI
@@ -8,6 +9,8 @@
 #include "imgui_impl_vulkan.h"
 #endif
 
+#include <algorithm>
+#include <array>
 #include <format>
 
 Renderer::Renderer(Device& device, SwapChain& swapChain, ResourceManager& resourceManager,
@@ -16,6 +19,8 @@ Renderer::Renderer(Device& device, SwapChain& swapChain, ResourceManager& resour
     device(device), swapChain(swapChain), resourceManager(resourceManager), descriptorManager(descriptorManager),
     pipeline(pipeline), tracyContext(tracyContext), imguiEnabled(imguiEnabled), camera(camera)
 {
+    // Depth resolve + pyramid (all levels) + one storage slot per level; rewritten on every resize.
+    depthPyramidDescriptorBase = descriptorManager.reserveImageDescriptors(kDepthPyramidDescriptorCount);
 }
 
 void Renderer::setTracyContext(VkTracyContext* tracyContextIn) { tracyContext = tracyContextIn; }
@@ -28,6 +33,7 @@ void Renderer::rebuildSwapchainResources() const
     resourceManager.setSwapChainImageCount(static_cast<uint32_t>(swapChain.swapChainImages.size()));
     resourceManager.createColorResources();
     resourceManager.createDepthResources();
+    writeDepthPyramidDescriptors();
     // Aspect / render-target size changed (resize and out-of-date paths).
     camera.setFov(camera.getFovDegrees());
     TracyPlot("Vulkan/SwapchainWidth", static_cast<double>(swapChain.swapChainExtent.width));
@@ -35,6 +41,26 @@ void Renderer::rebuildSwapchainResources() const
     TracyPlot("Vulkan/SwapchainImagesInUse", static_cast<double>(swapChain.swapChainImages.size()));
 }
 
+void Renderer::writeDepthPyramidDescriptors() const
+{
+    ZoneScopedN("Renderer::writeDepthPyramidDescriptors");
+    if (!resourceManager.depthPyramidImage) {
+        return;
+    }
+
+    descriptorManager.writeImageDescriptorAt(depthResolveDescriptorIndex(), resourceManager.depthResolveViewInfo(),
+                                             vk::DescriptorType::eSampledImage,
+                                             vk::ImageLayout::eShaderReadOnlyOptimal);
+    descriptorManager.writeImageDescriptorAt(depthPyramidDescriptorIndex(),
+                                             resourceManager.depthPyramidViewInfo(0, resourceManager.depthPyramidLevels),
+                                             vk::DescriptorType::eSampledImage, vk::ImageLayout::eGeneral);
+    for (uint32_t level = 0; level < resourceManager.depthPyramidLevels; ++level) {
+        descriptorManager.writeImageDescriptorAt(depthPyramidLevelDescriptorIndex(level),
+                                                 resourceManager.depthPyramidViewInfo(level, 1),
+                                                 vk::DescriptorType::eStorageImage, vk::ImageLayout::eGeneral);
+    }
+}
+
 void Renderer::drawFrame()
 {
     ZoneScopedN("Renderer::drawFrame");
@@ -75,6 +101,23 @@ void Renderer::drawFrame()
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
+    {
+        ZoneScopedN("SelectMeshLods");
+        selectMeshLods(resourceManager.objectStorage, camera.cameraData);
+    }
+    if (textureManager) {
+        // This slot's fence has signalled: its feedback is complete and its page table is free to rewrite.
+        // Swapped mips remap entity materials, so this runs before the frame's object data is written.
+        ZoneScopedN("TextureStreaming");
+        textureManager->beginFrame(currentFrame, resourceManager.objectStorage);
+    }
+
+    {
+        // Fills this slot's upload list, which the scatter pass recorded below reads.
+        ZoneScopedN("UpdateUBO");
+        resourceManager.updateUniformBuffers(currentFrame);
+    }
+
     deviceRef.resetFences(fence);
     commandBuffer.reset();
     {
@@ -82,8 +125,16 @@ void Renderer::drawFrame()
         recordCommandBuffer(imageIndex);
     }
 
-    vk::SemaphoreSubmitInfo waitSemaphoreInfo = {.semaphore = presentSemaphore,
-                                                 .stageMask = vk::PipelineStageFlagBits2::eTopOfPipe};
+    // Geometry uploads: streamed ones were host-observed before their entity was created, the startup batch
+    // may still be in flight for the first frame. The wait orders it and makes the copies visible.
+    const std::array waitSemaphoreInfos{
+        vk::SemaphoreSubmitInfo{.semaphore = presentSemaphore, .stageMask = vk::PipelineStageFlagBits2::eTopOfPipe},
+        vk::SemaphoreSubmitInfo{.semaphore = *resourceManager.uploads.transfer().timeline(),
+                                .value = resourceManager.uploadTimelineReadyValue,
+                                .stageMask = vk::PipelineStageFlagBits2::eComputeShader |
+                                    vk::PipelineStageFlagBits2::eTaskShaderEXT |
+                                    vk::PipelineStageFlagBits2::eMeshShaderEXT},
+    };
 
     vk::CommandBufferSubmitInfo commandBufferInfo = {.commandBuffer = *commandBuffer};
 
@@ -91,13 +142,8 @@ void Renderer::drawFrame()
     vk::SemaphoreSubmitInfo signalSemaphoreInfo = {.semaphore = renderSemaphore,
                                                    .stageMask = vk::PipelineStageFlagBits2::eBottomOfPipe};
 
-    {
-        ZoneScopedN("UpdateUBO");
-        resourceManager.updateUniformBuffers(currentFrame);
-    }
-
-    const vk::SubmitInfo2 submitInfo{.waitSemaphoreInfoCount = 1,
-                                     .pWaitSemaphoreInfos = &waitSemaphoreInfo,
+    const vk::SubmitInfo2 submitInfo{.waitSemaphoreInfoCount = static_cast<uint32_t>(waitSemaphoreInfos.size()),
+                                     .pWaitSemaphoreInfos = waitSemaphoreInfos.data(),
                                      .commandBufferInfoCount = 1,
                                      .pCommandBufferInfos = &commandBufferInfo,
                                      .signalSemaphoreInfoCount = 1,
@@ -106,6 +152,7 @@ void Renderer::drawFrame()
         ZoneScopedN("QueueSubmit");
         graphicsQueue.submit2(submitInfo, fence);
     }
+    resourceManager.releaseRetiredBuffers();
 
     const vk::PresentInfoKHR presentInfoKHR{.waitSemaphoreCount = 1,
                                             .pWaitSemaphores = &renderSemaphore,
@@ -178,73 +225,110 @@ void Renderer::recordCommandBuffer(uint32_t imageIndex)
                                        .pColorAttachments = &colorAttachmentInfo,
                                        .pDepthAttachment = &depthAttachmentInfo};
 
+    // Heaps are bound once per command buffer and shared by the compute and graphics bind points.
+    cmd.bindResourceHeapEXT(descriptorManager.resourceHeapInfo);
+    cmd.bindSamplerHeapEXT(descriptorManager.samplerHeapInfo);
+
     {
-        ZoneScopedN("DrawCalls");
+        ZoneScopedN("InstanceScatter");
 #ifdef TRACY_ENABLE
-        TracyVkNamedZone(gpuCtx, gpuZoneDrawCalls, *cmd, "GPU_DrawCalls", gpuTrace);
+        TracyVkNamedZone(gpuCtx, gpuZoneInstanceScatter, *cmd, "GPU_InstanceScatter", gpuTrace);
 #endif
-        cmd.beginRendering(renderingInfo);
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline.pipeline);
-
-        cmd.setViewport(
-            0,
-            vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChain.swapChainExtent.width),
-                         static_cast<float>(swapChain.swapChainExtent.height), 0.0f, 1.0f));
-        cmd.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChain.swapChainExtent));
+        recordInstanceScatter(cmd);
+    }
 
-        const auto& resourceHeapInfo = descriptorManager.resourceHeapInfo;
-        const auto& samplerHeapInfo = descriptorManager.samplerHeapInfo;
-        cmd.bindResourceHeapEXT(resourceHeapInfo);
-        cmd.bindSamplerHeapEXT(samplerHeapInfo);
+#if ENGINE_GPU_DRIVEN_DRAWS
+    // ── Two-phase occlusion culling ──────────────────────────────
+    // Early: redraw what was visible last frame, keep its depth. Build the Hi-Z pyramid from it.
+    // Late (the DrawCalls block below): everything else that survives the pyramid test.
+    {
+        ZoneScopedN("EarlyCullPass");
+#ifdef TRACY_ENABLE
+        TracyVkNamedZone(gpuCtx, gpuZoneEarlyCull, *cmd, "GPU_EarlyCull", gpuTrace);
+#endif
+        recordCullPass(cmd, CullPhase::Early);
+    }
+    {
+        ZoneScopedN("EarlyDrawCalls");
+#ifdef TRACY_ENABLE
+        TracyVkNamedZone(gpuCtx, gpuZoneEarlyDrawCalls, *cmd, "GPU_EarlyDrawCalls", gpuTrace);
+#endif
+        vk::ImageAspectFlags depthAspects = vk::ImageAspectFlagBits::eDepth;
+        if (ResourceManager::hasStencilComponent(resourceManager.depthImageFormat)) {
+            depthAspects |= vk::ImageAspectFlagBits::eStencil;
+        }
+        // Previous frame's pyramid build finished reading the resolve target; contents are discarded.
+        transitionImageLayout(&cmd, resourceManager.depthResolveImage, 1, vk::ImageLayout::eUndefined,
+                              vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                              {.aspectMask = depthAspects,
+                               .baseMipLevel = 0,
+                               .levelCount = 1,
+                               .baseArrayLayer = 0,
+                               .layerCount = 1},
+                              VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                              vk::PipelineStageFlagBits2::eComputeShader,
+                              vk::PipelineStageFlagBits2::eLateFragmentTests |
+                                  vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                              vk::AccessFlagBits2::eNone,
+                              vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+                                  vk::AccessFlagBits2::eColorAttachmentWrite);
+
+        // Keep MSAA color/depth for the late pass; resolve only depth (pyramid source, none without MAX resolve).
+        vk::RenderingAttachmentInfo earlyColorAttachmentInfo = colorAttachmentInfo;
+        earlyColorAttachmentInfo.resolveMode = vk::ResolveModeFlagBits::eNone;
+        earlyColorAttachmentInfo.resolveImageView = nullptr;
+        earlyColorAttachmentInfo.resolveImageLayout = vk::ImageLayout::eUndefined;
+        vk::RenderingAttachmentInfo earlyDepthAttachmentInfo = depthAttachmentInfo;
+        earlyDepthAttachmentInfo.storeOp = vk::AttachmentStoreOp::eStore;
+        earlyDepthAttachmentInfo.resolveMode = resourceManager.depthResolveMode;
+        earlyDepthAttachmentInfo.resolveImageView = resourceManager.depthResolveImageView;
+        earlyDepthAttachmentInfo.resolveImageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        vk::RenderingInfo earlyRenderingInfo = renderingInfo;
+        earlyRenderingInfo.pColorAttachments = &earlyColorAttachmentInfo;
+        earlyRenderingInfo.pDepthAttachment = &earlyDepthAttachmentInfo;
+
+        cmd.beginRendering(earlyRenderingInfo);
+        bindMeshPipeline(cmd);
+        recordIndirectDraws(cmd, CullPhase::Early);
+        cmd.endRendering();
+    }
+    {
+        ZoneScopedN("DepthPyramid");
+#ifdef TRACY_ENABLE
+        TracyVkNamedZone(gpuCtx, gpuZoneDepthPyramid, *cmd, "GPU_DepthPyramid", gpuTrace);
+#endif
+        recordDepthPyramid(cmd);
+    }
+    {
+        ZoneScopedN("LateCullPass");
+#ifdef TRACY_ENABLE
+        TracyVkNamedZone(gpuCtx, gpuZoneLateCull, *cmd, "GPU_LateCull", gpuTrace);
+#endif
+        recordCullPass(cmd, CullPhase::Late);
+    }
 
-        const auto& storage = resourceManager.objectStorage;
-        const uint32_t entityCount = storage.size();
+    // The late pass continues on top of the early results.
+    colorAttachmentInfo.loadOp = vk::AttachmentLoadOp::eLoad;
+    depthAttachmentInfo.loadOp = vk::AttachmentLoadOp::eLoad;
+#endif
 
-        for (EntityId id = 0; id < entityCount; ++id)
-        {
-            if ((storage.flags[id] & EntityFlag::Active) == 0)
-            {
-                continue;
-            }
-
-            const MeshletDraw& meshletDraw = storage.meshletDraws[id];
-            if (meshletDraw.meshletCount == 0
-                || resourceManager.vertexBufferAddress == 0
-                || resourceManager.meshletBufferAddress == 0
-                || resourceManager.meshletVertexBufferAddress == 0
-                || resourceManager.meshletTriangleBufferAddress == 0)
-            {
-                continue;
-            }
-
-            MeshPushData pushData{};
-            pushData.cameraAddress = camera.cameraBufferAddresses[currentFrame];
-            pushData.objectUbAddress = resourceManager.instanceUboAddress(currentFrame, id);
-            pushData.vertices = resourceManager.vertexBufferAddress;
-            pushData.meshlets = resourceManager.meshletBufferAddress;
-            pushData.meshletVertices = resourceManager.meshletVertexBufferAddress;
-            pushData.meshletTriangles = resourceManager.meshletTriangleBufferAddress;
-            pushData.firstMeshlet = meshletDraw.firstMeshlet;
-            pushData.meshletCount = meshletDraw.meshletCount;
-            pushData.texture = {
-                .resourceIndex = storage.materials[id].textureIndex,
-                .samplerIndex = 0,
-            };
-            pushData.samplerHandle = {
-                .resourceIndex = descriptorManager.getSamplerDescriptorIndex(),
-                .samplerIndex = 0,
-            };
-
-            const vk::PushDataInfoEXT pushDataInfo = {
-                .sType = vk::StructureType::ePushDataInfoEXT,
-                .pNext = nullptr,
-                .offset = 0,
-                .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(MeshPushData)}};
-            cmd.pushDataEXT(pushDataInfo);
-
-            // One workgroup per meshlet (matches mesh.slang SV_GroupID usage).
-            cmd.drawMeshTasksEXT(meshletDraw.meshletCount, 1, 1);
-        }
+    {
+        ZoneScopedN("DrawCalls");
+#ifdef TRACY_ENABLE
+        TracyVkNamedZone(gpuCtx, gpuZoneDrawCalls, *cmd, "GPU_DrawCalls", gpuTrace);
+#endif
+#if ENGINE_GPU_DRIVEN_DRAWS
+        cmd.beginRendering(renderingInfo);
+        bindMeshPipeline(cmd);
+        recordIndirectDraws(cmd, CullPhase::Late);
+#else
+        // Entity draws arrive as worker-recorded secondaries; ImGui still records inline (maintenance7).
+        renderingInfo.flags =
+            vk::RenderingFlagBits::eContentsSecondaryCommandBuffers | vk::RenderingFlagBits::eContentsInlineKHR;
+        cmd.beginRendering(renderingInfo);
+        recordEntityDrawsParallel(cmd);
+#endif
     }
 
 #if ENGINE_ENABLE_IMGUI
@@ -271,6 +355,9 @@ void Renderer::recordCommandBuffer(uint32_t imageIndex)
             VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, vk::PipelineStageFlagBits2::eColorAttachmentOutput,
             vk::PipelineStageFlagBits2::eBottomOfPipe, vk::AccessFlagBits2::eColorAttachmentWrite, {});
     }
+    if (textureManager) {
+        textureManager->recordFeedbackBarrier(cmd);
+    }
 
     if (tracyContext) {
         ZoneScopedN("TracyVkCollect");
@@ -280,4 +367,423 @@ void Renderer::recordCommandBuffer(uint32_t imageIndex)
     cmd.end();
 }
 
+MeshPushData Renderer::makeMeshPushData() const
+{
+    MeshPushData pushData{};
+    pushData.cameraAddress = camera.cameraBufferAddresses[currentFrame];
+    pushData.objectUbAddress = resourceManager.instanceUboBaseAddress;
+    pushData.vertices = resourceManager.vertexBufferAddress;
+    pushData.meshlets = resourceManager.meshletBufferAddress;
+    pushData.meshletVertices = resourceManager.meshletVertexBufferAddress;
+    pushData.meshletTriangles = resourceManager.meshletTriangleBufferAddress;
+    pushData.samplerHandle = {
+        .resourceIndex = descriptorManager.getSamplerDescriptorIndex(),
+        .samplerIndex = 0,
+    };
+    const VirtualTextureCache* virtualTextures = textureManager ? textureManager->virtualTextures.get() : nullptr;
+    pushData.virtualTextures = virtualTextures ? virtualTextures->frameAddress(currentFrame) : 0;
+    pushData.textureFeedback = textureManager ? textureManager->feedbackAddress(currentFrame) : 0;
+    return pushData;
+}
+
+bool Renderer::meshBuffersReady() const
+{
+    return resourceManager.vertexBufferAddress != 0 && resourceManager.meshletBufferAddress != 0 &&
+        resourceManager.meshletVertexBufferAddress != 0 && resourceManager.meshletTriangleBufferAddress != 0;
+}
+
+void Renderer::bindMeshPipeline(vk::raii::CommandBuffer& cmd) const
+{
+    cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, *pipeline.pipeline);
+    cmd.setViewport(0,
+                    vk::Viewport(0.0f, 0.0f, static_cast<float>(swapChain.swapChainExtent.width),
+                                 static_cast<float>(swapChain.swapChainExtent.height), 0.0f, 1.0f));
+    cmd.setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), swapChain.swapChainExtent));
+}
+
+SlangHandle Renderer::depthPyramidHandle() const
+{
+    return {.resourceIndex = depthPyramidDescriptorIndex(), .samplerIndex = 0};
+}
+
+SlangHandle Renderer::depthPyramidSamplerHandle() const
+{
+    return {.resourceIndex = descriptorManager.getDepthPyramidSamplerIndex(), .samplerIndex = 0};
+}
+
+void Renderer::recordInstanceScatter(vk::raii::CommandBuffer& cmd)
+{
+    ZoneScopedN("Renderer::recordInstanceScatter");
+    const uint32_t uploadCount = resourceManager.instanceUploadCounts[currentFrame];
+    if (uploadCount == 0 || !resourceManager.instanceUboBuffer) {
+        return;
+    }
+
+    // The ObjectUB array is shared by all frames: the previous frame's reads must finish before it is rewritten.
+    const vk::MemoryBarrier2 readBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eTaskShaderEXT | vk::PipelineStageFlagBits2::eMeshShaderEXT |
+            vk::PipelineStageFlagBits2::eFragmentShader | vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eNone,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+    };
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &readBarrier});
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline.scatterPipeline);
+
+    const vk::DeviceAddress uploadBase = resourceManager.instanceUploadAddresses[currentFrame];
+    const ScatterPushData pushData{
+        .uploads = uploadBase,
+        .uploadIndices = uploadBase + resourceManager.instanceUploadIndexOffset(),
+        .objects = resourceManager.instanceUboBaseAddress,
+        .count = uploadCount,
+    };
+    const vk::PushDataInfoEXT pushDataInfo = {
+        .sType = vk::StructureType::ePushDataInfoEXT,
+        .pNext = nullptr,
+        .offset = 0,
+        .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(ScatterPushData)}};
+    cmd.pushDataEXT(pushDataInfo);
+
+    constexpr uint32_t kObjectUbWords = sizeof(ObjectUB) / 16;
+    const uint32_t groupCount = (uploadCount * kObjectUbWords + kScatterGroupSize - 1) / kScatterGroupSize;
+    cmd.dispatch(std::min(groupCount, kScatterMaxGroups), 1, 1);
+
+    // Cull reads bounds and LODs from compute; task/mesh/fragment read the rest.
+    const vk::MemoryBarrier2 scatterBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eTaskShaderEXT |
+            vk::PipelineStageFlagBits2::eMeshShaderEXT | vk::PipelineStageFlagBits2::eFragmentShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+    };
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &scatterBarrier});
+}
+
+void Renderer::recordCullPass(vk::raii::CommandBuffer& cmd, CullPhase phase)
+{
+    ZoneScopedN("Renderer::recordCullPass");
+    const uint32_t entityCount = resourceManager.objectStorage.size();
+    const vk::Buffer drawCommandBuffer = *resourceManager.drawCommandBuffers[currentFrame];
+    if (entityCount == 0 || !drawCommandBuffer || !resourceManager.visibilityBuffer) {
+        return;
+    }
+
+    if (phase == CullPhase::Early) {
+        // Reset both draw counts (and visibility after a capacity change), then make them visible to
+        // the cull dispatch. The previous frame's late pass wrote visibility from the compute stage.
+        cmd.fillBuffer(drawCommandBuffer, 0, 2 * sizeof(uint32_t), 0);
+        if (resourceManager.visibilityResetPending) {
+            cmd.fillBuffer(*resourceManager.visibilityBuffer, 0, vk::WholeSize, 0);
+            resourceManager.visibilityResetPending = false;
+        }
+        const vk::MemoryBarrier2 clearBarrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eClear | vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+        };
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &clearBarrier});
+    }
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline.cullPipeline);
+
+    const bool latePass = phase == CullPhase::Late;
+    const vk::DeviceAddress commandBase = resourceManager.drawCommandAddresses[currentFrame];
+    const CullPushData pushData{
+        .cameraAddress = camera.cameraBufferAddresses[currentFrame],
+        .objectUbAddress = resourceManager.instanceUboBaseAddress,
+        .instanceDraws = resourceManager.instanceDrawAddresses[currentFrame],
+        .drawCommands = commandBase +
+            (latePass ? resourceManager.lateDrawCommandsOffset() : ResourceManager::kDrawCommandsOffset),
+        .drawCount = commandBase +
+            (latePass ? ResourceManager::kLateDrawCountOffset : ResourceManager::kEarlyDrawCountOffset),
+        .visibility = resourceManager.visibilityAddress,
+        .entityCount = entityCount,
+        .phase = phase,
+        .depthPyramid = depthPyramidHandle(),
+        .depthPyramidSampler = depthPyramidSamplerHandle(),
+        .cullFlags = latePass && resourceManager.hiZOcclusion ? kMeshCullFlagOcclusion : 0u,
+    };
+    const vk::PushDataInfoEXT pushDataInfo = {
+        .sType = vk::StructureType::ePushDataInfoEXT,
+        .pNext = nullptr,
+        .offset = 0,
+        .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(CullPushData)}};
+    cmd.pushDataEXT(pushDataInfo);
+
+    cmd.dispatch((entityCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+    // Commands + count feed the indirect draw; the task/fragment stages read the records back.
+    const vk::MemoryBarrier2 cullBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eTaskShaderEXT |
+            vk::PipelineStageFlagBits2::eFragmentShader,
+        .dstAccessMask = vk::AccessFlagBits2::eIndirectCommandRead | vk::AccessFlagBits2::eShaderStorageRead,
+    };
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &cullBarrier});
+}
+
+void Renderer::recordDepthPyramid(vk::raii::CommandBuffer& cmd)
+{
+    ZoneScopedN("Renderer::recordDepthPyramid");
+    const uint32_t levelCount = resourceManager.depthPyramidLevels;
+    if (levelCount == 0) {
+        return;
+    }
+
+    vk::ImageAspectFlags depthAspects = vk::ImageAspectFlagBits::eDepth;
+    if (ResourceManager::hasStencilComponent(resourceManager.depthImageFormat)) {
+        depthAspects |= vk::ImageAspectFlagBits::eStencil;
+    }
+
+    // Early-pass attachments are reloaded by the late pass; the resolved depth becomes the pyramid
+    // source; the pyramid itself was last read by the previous frame's late cull + task stage.
+    const vk::MemoryBarrier2 attachmentBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eLateFragmentTests |
+            vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+        .srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+            vk::AccessFlagBits2::eColorAttachmentWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+            vk::PipelineStageFlagBits2::eLateFragmentTests | vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+        .dstAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+            vk::AccessFlagBits2::eDepthStencilAttachmentWrite | vk::AccessFlagBits2::eColorAttachmentRead |
+            vk::AccessFlagBits2::eColorAttachmentWrite,
+    };
+    const std::array imageBarriers = {
+        vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eLateFragmentTests |
+                vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+            .srcAccessMask = vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+                vk::AccessFlagBits2::eColorAttachmentWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+            .oldLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = *resourceManager.depthResolveImage,
+            .subresourceRange = {.aspectMask = depthAspects,
+                                 .baseMipLevel = 0,
+                                 .levelCount = 1,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = 1},
+        },
+        vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eTaskShaderEXT,
+            .srcAccessMask = vk::AccessFlagBits2::eNone,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .oldLayout = vk::ImageLayout::eGeneral,
+            .newLayout = vk::ImageLayout::eGeneral,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = *resourceManager.depthPyramidImage,
+            .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                 .baseMipLevel = 0,
+                                 .levelCount = levelCount,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = 1},
+        },
+    };
+    if (!resourceManager.hiZOcclusion) {
+        // No conservative resolve, so no pyramid; the late pass still has to see the early attachments.
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &attachmentBarrier});
+        return;
+    }
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1,
+                                            .pMemoryBarriers = &attachmentBarrier,
+                                            .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+                                            .pImageMemoryBarriers = imageBarriers.data()});
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline.depthPyramidPipeline);
+
+    // Level N reads level N-1 through the full-chain view while writing its own storage view.
+    const vk::MemoryBarrier2 levelBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+    };
+    const vk::Extent2D baseExtent = resourceManager.depthPyramidExtent;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        const uint32_t width = std::max(baseExtent.width >> level, 1u);
+        const uint32_t height = std::max(baseExtent.height >> level, 1u);
+        const DepthPyramidPushData pushData{
+            .source = level == 0 ? SlangHandle{.resourceIndex = depthResolveDescriptorIndex(), .samplerIndex = 0}
+                                 : depthPyramidHandle(),
+            .destination = {.resourceIndex = depthPyramidLevelDescriptorIndex(level), .samplerIndex = 0},
+            .reductionSampler = depthPyramidSamplerHandle(),
+            .destinationWidth = width,
+            .destinationHeight = height,
+            .sourceLevel = level == 0 ? 0.0f : static_cast<float>(level - 1),
+        };
+        const vk::PushDataInfoEXT pushDataInfo = {
+            .sType = vk::StructureType::ePushDataInfoEXT,
+            .pNext = nullptr,
+            .offset = 0,
+            .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(DepthPyramidPushData)}};
+        cmd.pushDataEXT(pushDataInfo);
+
+        cmd.dispatch((width + kDepthPyramidGroupSize - 1) / kDepthPyramidGroupSize,
+                     (height + kDepthPyramidGroupSize - 1) / kDepthPyramidGroupSize, 1);
+        cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &levelBarrier});
+    }
+
+    // Finished pyramid is sampled by the late cull dispatch and the late task stage.
+    const vk::MemoryBarrier2 pyramidBarrier{
+        .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader | vk::PipelineStageFlagBits2::eTaskShaderEXT,
+        .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+    };
+    cmd.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &pyramidBarrier});
+}
+
+void Renderer::recordIndirectDraws(vk::raii::CommandBuffer& cmd, CullPhase phase)
+{
+    ZoneScopedN("Renderer::recordIndirectDraws");
+    const uint32_t entityCount = resourceManager.objectStorage.size();
+    const vk::Buffer drawCommandBuffer = *resourceManager.drawCommandBuffers[currentFrame];
+    if (entityCount == 0 || !drawCommandBuffer || !meshBuffersReady()) {
+        return;
+    }
+
+    const bool latePass = phase == CullPhase::Late;
+    const vk::DeviceSize commandsOffset =
+        latePass ? resourceManager.lateDrawCommandsOffset() : ResourceManager::kDrawCommandsOffset;
+    const vk::DeviceSize countOffset =
+        latePass ? ResourceManager::kLateDrawCountOffset : ResourceManager::kEarlyDrawCountOffset;
+
+    MeshPushData pushData = makeMeshPushData();
+    pushData.drawCommands = resourceManager.drawCommandAddresses[currentFrame] + commandsOffset;
+    if (latePass && resourceManager.hiZOcclusion) {
+        pushData.cullFlags = kMeshCullFlagOcclusion;
+        pushData.depthPyramid = depthPyramidHandle();
+        pushData.depthPyramidSampler = depthPyramidSamplerHandle();
+    }
+
+    const vk::PushDataInfoEXT pushDataInfo = {
+        .sType = vk::StructureType::ePushDataInfoEXT,
+        .pNext = nullptr,
+        .offset = 0,
+        .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(MeshPushData)}};
+    cmd.pushDataEXT(pushDataInfo);
+
+    // One call per phase: the cull pass wrote up to entityCount commands and this phase's count.
+    cmd.drawMeshTasksIndirectCountEXT(drawCommandBuffer, commandsOffset, drawCommandBuffer, countOffset, entityCount,
+                                      sizeof(DrawMeshTasksCommand));
+}
+
+void Renderer::recordEntityDrawsParallel(vk::raii::CommandBuffer& cmd)
+{
+    ZoneScopedN("Renderer::recordEntityDrawsParallel");
+    auto& contexts = resourceManager.secondaryRecordContexts[currentFrame];
+    const uint32_t entityCount = resourceManager.objectStorage.size();
+    if (entityCount == 0 || contexts.empty() || !meshBuffersReady()) {
+        return;
+    }
+
+    // Small scenes stay on fewer workers; each chunk is a contiguous entity range.
+    const uint32_t chunkCount = std::min(static_cast<uint32_t>(contexts.size()),
+                                         (entityCount + kMinEntitiesPerRecordChunk - 1) / kMinEntitiesPerRecordChunk);
+    const uint32_t chunkSize = (entityCount + chunkCount - 1) / chunkCount;
+
+    // Secondaries inherit the attachment formats of the dynamic rendering instance they run in.
+    const vk::Format colorFormat = swapChain.swapChainImageFormat;
+    const vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat,
+        .depthAttachmentFormat = resourceManager.depthImageFormat,
+        .rasterizationSamples = resourceManager.msaaSamples,
+    };
+    const vk::CommandBufferInheritanceInfo inheritanceInfo{.pNext = &inheritanceRenderingInfo};
+
+    tf::Taskflow taskflow("RecordEntityDraws");
+    for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+        taskflow.emplace([&, chunk] {
+            ZoneScopedN("RecordEntityDrawsChunk");
+            auto& context = contexts[chunk];
+            // This frame's fence was waited on, so nothing recorded from the pool is still executing.
+            context.pool.reset();
+
+            auto& secondary = context.commandBuffer;
+            secondary.begin({.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue |
+                                 vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+                             .pInheritanceInfo = &inheritanceInfo});
+            // Heap bindings, pipeline and dynamic state are not inherited from the primary.
+            secondary.bindResourceHeapEXT(descriptorManager.resourceHeapInfo);
+            secondary.bindSamplerHeapEXT(descriptorManager.samplerHeapInfo);
+            bindMeshPipeline(secondary);
+
+            const EntityId first = chunk * chunkSize;
+            recordEntityDraws(secondary, first, std::min(first + chunkSize, entityCount));
+            secondary.end();
+        });
+    }
+    {
+        ZoneScopedN("RecordEntityDrawsWait");
+        runAndWait(taskflow);
+    }
+
+    std::vector<vk::CommandBuffer> secondaries;
+    secondaries.reserve(chunkCount);
+    for (uint32_t chunk = 0; chunk < chunkCount; ++chunk) {
+        secondaries.push_back(*contexts[chunk].commandBuffer);
+    }
+    cmd.executeCommands(secondaries);
+    TracyPlot("Vulkan/RecordChunks", static_cast<double>(chunkCount));
+}
+
+void Renderer::recordEntityDraws(vk::raii::CommandBuffer& cmd, EntityId firstEntity, EntityId endEntity) const
+{
+    ZoneScopedN("Renderer::recordEntityDraws");
+    const auto& storage = resourceManager.objectStorage;
+
+    MeshPushData pushData = makeMeshPushData();
+    for (EntityId id = firstEntity; id < endEntity;)
+    {
+        const MeshletDraw& meshletDraw = storage.meshletDraws[id];
+        if ((storage.flags[id] & EntityFlag::Active) == 0 || meshletDraw.meshletCount == 0)
+        {
+            ++id;
+            continue;
+        }
+
+        // One task workgroup per kTaskGroupSize meshlets; the task stage launches the visible ones.
+        const uint32_t groupCountX = (meshletDraw.meshletCount + kTaskGroupSize - 1) / kTaskGroupSize;
+        // Following active entities with the same meshlet range (instances of one mesh at the same LOD) and
+        // texture share the dispatch, one workgroup row each.
+        const uint32_t maxInstances = std::min(kMaxTaskGroupCountY, kMaxTaskGroupTotalCount / groupCountX);
+        EntityId instanceEnd = id + 1;
+        while (instanceEnd < endEntity && instanceEnd - id < maxInstances &&
+               (storage.flags[instanceEnd] & EntityFlag::Active) != 0 &&
+               storage.meshletDraws[instanceEnd].firstMeshlet == meshletDraw.firstMeshlet &&
+               storage.meshletDraws[instanceEnd].meshletCount == meshletDraw.meshletCount &&
+               storage.materials[instanceEnd].textureIndex == storage.materials[id].textureIndex)
+        {
+            ++instanceEnd;
+        }
+
+        pushData.entityId = id;
+        pushData.firstMeshlet = meshletDraw.firstMeshlet;
+        pushData.meshletCount = meshletDraw.meshletCount;
+        pushData.texture = {
+            .resourceIndex = storage.materials[id].textureIndex,
+            .samplerIndex = 0,
+        };
+
+        const vk::PushDataInfoEXT pushDataInfo = {
+            .sType = vk::StructureType::ePushDataInfoEXT,
+            .pNext = nullptr,
+            .offset = 0,
+            .data = vk::HostAddressRangeConstEXT{.address = &pushData, .size = sizeof(MeshPushData)}};
+        cmd.pushDataEXT(pushDataInfo);
+
+        cmd.drawMeshTasksEXT(groupCountX, instanceEnd - id, 1);
+        id = instanceEnd;
+    }
+}
+
 void Renderer::waitIdle() const { device.vkdevice.waitIdle(); }
@@ -2,6 +2,8 @@
 #include "core/vk_descriptors.hpp"
 #include "core/vk_resource_manager.hpp"
 #include "core/vk_swapchain.hpp"
+#include "core/texture_manager.hpp"
+#include "push_data.hpp"
 #include "vk_pipeline.hpp"
 #include "scene/vk_camera.hpp"
 
@@ -20,6 +22,8 @@ public:
 			 bool imguiEnabled = false);
 
 	void setTracyContext(VkTracyContext* tracyContextIn);
+	// Mips and virtual texture pages streamed from the previous feedback every frame; null draws without feedback.
+	void setTextureManager(TextureManager* textureManagerIn) noexcept { textureManager = textureManagerIn; }
 	void setImGuiVisible(bool visible) noexcept { imguiVisible = visible; }
 	[[nodiscard]] bool isImGuiVisible() const noexcept { return imguiVisible; }
 	void rebuildSwapchainResources() const;
@@ -30,6 +34,31 @@ public:
 
 private:
 	void recordCommandBuffer(uint32_t imageIndex);
+	// First pass of every frame: scatter.slang copies the frame's changed ObjectUBs into the device array.
+	void recordInstanceScatter(vk::raii::CommandBuffer& cmd);
+	// GPU-driven path, two-phase occlusion culling: each cull.slang phase fills its DrawMeshTasksCommand region,
+	// one indirect-count draw per phase consumes it. The Hi-Z pyramid is built between the phases.
+	void recordCullPass(vk::raii::CommandBuffer& cmd, CullPhase phase);
+	void recordIndirectDraws(vk::raii::CommandBuffer& cmd, CullPhase phase);
+	void recordDepthPyramid(vk::raii::CommandBuffer& cmd);
+	void bindMeshPipeline(vk::raii::CommandBuffer& cmd) const;
+	// Heap slots for the depth resolve / pyramid images (re)written after every swapchain rebuild.
+	void writeDepthPyramidDescriptors() const;
+	[[nodiscard]] uint32_t depthResolveDescriptorIndex() const noexcept { return depthPyramidDescriptorBase; }
+	[[nodiscard]] uint32_t depthPyramidDescriptorIndex() const noexcept { return depthPyramidDescriptorBase + 1; }
+	[[nodiscard]] uint32_t depthPyramidLevelDescriptorIndex(uint32_t level) const noexcept
+	{
+		return depthPyramidDescriptorBase + 2 + level;
+	}
+	[[nodiscard]] SlangHandle depthPyramidHandle() const;
+	[[nodiscard]] SlangHandle depthPyramidSamplerHandle() const;
+	// CPU path (ENGINE_GPU_DRIVEN_DRAWS == 0): one pushDataEXT + drawMeshTasksEXT per entity, recorded into
+	// per-worker secondaries on jobExecutor() and executed from the primary.
+	void recordEntityDrawsParallel(vk::raii::CommandBuffer& cmd);
+	void recordEntityDraws(vk::raii::CommandBuffer& cmd, EntityId firstEntity, EntityId endEntity) const;
+	// Frame-constant part of MeshPushData (addresses + sampler); per-draw fields stay zero.
+	[[nodiscard]] MeshPushData makeMeshPushData() const;
+	[[nodiscard]] bool meshBuffersReady() const;
 
 	Device& device;
 	SwapChain& swapChain;
@@ -38,8 +67,14 @@ private:
 	Pipeline& pipeline;
 	Camera& camera;
 	VkTracyContext* tracyContext = nullptr;
+	TextureManager* textureManager = nullptr;
 	bool imguiEnabled = false;
 	// Drawn only while the UI toggle is open (I key).
 	bool imguiVisible = false;
 
+	// Below this many entities per chunk, task overhead outweighs parallel recording.
+	static constexpr uint32_t kMinEntitiesPerRecordChunk = 256;
+	static constexpr uint32_t kDepthPyramidDescriptorCount = 2 + ResourceManager::kMaxDepthPyramidLevels;
+	uint32_t depthPyramidDescriptorBase = 0;
+
 };
@@ -0,0 +1,568 @@
+#include "scene_bvh.hpp"
+#include "util/jobs.hpp"
+#include "util/vk_tracy.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+using Node = SceneBvh::Node;
+using LeafInput = SceneBvh::LeafInput;
+constexpr uint32_t kNullNode = SceneBvh::kNullNode;
+
+// Fat leaf margin: a fraction of the bounds' half extent, at least kMinFatMargin world units.
+constexpr float kFatMarginRatio = 0.1f;
+constexpr float kMinFatMargin = 0.05f;
+// Background rebuild once this many leaves were inserted or refit, and at least a quarter of the tree.
+constexpr uint32_t kMinChangesBeforeRebuild = 1024;
+constexpr uint32_t kRebuildLeafDivisor = 4;
+constexpr uint32_t kSahBins = 16;
+
+Aabb unionOf(const Aabb& a, const Aabb& b)
+{
+    return Aabb{.min = glm::min(a.min, b.min), .max = glm::max(a.max, b.max)};
+}
+
+// Half the surface area: SAH only compares areas.
+float surfaceArea(const Aabb& box)
+{
+    const glm::vec3 extent = box.max - box.min;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+bool contains(const Aabb& outer, const Aabb& inner)
+{
+    return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::greaterThanEqual(outer.max, inner.max));
+}
+
+bool operator==(const Aabb& a, const Aabb& b)
+{
+    return a.min == b.min && a.max == b.max;
+}
+
+Aabb fatten(const Aabb& box)
+{
+    const glm::vec3 halfExtent = (box.max - box.min) * 0.5f;
+    const float margin =
+        std::max(kMinFatMargin, kFatMarginRatio * std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z)));
+    return Aabb{.min = box.min - glm::vec3(margin), .max = box.max + glm::vec3(margin)};
+}
+
+// The LOD 0 meshlet sphere under the entity's current model matrix; its origin when the mesh has no bounds.
+Aabb entityBounds(const ObjectStorage& storage, EntityId id)
+{
+    const glm::mat4& model = storage.modelMatrices[id];
+    const glm::vec4 sphere = transformBoundingSphere(model, storage.meshLods[id].lods[0].boundingSphere);
+    const glm::vec3 center = sphere.w > 0.0f ? glm::vec3(sphere) : glm::vec3(model[3]);
+    return Aabb{.min = center - glm::vec3(sphere.w), .max = center + glm::vec3(sphere.w)};
+}
+
+// Entry distance of the ray into box within [0, maxDistance]; nullopt on a miss. Axes the ray runs parallel to
+// are tested by origin alone, so no 0 * inf ever reaches the comparison.
+std::optional<float> rayEnter(const Aabb& box, const glm::vec3& origin, const glm::vec3& direction,
+                              float maxDistance)
+{
+    float enter = 0.0f;
+    float exit = maxDistance;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (direction[axis] == 0.0f) {
+            if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+                return std::nullopt;
+            }
+            continue;
+        }
+        const float inverse = 1.0f / direction[axis];
+        const float t0 = (box.min[axis] - origin[axis]) * inverse;
+        const float t1 = (box.max[axis] - origin[axis]) * inverse;
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+    }
+    if (!(enter <= exit)) {
+        return std::nullopt;
+    }
+    return enter;
+}
+
+// Splits leaves[first, end) at the cheapest of kSahBins - 1 planes on the longest centroid axis; returns the first
+// leaf of the right half. Falls back to a median split when binning cannot separate the leaves.
+uint32_t partitionSah(std::vector<LeafInput>& leaves, uint32_t first, uint32_t end, const Aabb& centroids)
+{
+    const glm::vec3 extent = centroids.max - centroids.min;
+    const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    const auto centroid = [axis](const LeafInput& leaf) { return leaf.bounds.min[axis] + leaf.bounds.max[axis]; };
+    const auto medianSplit = [&] {
+        const uint32_t mid = first + (end - first) / 2;
+        std::nth_element(leaves.begin() + first, leaves.begin() + mid, leaves.begin() + end,
+                         [&](const LeafInput& a, const LeafInput& b) { return centroid(a) < centroid(b); });
+        return mid;
+    };
+    if (extent[axis] <= 0.0f) {
+        return medianSplit();
+    }
+
+    // Centroids are compared doubled (min + max), so the bin scale is too.
+    const float binScale = static_cast<float>(kSahBins) / (2.0f * extent[axis]);
+    const float axisMin = 2.0f * centroids.min[axis];
+    const auto binOf = [&](const LeafInput& leaf) {
+        return std::min(kSahBins - 1, static_cast<uint32_t>((centroid(leaf) - axisMin) * binScale));
+    };
+
+    std::array<Aabb, kSahBins> binBounds{};
+    std::array<uint32_t, kSahBins> binCounts{};
+    for (uint32_t i = first; i < end; ++i) {
+        const uint32_t bin = binOf(leaves[i]);
+        binBounds[bin] = binCounts[bin] == 0 ? leaves[i].bounds : unionOf(binBounds[bin], leaves[i].bounds);
+        ++binCounts[bin];
+    }
+
+    // Sweep from the right for the right-hand areas, then from the left evaluating each plane.
+    std::array<float, kSahBins> rightCost{};
+    Aabb accumulated{};
+    uint32_t count = 0;
+    for (uint32_t bin = kSahBins - 1; bin > 0; --bin) {
+        if (binCounts[bin] != 0) {
+            accumulated = count == 0 ? binBounds[bin] : unionOf(accumulated, binBounds[bin]);
+            count += binCounts[bin];
+        }
+        rightCost[bin] = count == 0 ? 0.0f : surfaceArea(accumulated) * static_cast<float>(count);
+    }
+    float bestCost = std::numeric_limits<float>::infinity();
+    uint32_t bestPlane = 0;
+    count = 0;
+    for (uint32_t plane = 1; plane < kSahBins; ++plane) {
+        const uint32_t bin = plane - 1;
+        if (binCounts[bin] != 0) {
+            accumulated = count == 0 ? binBounds[bin] : unionOf(accumulated, binBounds[bin]);
+            count += binCounts[bin];
+        }
+        const float cost = (count == 0 ? 0.0f : surfaceArea(accumulated) * static_cast<float>(count)) +
+            rightCost[plane];
+        if (count != 0 && count != end - first && cost < bestCost) {
+            bestCost = cost;
+            bestPlane = plane;
+        }
+    }
+    if (bestPlane == 0) {
+        return medianSplit();
+    }
+    const auto mid = std::partition(leaves.begin() + first, leaves.begin() + end,
+                                    [&](const LeafInput& leaf) { return binOf(leaf) < bestPlane; });
+    return static_cast<uint32_t>(mid - leaves.begin());
+}
+
+// Top-down binned SAH build, one leaf per entity. Runs on a jobExecutor() worker; touches only its input.
+SceneBvh::BuiltTree buildSahTree(std::vector<LeafInput> leaves)
+{
+    ZoneScopedN("SceneBvh::buildSahTree");
+    SceneBvh::BuiltTree tree;
+    if (leaves.empty()) {
+        return tree;
+    }
+    tree.nodes.reserve(2 * leaves.size() - 1);
+
+    struct Range
+    {
+        uint32_t first;
+        uint32_t end;
+        uint32_t parent;
+        bool leftChild;
+    };
+    std::vector<Range> stack{
+        {.first = 0, .end = static_cast<uint32_t>(leaves.size()), .parent = kNullNode, .leftChild = false}};
+    while (!stack.empty()) {
+        const Range range = stack.back();
+        stack.pop_back();
+
+        const auto index = static_cast<uint32_t>(tree.nodes.size());
+        Node& node = tree.nodes.emplace_back(Node{.parent = range.parent});
+        if (range.parent == kNullNode) {
+            tree.root = index;
+        } else if (range.leftChild) {
+            tree.nodes[range.parent].left = index;
+        } else {
+            tree.nodes[range.parent].right = index;
+        }
+
+        if (range.end - range.first == 1) {
+            node.bounds = leaves[range.first].bounds;
+            node.entity = leaves[range.first].entity;
+            continue;
+        }
+        Aabb bounds = leaves[range.first].bounds;
+        const glm::vec3 firstCentroid = (bounds.min + bounds.max) * 0.5f;
+        Aabb centroids{.min = firstCentroid, .max = firstCentroid};
+        for (uint32_t i = range.first + 1; i < range.end; ++i) {
+            bounds = unionOf(bounds, leaves[i].bounds);
+            const glm::vec3 centroid = (leaves[i].bounds.min + leaves[i].bounds.max) * 0.5f;
+            centroids = Aabb{.min = glm::min(centroids.min, centroid), .max = glm::max(centroids.max, centroid)};
+        }
+        node.bounds = bounds;
+
+        const uint32_t mid = partitionSah(leaves, range.first, range.end, centroids);
+        stack.push_back({.first = mid, .end = range.end, .parent = index, .leftChild = false});
+        stack.push_back({.first = range.first, .end = mid, .parent = index, .leftChild = true});
+    }
+    return tree;
+}
+
+} // anonymous namespace
+
+void SceneBvh::update(ObjectStorage& storage)
+{
+    ZoneScopedN("SceneBvh::update");
+    if (rebuild.valid() && rebuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        adoptRebuild(storage);
+    }
+
+    // Spawned entities are boundsDirty and inserted below.
+    storage.takeDestroyed(destroyed);
+    for (const EntityHandle entity : destroyed) {
+        const uint32_t leaf = entity.slot < leafOfSlot.size() ? leafOfSlot[entity.slot] : kNullNode;
+        if (leaf != kNullNode && nodes[leaf].entity == entity) {
+            removeLeaf(leaf);
+        }
+    }
+
+    const uint32_t count = storage.size();
+    for (uint32_t chunk = 0; chunk * kEntityChunkSize < count; ++chunk) {
+        const EntityId first = chunk * kEntityChunkSize;
+        const uint32_t n = std::min(kEntityChunkSize, count - first);
+        uint8_t* dirty = storage.boundsDirty.chunk(chunk);
+        for (uint32_t i = 0; i < n; ++i) {
+            if (dirty[i] != 0) {
+                syncEntity(storage, first + i);
+                dirty[i] = 0;
+            }
+        }
+    }
+
+    if (!rebuild.valid() && changesSinceBuild >= std::max(kMinChangesBeforeRebuild, leaves / kRebuildLeafDivisor)) {
+        startRebuild();
+    }
+    TracyPlot("Scene/BvhLeaves", static_cast<double>(leaves));
+    TracyPlot("Scene/BvhNodes", static_cast<double>(nodeCount()));
+}
+
+void SceneBvh::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    root = kNullNode;
+    leaves = 0;
+    leafOfSlot.clear();
+    changesSinceBuild = 0;
+    // A running build finishes on its own; its result is dropped with the future.
+    rebuild = {};
+}
+
+void SceneBvh::syncEntity(const ObjectStorage& storage, EntityId id)
+{
+    const EntityHandle entity = storage.handle(id);
+    const Aabb tight = entityBounds(storage, id);
+    if (entity.slot >= leafOfSlot.size()) {
+        leafOfSlot.resize(entity.slot + 1, kNullNode);
+    }
+    const uint32_t leaf = leafOfSlot[entity.slot];
+    if (leaf != kNullNode && nodes[leaf].entity == entity) {
+        if (contains(nodes[leaf].bounds, tight)) {
+            return;
+        }
+        nodes[leaf].bounds = fatten(tight);
+        refitFrom(nodes[leaf].parent);
+    } else {
+        if (leaf != kNullNode) {
+            removeLeaf(leaf); // the slot's previous entity
+        }
+        insertLeaf(fatten(tight), entity);
+    }
+    ++changesSinceBuild;
+}
+
+uint32_t SceneBvh::allocateNode()
+{
+    if (!freeNodes.empty()) {
+        const uint32_t node = freeNodes.back();
+        freeNodes.pop_back();
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void SceneBvh::freeNode(uint32_t node)
+{
+    nodes[node] = Node{};
+    freeNodes.push_back(node);
+}
+
+void SceneBvh::insertLeaf(const Aabb& bounds, EntityHandle entity)
+{
+    const uint32_t leaf = allocateNode();
+    nodes[leaf] = Node{.bounds = bounds, .entity = entity};
+    leafOfSlot[entity.slot] = leaf;
+    ++leaves;
+    if (root == kNullNode) {
+        root = leaf;
+        return;
+    }
+
+    // Descend while pushing the leaf into a child is cheaper (surface area increase) than pairing it here.
+    uint32_t sibling = root;
+    while (!isLeaf(sibling)) {
+        const Node& node = nodes[sibling];
+        const float combined = surfaceArea(unionOf(node.bounds, bounds));
+        const float pairCost = 2.0f * combined;
+        const float inheritedCost = 2.0f * (combined - surfaceArea(node.bounds));
+        const auto descendCost = [&](uint32_t child) {
+            const float grown = surfaceArea(unionOf(nodes[child].bounds, bounds));
+            return inheritedCost + (isLeaf(child) ? grown : grown - surfaceArea(nodes[child].bounds));
+        };
+        const float leftCost = descendCost(node.left);
+        const float rightCost = descendCost(node.right);
+        if (pairCost < leftCost && pairCost < rightCost) {
+            break;
+        }
+        sibling = leftCost < rightCost ? node.left : node.right;
+    }
+
+    const uint32_t oldParent = nodes[sibling].parent;
+    const uint32_t newParent = allocateNode();
+    nodes[newParent] = Node{.bounds = unionOf(nodes[sibling].bounds, bounds),
+                            .parent = oldParent,
+                            .left = sibling,
+                            .right = leaf};
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    if (oldParent == kNullNode) {
+        root = newParent;
+        return;
+    }
+    if (nodes[oldParent].left == sibling) {
+        nodes[oldParent].left = newParent;
+    } else {
+        nodes[oldParent].right = newParent;
+    }
+    refitFrom(oldParent);
+}
+
+void SceneBvh::removeLeaf(uint32_t leaf)
+{
+    const EntityHandle entity = nodes[leaf].entity;
+    if (entity.slot < leafOfSlot.size() && leafOfSlot[entity.slot] == leaf) {
+        leafOfSlot[entity.slot] = kNullNode;
+    }
+    --leaves;
+
+    const uint32_t parent = nodes[leaf].parent;
+    freeNode(leaf);
+    if (parent == kNullNode) {
+        root = kNullNode;
+        return;
+    }
+    // The sibling takes the parent's place.
+    const uint32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+    const uint32_t grandParent = nodes[parent].parent;
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    if (grandParent == kNullNode) {
+        root = sibling;
+        return;
+    }
+    if (nodes[grandParent].left == parent) {
+        nodes[grandParent].left = sibling;
+    } else {
+        nodes[grandParent].right = sibling;
+    }
+    refitFrom(grandParent);
+}
+
+void SceneBvh::refitFrom(uint32_t node)
+{
+    while (node != kNullNode) {
+        const Aabb bounds = unionOf(nodes[nodes[node].left].bounds, nodes[nodes[node].right].bounds);
+        if (bounds == nodes[node].bounds) {
+            return;
+        }
+        nodes[node].bounds = bounds;
+        node = nodes[node].parent;
+    }
+}
+
+void SceneBvh::startRebuild()
+{
+    ZoneScopedN("SceneBvh::startRebuild");
+    std::vector<LeafInput> snapshot;
+    snapshot.reserve(leaves);
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        if (isLeaf(node) && nodes[node].entity != kInvalidEntityHandle) {
+            snapshot.push_back({.bounds = nodes[node].bounds, .entity = nodes[node].entity});
+        }
+    }
+    changesSinceBuild = 0;
+    rebuild = jobExecutor().async([leafInputs = std::move(snapshot)]() mutable {
+        return buildSahTree(std::move(leafInputs));
+    });
+}
+
+void SceneBvh::adoptRebuild(ObjectStorage& storage)
+{
+    ZoneScopedN("SceneBvh::adoptRebuild");
+    BuiltTree built = rebuild.get();
+    nodes = std::move(built.nodes);
+    root = built.root;
+    freeNodes.clear();
+    leaves = 0;
+    std::fill(leafOfSlot.begin(), leafOfSlot.end(), kNullNode);
+    std::vector<uint32_t> deadLeaves;
+    for (uint32_t node = 0; node < nodes.size(); ++node) {
+        if (!isLeaf(node)) {
+            continue;
+        }
+        ++leaves;
+        const EntityHandle entity = nodes[node].entity;
+        if (!storage.alive(entity)) {
+            deadLeaves.push_back(node);
+            continue;
+        }
+        if (entity.slot >= leafOfSlot.size()) {
+            leafOfSlot.resize(entity.slot + 1, kNullNode);
+        }
+        leafOfSlot[entity.slot] = node;
+    }
+
+    // The snapshot predates this frame: drop entities destroyed meanwhile and re-sync every live one.
+    for (const uint32_t leaf : deadLeaves) {
+        removeLeaf(leaf);
+    }
+    for (EntityId id = 0; id < storage.size(); ++id) {
+        syncEntity(storage, id);
+        storage.boundsDirty[id] = 0;
+    }
+    changesSinceBuild = 0;
+}
+
+void SceneBvh::queryFrustum(std::span<const glm::vec4, 6> planes, std::vector<EntityHandle>& out) const
+{
+    ZoneScopedN("SceneBvh::queryFrustum");
+    if (root == kNullNode) {
+        return;
+    }
+    // inside: every plane already accepts the whole subtree.
+    struct Entry
+    {
+        uint32_t node;
+        bool inside;
+    };
+    std::vector<Entry> stack{{.node = root, .inside = false}};
+    while (!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[entry.node];
+
+        bool inside = entry.inside;
+        if (!inside) {
+            inside = true;
+            bool outside = false;
+            for (const glm::vec4& plane : planes) {
+                const glm::vec3 normal{plane};
+                // Box corners furthest along / against the plane normal.
+                const glm::bvec3 facing = glm::greaterThanEqual(normal, glm::vec3(0.0f));
+                const glm::vec3 positive = glm::mix(node.bounds.min, node.bounds.max, facing);
+                const glm::vec3 negative = glm::mix(node.bounds.max, node.bounds.min, facing);
+                if (glm::dot(normal, positive) + plane.w < 0.0f) {
+                    outside = true;
+                    break;
+                }
+                inside = inside && glm::dot(normal, negative) + plane.w >= 0.0f;
+            }
+            if (outside) {
+                continue;
+            }
+        }
+
+        if (isLeaf(entry.node)) {
+            out.push_back(node.entity);
+        } else {
+            stack.push_back({.node = node.left, .inside = inside});
+            stack.push_back({.node = node.right, .inside = inside});
+        }
+    }
+}
+
+void SceneBvh::querySphere(const glm::vec3& center, float radius, std::vector<EntityHandle>& out) const
+{
+    ZoneScopedN("SceneBvh::querySphere");
+    if (root == kNullNode) {
+        return;
+    }
+    const float radiusSquared = radius * radius;
+    std::vector<uint32_t> stack{root};
+    while (!stack.empty()) {
+        const uint32_t index = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[index];
+        const glm::vec3 offset = glm::clamp(center, node.bounds.min, node.bounds.max) - center;
+        if (glm::dot(offset, offset) > radiusSquared) {
+            continue;
+        }
+        if (isLeaf(index)) {
+            out.push_back(node.entity);
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+std::optional<BvhRayHit> SceneBvh::raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                           float maxDistance) const
+{
+    ZoneScopedN("SceneBvh::raycast");
+    // +inf is an unbounded pick; NaN or negative ranges and a zero direction hit nothing.
+    if (root == kNullNode || !(maxDistance >= 0.0f) || direction == glm::vec3(0.0f)) {
+        return std::nullopt;
+    }
+    std::optional<BvhRayHit> hit;
+    float nearest = maxDistance;
+
+    struct Entry
+    {
+        uint32_t node;
+        float enter;
+    };
+    std::vector<Entry> stack;
+    if (const std::optional<float> rootEnter = rayEnter(nodes[root].bounds, origin, direction, nearest)) {
+        stack.push_back({.node = root, .enter = *rootEnter});
+    }
+    while (!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        if (entry.enter > nearest) {
+            continue; // a closer hit was found after this node was pushed
+        }
+        const Node& node = nodes[entry.node];
+        if (isLeaf(entry.node)) {
+            nearest = entry.enter;
+            hit = BvhRayHit{.entity = node.entity, .distance = entry.enter};
+            continue;
+        }
+        // Nearer child on top of the stack, so its hits prune the farther one.
+        const std::optional<float> leftEnter = rayEnter(nodes[node.left].bounds, origin, direction, nearest);
+        const std::optional<float> rightEnter = rayEnter(nodes[node.right].bounds, origin, direction, nearest);
+        if (leftEnter && rightEnter) {
+            const bool leftNearer = *leftEnter < *rightEnter;
+            stack.push_back({.node = leftNearer ? node.right : node.left,
+                             .enter = leftNearer ? *rightEnter : *leftEnter});
+            stack.push_back({.node = leftNearer ? node.left : node.right,
+                             .enter = leftNearer ? *leftEnter : *rightEnter});
+        } else if (leftEnter) {
+            stack.push_back({.node = node.left, .enter = *leftEnter});
+        } else if (rightEnter) {
+            stack.push_back({.node = node.right, .enter = *rightEnter});
+        }
+    }
+    return hit;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "../core/object_storage.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <future>
+#include <optional>
+#include <span>
+#include <vector>
+
+struct Aabb
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+};
+
+struct BvhRayHit
+{
+    EntityHandle entity;
+    float distance = 0.0f; // along the ray to the entry point of the entity's bounds
+};
+
+// ---------------------------------------------------------------------------
+// SceneBvh — dynamic AABB tree over ObjectStorage, one leaf per entity.
+// Leaf bounds come from the entity's LOD 0 meshlet sphere (MeshLodChain) under its modelMatrix, fattened by a
+// margin so small moves need no tree update. Leaves are keyed by EntityHandle, so swap-and-pop removal in
+// ObjectStorage does not touch the tree.
+//   - update() (main thread, after writeObjectUbUploads recomputed the matrices): inserts spawned entities,
+//     removes the ones ObjectStorage::takeDestroyed reports (through leafOfSlot, no tree scan) and refits the
+//     ancestors of every moved leaf that left its fat box.
+//   - Refits and incremental inserts degrade the tree; past a change budget a binned SAH rebuild runs on a
+//     jobExecutor() worker over a snapshot of the leaves, and a later update() adopts it and re-syncs.
+// Queries return handles (resolve with ObjectStorage::find) and test bounds only, not triangles.
+// ---------------------------------------------------------------------------
+class SceneBvh
+{
+public:
+    void update(ObjectStorage& storage);
+    void clear();
+
+    // Entities whose bounds intersect the frustum (xyz = inward normal, w = distance, as CameraData).
+    void queryFrustum(std::span<const glm::vec4, 6> planes, std::vector<EntityHandle>& out) const;
+    void querySphere(const glm::vec3& center, float radius, std::vector<EntityHandle>& out) const;
+    // Nearest entity bounds hit by origin + t * direction, t in [0, maxDistance]; maxDistance may be +inf.
+    [[nodiscard]] std::optional<BvhRayHit> raycast(const glm::vec3& origin, const glm::vec3& direction,
+                                                   float maxDistance) const;
+
+    [[nodiscard]] uint32_t leafCount() const noexcept { return leaves; }
+    [[nodiscard]] uint32_t nodeCount() const noexcept { return static_cast<uint32_t>(nodes.size() - freeNodes.size()); }
+
+    static constexpr uint32_t kNullNode = ~0u;
+
+    struct Node
+    {
+        Aabb bounds;
+        uint32_t parent = kNullNode;
+        uint32_t left = kNullNode; // kNullNode for leaves
+        uint32_t right = kNullNode;
+        EntityHandle entity;
+    };
+    struct LeafInput
+    {
+        Aabb bounds;
+        EntityHandle entity;
+    };
+    struct BuiltTree
+    {
+        std::vector<Node> nodes;
+        uint32_t root = kNullNode;
+    };
+
+private:
+    [[nodiscard]] bool isLeaf(uint32_t node) const noexcept { return nodes[node].left == kNullNode; }
+    [[nodiscard]] uint32_t allocateNode();
+    void freeNode(uint32_t node);
+    void insertLeaf(const Aabb& bounds, EntityHandle entity);
+    void removeLeaf(uint32_t leaf);
+    // Recomputes the bounds of node and its ancestors until one is unchanged.
+    void refitFrom(uint32_t node);
+    // Leaf bounds of entity id are tight; reinserted or refit when they left the fat box.
+    void syncEntity(const ObjectStorage& storage, EntityId id);
+    void adoptRebuild(ObjectStorage& storage);
+    void startRebuild();
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = kNullNode;
+    uint32_t leaves = 0;
+    std::vector<uint32_t> leafOfSlot; // by EntityHandle::slot; kNullNode when the slot has no leaf
+
+    std::vector<EntityHandle> destroyed; // reused takeDestroyed buffer
+    uint32_t changesSinceBuild = 0;
+    std::future<BuiltTree> rebuild;
+};
@@ -133,6 +133,7 @@ void Camera::updateCameraData(uint8_t currentImage)
         updateProjection();
 
     cameraData.prevViewProj = prevViewProj;
+    cameraData.cameraParams.x = lodErrorPixels;
 
     cameraData.view = glm::lookAt(cameraData.cameraPos, cameraData.cameraPos + forward, worldUp);
     cameraData.viewProj = cameraData.proj * cameraData.view;
@@ -142,6 +143,18 @@ void Camera::updateCameraData(uint8_t currentImage)
     cameraData.invProj = glm::inverse(cameraData.proj);
     cameraData.invViewProj = glm::inverse(cameraData.viewProj);
 
+    // Gribb/Hartmann plane extraction from the row vectors of viewProj (depth range [0, 1]).
+    const glm::mat4 m = glm::transpose(cameraData.viewProj);
+    cameraData.frustumPlanes[0] = m[3] + m[0];
+    cameraData.frustumPlanes[1] = m[3] - m[0];
+    cameraData.frustumPlanes[2] = m[3] + m[1];
+    cameraData.frustumPlanes[3] = m[3] - m[1];
+    cameraData.frustumPlanes[4] = m[2];
+    cameraData.frustumPlanes[5] = m[3] - m[2];
+    for (glm::vec4& plane : cameraData.frustumPlanes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+
     memcpy(this->cameraBuffersMapped[currentImage], &this->cameraData, sizeof(this->cameraData));
 
     prevViewProj = cameraData.viewProj;
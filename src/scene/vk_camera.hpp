@@ -42,6 +42,10 @@ public:
         projDirty = true;
     }
 
+    // Cluster LOD: largest simplification error, in pixels, a drawn meshlet may show (0 = full detail).
+    [[nodiscard]] float getLodErrorThreshold() const { return lodErrorPixels; }
+    void setLodErrorThreshold(float pixels) { lodErrorPixels = std::max(pixels, 0.0f); }
+
     // ── GPU upload ────────────────────────────────────────────
     void updateCameraData(uint8_t currentImage);
 
@@ -73,6 +77,7 @@ private:
     float nearPlane = 0.1f;
     float farPlane = 20.0f;
     bool projDirty = true;
+    float lodErrorPixels = 1.0f;
 
     static constexpr float kPitchLimit = glm::radians(89.0f);
     static constexpr float kMouseSensitivity = 0.002f; // rad/pixel
@@ -1,11 +1,12 @@
 #pragma once
 
 #include "../core/object_storage.hpp"
+#include "scene_bvh.hpp"
 
 #include <glm/glm.hpp>
 
 // ---------------------------------------------------------------------------
-// Scene - world container: object SoA storage, origin, base axes.
+// Scene - world container: object SoA storage, its spatial index (BVH), origin, base axes.
 // ---------------------------------------------------------------------------
 class Scene
 {
@@ -20,6 +21,11 @@ public:
     Scene& operator=(const Scene&) = delete;
 
     ObjectStorage objectStorage;
+    // Frustum / sphere / ray queries over objectStorage; current as of the last updateSpatialIndex().
+    SceneBvh bvh;
+
+    // Main thread, after the frame's model matrices were recomputed (Renderer::drawFrame).
+    void updateSpatialIndex() { bvh.update(objectStorage); }
 
     [[nodiscard]] const glm::vec3& getStartPosition() const noexcept { return startPosition; }
     void setStartPosition(const glm::vec3& pos) noexcept { startPosition = pos; }
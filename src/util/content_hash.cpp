@@ -0,0 +1,47 @@
+#include "content_hash.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace
+{
+    constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+
+    constexpr uint64_t mixLane(uint64_t lane, uint64_t word)
+    {
+        return std::rotl(lane + word * kPrime2, 31) * kPrime1;
+    }
+
+    uint64_t readWord(const std::byte* bytes)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes, sizeof(word));
+        return word;
+    }
+} // namespace
+
+uint64_t hashBytes(std::span<const std::byte> bytes, uint64_t seed)
+{
+    std::array<uint64_t, 4> lanes{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+    size_t offset = 0;
+    for (; offset + 32 <= bytes.size(); offset += 32) {
+        for (size_t lane = 0; lane < lanes.size(); ++lane) {
+            lanes[lane] = mixLane(lanes[lane], readWord(bytes.data() + offset + lane * 8));
+        }
+    }
+    uint64_t hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) +
+        std::rotl(lanes[3], 18) + bytes.size();
+    for (; offset + 8 <= bytes.size(); offset += 8) {
+        hash = std::rotl(hash ^ mixLane(0, readWord(bytes.data() + offset)), 27) * kPrime1 + kPrime2;
+    }
+    for (; offset < bytes.size(); ++offset) {
+        hash = std::rotl(hash ^ (static_cast<uint64_t>(bytes[offset]) * kPrime1), 11) * kPrime2;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
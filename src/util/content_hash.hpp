@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// 64-bit content hash: four independent multiply-rotate lanes (32 B per step) and a splitmix finalizer.
+// Runs near memory bandwidth, so keying caches by file contents costs little next to parsing the file.
+// Not cryptographic; the result is stable across runs and platforms of the same endianness.
+[[nodiscard]] uint64_t hashBytes(std::span<const std::byte> bytes, uint64_t seed = 0);
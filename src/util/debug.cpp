@@ -72,6 +72,10 @@ void setDebugName(const vk::raii::Device &device, const vk::raii::CommandBuffer
 	setDebugNameImpl(device, buffer, name, vk::ObjectType::eCommandBuffer);
 }
 
+void setDebugName(const vk::raii::Device &device, const vk::raii::Semaphore &semaphore, std::string_view name) {
+	setDebugNameImpl(device, semaphore, name, vk::ObjectType::eSemaphore);
+}
+
 void setDebugName(const vk::raii::Device &device, const vk::raii::SurfaceKHR &surface, std::string_view name) {
 	setDebugNameImpl(device, surface, name, vk::ObjectType::eSurfaceKHR);
 }
@@ -15,6 +15,7 @@ void setDebugName(const vk::raii::Device &device, const vk::raii::PhysicalDevice
 void setDebugName(const vk::raii::Device &device, const vk::raii::Queue &queue, std::string_view name);
 void setDebugName(const vk::raii::Device &device, const vk::raii::CommandPool &pool, std::string_view name);
 void setDebugName(const vk::raii::Device &device, const vk::raii::CommandBuffer &buffer, std::string_view name);
+void setDebugName(const vk::raii::Device &device, const vk::raii::Semaphore &semaphore, std::string_view name);
 void setDebugName(const vk::raii::Device &device, const vk::raii::SurfaceKHR &surface, std::string_view name);
 void setDebugName(const vk::raii::Device &device, const vk::raii::Instance &instance, std::string_view name);
 void setDebugName(const vk::raii::Device &device, const vk::raii::DescriptorSetLayout &layout, std::string_view name);
@@ -0,0 +1,20 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <thread>
+
+tf::Executor& jobExecutor()
+{
+    static tf::Executor executor(std::max<size_t>(std::thread::hardware_concurrency(), 1));
+    return executor;
+}
+
+void runAndWait(tf::Taskflow& taskflow)
+{
+    tf::Executor& executor = jobExecutor();
+    if (executor.this_worker_id() >= 0) {
+        executor.corun(taskflow);
+    } else {
+        executor.run(taskflow).wait();
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <taskflow/taskflow.hpp>
+
+// Process-wide worker pool (one worker per hardware thread) shared by render recording and asset jobs.
+// Lives in engine_util so every shared library sees the same executor.
+tf::Executor& jobExecutor();
+
+// Runs taskflow to completion. From a jobExecutor() worker (e.g. inside an async asset job) the caller
+// joins in via corun instead of blocking its thread, so nested fork-join cannot starve the pool.
+void runAndWait(tf::Taskflow& taskflow);
@@ -0,0 +1,106 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::optional<MappedFile> MappedFile::open(const std::filesystem::path& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return std::nullopt;
+    }
+    LARGE_INTEGER fileSize{};
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return std::nullopt;
+    }
+    if (fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return MappedFile(nullptr, 0);
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return std::nullopt;
+    }
+    // The view keeps the mapping object alive after its handle is closed.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        return std::nullopt;
+    }
+    return MappedFile(static_cast<const std::byte*>(view), static_cast<size_t>(fileSize.QuadPart));
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    if (status.st_size == 0) {
+        ::close(fd);
+        return MappedFile(nullptr, 0);
+    }
+    const auto fileSize = static_cast<size_t>(status.st_size);
+    void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file.
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return std::nullopt;
+    }
+    return MappedFile(static_cast<const std::byte*>(view), fileSize);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        unmap();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<std::byte*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
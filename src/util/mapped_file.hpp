@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile). Pages are faulted in on first touch,
+// so opening is O(1) regardless of size. Movable; unmaps on destruction.
+class MappedFile
+{
+public:
+    // nullopt when the file cannot be opened or mapped. An empty file maps to an empty span.
+    [[nodiscard]] static std::optional<MappedFile> open(const std::filesystem::path& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept { return {data, size}; }
+
+private:
+    MappedFile(const std::byte* dataIn, size_t sizeIn) : data(dataIn), size(sizeIn) {}
+    void unmap() noexcept;
+
+    const std::byte* data = nullptr;
+    size_t size = 0;
+};